@@ -0,0 +1,71 @@
+/*
+ *
+ * Copyright 2023 Daniel Dwek
+ *
+ * This file is part of chin-chon-lin.
+ *
+ *  chin-chon-lin is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  chin-chon-lin is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with chin-chon-lin.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include <stdio.h>
+#include "Mask.h"
+#include "Meld.h"
+#include "Action.h"
+
+/*
+ * Store into @ret (at least ACTION_MAX long) the actions allowed to the
+ * player holding @hand, and return how many of them there are. With seven
+ * cards a card must be drawn, from the deck if @deck or from the stack if
+ * @stack; with eight one of them must be discarded, which closes the round
+ * instead if the rest make up combos (but one loose card when
+ * @flexible_ending is set)
+ */
+int action_get_legal (mask_t hand, bool deck, bool stack, int flexible_ending, int *ret)
+{
+	int c, n = 0;
+	mask_t m;
+
+	if (mask_count (hand) < 8) {
+		if (deck)
+			ret[n++] = ACTION_DECK;
+		if (stack)
+			ret[n++] = ACTION_STACK;
+		return n;
+	}
+
+	for (m = hand; m; m &= m - 1) {
+		c = mask_first (m);
+		ret[n++] = action_discard (c);
+		if (meld_loose (hand & ~((mask_t) 1 << c)) <= (flexible_ending ? 1 : 0))
+			ret[n++] = action_close (c);
+	}
+
+	return n;
+}
+
+/*
+ * Human-readable @action, such as "deck", "stack", "discard 5/2" or
+ * "close 12/0" (number/suit)
+ */
+void action_format (int action, char *ret, int size)
+{
+	int c = action_card (action);
+
+	if (action == ACTION_DECK)
+		snprintf (ret, size, "deck");
+	else if (action == ACTION_STACK)
+		snprintf (ret, size, "stack");
+	else
+		snprintf (ret, size, "%s %d/%d", action >= ACTION_CLOSE ? "close" : "discard", c % 12 + 1, c / 12);
+}
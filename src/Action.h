@@ -0,0 +1,66 @@
+/*
+ *
+ * Copyright 2023 Daniel Dwek
+ *
+ * This file is part of chin-chon-lin.
+ *
+ *  chin-chon-lin is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  chin-chon-lin is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with chin-chon-lin.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#ifndef _ACTION_H_
+#define _ACTION_H_
+#include "Mask.h"
+
+// Every move of a turn as a small integer: drawing from the deck or taking
+// the card on top of the stack, and then either discarding one of the
+// eight cards in hand or closing the round with it
+#define ACTION_DECK	0
+#define ACTION_STACK	1
+#define ACTION_DISCARD	2
+#define ACTION_CLOSE	(ACTION_DISCARD + 48)
+#define ACTIONS		(ACTION_CLOSE + 48)
+// No turn ever has more legal actions than this
+#define ACTION_MAX	16
+
+static inline int action_discard (int card)
+{
+	return ACTION_DISCARD + card;
+}
+
+static inline int action_close (int card)
+{
+	return ACTION_CLOSE + card;
+}
+
+static inline bool action_is_draw (int action)
+{
+	return action < ACTION_DISCARD;
+}
+
+/*
+ * Card discarded by @action, or -1 if it draws one
+ */
+static inline int action_card (int action)
+{
+	if (action >= ACTION_CLOSE)
+		return action - ACTION_CLOSE;
+	if (action >= ACTION_DISCARD)
+		return action - ACTION_DISCARD;
+	return -1;
+}
+
+int action_get_legal (mask_t hand, bool deck, bool stack, int flexible_ending, int *ret);
+void action_format (int action, char *ret, int size);
+
+#endif
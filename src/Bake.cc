@@ -0,0 +1,179 @@
+/*
+ *
+ * Copyright 2023 Daniel Dwek
+ *
+ * This file is part of chin-chon-lin.
+ *
+ *  chin-chon-lin is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  chin-chon-lin is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with chin-chon-lin.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include <math.h>
+#include <string.h>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <vector>
+#include <cairo.h>
+#include <librsvg/rsvg.h>
+#include "Bundle.h"
+
+#define BAKE_FACES	48
+#define BAKE_BACK	48
+
+static const char *suitname[4] = { "clubs", "cups", "golds", "swords" };
+static const char *backname[4] = { "ar", "es", "gb", "us" };
+
+/*
+ * Parse the SVG of @asset from @dir and read the geometry of the card in
+ * it, exactly as Raster::open () does at runtime
+ */
+static RsvgHandle *open_asset (const char *dir, int asset, bundle_rect_t *ink, bundle_rect_t *logical)
+{
+	std::ostringstream filename, id;
+	RsvgDimensionData dim;
+	RsvgRectangle viewport, r1, r2;
+	RsvgHandle *h;
+
+	filename << dir << "/";
+	if (asset < BAKE_FACES) {
+		filename << suitname[asset / 12] << std::setw (2) << std::setfill ('0') << asset % 12 + 1 << ".svg";
+		id << "#" << suitname[asset / 12] << std::setw (2) << std::setfill ('0') << asset % 12 + 1;
+	} else {
+		filename << "deck-" << backname[asset - BAKE_BACK] << ".svg";
+		id << "#deck";
+	}
+
+	h = rsvg_handle_new_from_file (filename.str().c_str (), NULL);
+	if (!h) {
+		std::cerr << "Cannot load " << filename.str () << std::endl;
+		return nullptr;
+	}
+	rsvg_handle_set_dpi (h, 300.0);
+	rsvg_handle_get_dimensions (h, &dim);
+	viewport = { .0, .0, (double) dim.width, (double) dim.height };
+	rsvg_handle_get_geometry_for_layer (h, id.str().c_str (), &viewport, &r1, &r2, NULL);
+	*ink = { r1.x, r1.y, r1.width, r1.height };
+	*logical = { r2.x, r2.y, r2.width, r2.height };
+
+	return h;
+}
+
+/*
+ * Size of every image at board scale @s, taken from the backs the same way
+ * as Raster::get_cell ()
+ */
+static void get_cell (const bundle_header_t *header, double s, uint32_t *w, uint32_t *h)
+{
+	int cw = 0, ch = 0, n;
+
+	for (int i = BAKE_BACK; i < BUNDLE_ASSETS; i++) {
+		n = (int) ceil (fmax (header->ink[i].x + header->ink[i].width,
+				header->logical[i].x + header->logical[i].width) * 5.0 * s);
+		cw = n > cw ? n : cw;
+		n = (int) ceil (fmax (header->ink[i].y + header->ink[i].height,
+				header->logical[i].y + header->logical[i].height) * 5.0 * s);
+		ch = n > ch ? n : ch;
+	}
+	*w = cw > 0 ? cw : 1;
+	*h = ch > 0 ? ch : 1;
+}
+
+/*
+ * chin-chon-lin-bake renders every card face and deck back found in a
+ * directory at the standard scales of Bundle.h, and writes them all to a
+ * single file the game maps at runtime instead of parsing the SVGs
+ */
+int main (int argc, char *argv[])
+{
+	bundle_header_t header;
+	bundle_level_t level[BUNDLE_LEVELS];
+	RsvgHandle *handler[BUNDLE_ASSETS];
+	cairo_surface_t *surface;
+	cairo_t *cr;
+	std::vector<char> padding (BUNDLE_ALIGN, 0);
+	uint64_t offset;
+	int i, l, y, ret = 0;
+
+	if (argc != 3) {
+		std::cerr << "Usage: " << argv[0] << " TILES-DIR OUTPUT" << std::endl;
+		return 1;
+	}
+
+	memset (&header, 0, sizeof (header));
+	memcpy (header.magic, BUNDLE_MAGIC, sizeof (header.magic));
+	header.endian = 0x01020304;
+	header.assets = BUNDLE_ASSETS;
+	header.levels = BUNDLE_LEVELS;
+	for (i = 0; i < BUNDLE_ASSETS; i++) {
+		handler[i] = open_asset (argv[1], i, &header.ink[i], &header.logical[i]);
+		if (!handler[i])
+			ret = 1;
+	}
+	if (ret) {
+		for (i = 0; i < BUNDLE_ASSETS; i++)
+			if (handler[i])
+				g_object_unref (handler[i]);
+		return ret;
+	}
+
+	offset = sizeof (header) + sizeof (level);
+	for (l = 0; l < BUNDLE_LEVELS; l++) {
+		memset (&level[l], 0, sizeof (level[l]));
+		level[l].scale = bundle_scale[l];
+		get_cell (&header, bundle_scale[l], &level[l].width, &level[l].height);
+		level[l].stride = cairo_format_stride_for_width (CAIRO_FORMAT_ARGB32, level[l].width);
+		offset = (offset + BUNDLE_ALIGN - 1) / BUNDLE_ALIGN * BUNDLE_ALIGN;
+		level[l].offset = offset;
+		offset += (uint64_t) level[l].stride * level[l].height * BUNDLE_ASSETS;
+	}
+
+	std::ofstream out (argv[2], std::ios::binary | std::ios::trunc);
+	if (!out) {
+		std::cerr << "Cannot write " << argv[2] << std::endl;
+		ret = 1;
+	} else {
+		out.write ((const char *) &header, sizeof (header));
+		out.write ((const char *) level, sizeof (level));
+		offset = sizeof (header) + sizeof (level);
+	}
+
+	for (l = 0; l < BUNDLE_LEVELS && !ret; l++) {
+		out.write (padding.data (), level[l].offset - offset);
+		offset = level[l].offset;
+		for (i = 0; i < BUNDLE_ASSETS; i++) {
+			surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, level[l].width, level[l].height);
+			cr = cairo_create (surface);
+			cairo_scale (cr, 5.0 * level[l].scale, 5.0 * level[l].scale);
+			rsvg_handle_render_cairo (handler[i], cr);
+			cairo_destroy (cr);
+			cairo_surface_flush (surface);
+			for (y = 0; y < (int) level[l].height; y++)
+				out.write ((const char *) cairo_image_surface_get_data (surface) +
+					y * cairo_image_surface_get_stride (surface), level[l].stride);
+			offset += (uint64_t) level[l].stride * level[l].height;
+			cairo_surface_destroy (surface);
+		}
+	}
+
+	for (i = 0; i < BUNDLE_ASSETS; i++)
+		if (handler[i])
+			g_object_unref (handler[i]);
+	if (!ret && !out) {
+		std::cerr << "Cannot write " << argv[2] << std::endl;
+		ret = 1;
+	}
+
+	return ret;
+}
@@ -0,0 +1,386 @@
+/*
+ *
+ * Copyright 2023 Daniel Dwek
+ *
+ * This file is part of chin-chon-lin.
+ *
+ *  chin-chon-lin is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  chin-chon-lin is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with chin-chon-lin.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include <stdint.h>
+#include <vector>
+#include "Mask.h"
+#include "Meld.h"
+#include "Sim.h"
+
+class Batch {
+public:
+	Batch (int size);
+	Batch (Batch&) = delete;
+	Batch (Batch&&) = delete;
+	Batch& operator= (Batch&) = delete;
+	~Batch ();
+
+	int get_size () const;
+	int get_running () const;
+	mask_t get_hand (int game, int nplayer) const;
+	int get_points (int game, int nplayer) const;
+	int get_closer (int game) const;
+	int get_turns (int game) const;
+	void set_seed (int game, uint64_t seed);
+	void set_flexible_ending (int flexible_ending);
+
+	void deal ();
+	void step ();
+	void play (int max_turns);
+private:
+	uint64_t next (int game);
+
+	int size;
+	int flexible_ending;
+	int running;
+	std::vector<mask_t> hand[4];
+	std::vector<uint8_t> deck;
+	std::vector<uint8_t> pile;
+	std::vector<int> ndeck;
+	std::vector<int> npile;
+	std::vector<int> turn;
+	std::vector<int> turns;
+	std::vector<int> closer;
+	std::vector<uint8_t> over;
+	std::vector<uint8_t> source;
+	std::vector<uint64_t> seed;
+};
+
+// Deck and stack of game g are the arrays deck[i * size + g] and
+// pile[i * size + g] for i = 0..47, so that the same card position of
+// every game lies contiguous in memory
+#define DECK(i, g)	deck[(i) * size + (g)]
+#define PILE(i, g)	pile[(i) * size + (g)]
+
+// Least points and least loose cards of every set of cards of a single
+// suit, indexed by its 12 bits. Within one suit only stairs are possible
+typedef struct {
+	uint8_t deadwood[1 << 12];
+	uint8_t loose[1 << 12];
+} suit_table_t;
+
+static const suit_table_t *get_suit_table ()
+{
+	static const suit_table_t *table = [] () {
+		suit_table_t *t = new suit_table_t;
+
+		for (int m = 0; m < 1 << 12; m++) {
+			t->deadwood[m] = meld_deadwood (m);
+			t->loose[m] = meld_loose (m);
+		}
+		return t;
+	} ();
+
+	return table;
+}
+
+/*
+ * Least points and least loose cards of @hand, the same as meld_deadwood ()
+ * and meld_loose () give, for every way of setting aside a group for each
+ * number in @triples (those with three or more cards), and then stairs in
+ * every suit looked up in @t
+ */
+static void arrange_groups (const suit_table_t *t, mask_t hand, unsigned triples, int *deadwood, int *loose)
+{
+	int n, d, l;
+	mask_t same, sub;
+
+	if (!triples) {
+		d = t->deadwood[hand & MASK_SUIT] + t->deadwood[hand >> 12 & MASK_SUIT] +
+		    t->deadwood[hand >> 24 & MASK_SUIT] + t->deadwood[hand >> 36 & MASK_SUIT];
+		l = t->loose[hand & MASK_SUIT] + t->loose[hand >> 12 & MASK_SUIT] +
+		    t->loose[hand >> 24 & MASK_SUIT] + t->loose[hand >> 36 & MASK_SUIT];
+		*deadwood = d < *deadwood ? d : *deadwood;
+		*loose = l < *loose ? l : *loose;
+		return;
+	}
+
+	n = __builtin_ctz (triples);
+	triples &= triples - 1;
+	arrange_groups (t, hand, triples, deadwood, loose);
+	same = hand & MASK_NUMBER << n;
+	for (sub = same; sub; sub = (sub - 1) & same)
+		if (mask_count (sub) >= 3)
+			arrange_groups (t, hand & ~sub, triples, deadwood, loose);
+}
+
+/*
+ * meld_deadwood () and meld_loose () of @hand at once. Hands rarely hold
+ * three cards of a number, and then they are four table lookups each
+ */
+static inline void evaluate (const suit_table_t *t, mask_t hand, int *deadwood, int *loose)
+{
+	unsigned a = hand & MASK_SUIT, b = hand >> 12 & MASK_SUIT;
+	unsigned c = hand >> 24 & MASK_SUIT, d = hand >> 36 & MASK_SUIT;
+
+	*deadwood = *loose = 1000;
+	arrange_groups (t, hand, (a & b & c) | (a & b & d) | (a & c & d) | (b & c & d), deadwood, loose);
+}
+
+/*
+ * Many greedy bot-only rounds advanced in lockstep, for throughput: all of
+ * them are dealt at once and then step () plays one turn of every game
+ * still running, a phase at a time (choosing the source, drawing, closing,
+ * and then closing or discarding), each one a plain loop over the batch.
+ * Game state is kept in structure-of-arrays form rather than as one Sim
+ * per game, and hands are scored by per-suit tables rather than by the
+ * search of Meld.cc: only the numbers with three cards or more need any
+ * search, and the hand of eight cards is scored once for both closing and
+ * discarding.
+ *
+ * Every game plays exactly as a Sim seeded alike would, with the same
+ * shuffles and the same greedy choices
+ */
+Batch::Batch (int size)
+{
+	int i;
+
+	this->size = size > 0 ? size : 1;
+	flexible_ending = 0;
+	running = 0;
+	for (i = 0; i < 4; i++)
+		hand[i].assign (this->size, 0);
+	deck.assign (48 * this->size, 0);
+	pile.assign (48 * this->size, 0);
+	ndeck.assign (this->size, 0);
+	npile.assign (this->size, 0);
+	turn.assign (this->size, 0);
+	turns.assign (this->size, 0);
+	closer.assign (this->size, -1);
+	over.assign (this->size, 1);
+	source.assign (this->size, 0);
+	seed.assign (this->size, 0x9e3779b97f4a7c15ULL);
+}
+
+Batch::~Batch ()
+{
+}
+
+int Batch::get_size () const
+{
+	return size;
+}
+
+/*
+ * Number of games not over yet
+ */
+int Batch::get_running () const
+{
+	return running;
+}
+
+mask_t Batch::get_hand (int game, int nplayer) const
+{
+	return hand[nplayer][game];
+}
+
+int Batch::get_points (int game, int nplayer) const
+{
+	return meld_deadwood (hand[nplayer][game]);
+}
+
+int Batch::get_closer (int game) const
+{
+	return closer[game];
+}
+
+int Batch::get_turns (int game) const
+{
+	return turns[game];
+}
+
+void Batch::set_seed (int game, uint64_t seed)
+{
+	this->seed[game] = seed ? seed : 0x9e3779b97f4a7c15ULL;
+}
+
+void Batch::set_flexible_ending (int flexible_ending)
+{
+	this->flexible_ending = flexible_ending;
+}
+
+/*
+ * Same xorshift64* generator as Sim::next ()
+ */
+uint64_t Batch::next (int game)
+{
+	uint64_t s = seed[game];
+
+	s ^= s >> 12;
+	s ^= s << 25;
+	s ^= s >> 27;
+	seed[game] = s;
+	return s * 0x2545f4914f6cdd1dULL;
+}
+
+/*
+ * Shuffle a new deck for every game and deal it as Sim::deal () does
+ */
+void Batch::deal ()
+{
+	int i, j, g, tmp;
+
+	// The deck array holds the shuffled permutation until it is dealt
+	for (i = 0; i < 48; i++)
+		for (g = 0; g < size; g++)
+			DECK (i, g) = i;
+	for (i = 47; i > 0; i--)
+		for (g = 0; g < size; g++) {
+			j = next (g) % (i + 1);
+			tmp = DECK (i, g);
+			DECK (i, g) = DECK (j, g);
+			DECK (j, g) = tmp;
+		}
+
+	for (i = 0; i < 4; i++)
+		for (g = 0; g < size; g++)
+			hand[i][g] = 0;
+	for (i = 0; i < 28; i++)
+		for (g = 0; g < size; g++)
+			hand[i & 3][g] |= (mask_t) 1 << DECK (i, g);
+	for (g = 0; g < size; g++)
+		PILE (0, g) = DECK (28, g);
+	// Cards are drawn from the end of the deck, so reverse the rest
+	for (i = 0; i < 19 / 2; i++)
+		for (g = 0; g < size; g++) {
+			tmp = DECK (29 + i, g);
+			DECK (29 + i, g) = DECK (47 - i, g);
+			DECK (47 - i, g) = tmp;
+		}
+	for (i = 0; i < 19; i++)
+		for (g = 0; g < size; g++)
+			DECK (i, g) = DECK (29 + i, g);
+
+	for (g = 0; g < size; g++) {
+		npile[g] = 1;
+		ndeck[g] = 19;
+		turn[g] = 0;
+		turns[g] = 0;
+		closer[g] = -1;
+		over[g] = 0;
+	}
+	running = size;
+}
+
+/*
+ * Play one turn of every game still running
+ */
+void Batch::step ()
+{
+	int i, g, c, t, d, l, best, least, close, discard;
+	mask_t h, m;
+	const suit_table_t *table = get_suit_table ();
+
+	// Take the stack's top card when it lowers the points of the hand, as
+	// sim_greedy_source () does
+	for (g = 0; g < size; g++) {
+		if (over[g])
+			continue;
+		source[g] = 0;
+		if (!npile[g])
+			continue;
+		h = hand[turn[g]][g];
+		best = 1000;
+		for (m = h; m; m &= m - 1) {
+			evaluate (table, (h | (mask_t) 1 << PILE (npile[g] - 1, g)) & ~(m & -m), &d, &l);
+			best = d < best ? d : best;
+		}
+		evaluate (table, h, &d, &l);
+		source[g] = best < d;
+	}
+
+	for (g = 0; g < size; g++) {
+		if (over[g])
+			continue;
+		if (source[g] && npile[g]) {
+			c = PILE (--npile[g], g);
+		} else {
+			// Turn the stack over into the deck, as Sim::draw () does
+			if (!ndeck[g]) {
+				for (i = 0; i < npile[g]; i++)
+					DECK (i, g) = PILE (i, g);
+				ndeck[g] = npile[g];
+				npile[g] = 0;
+				for (i = ndeck[g] - 1; i > 0; i--) {
+					t = next (g) % (i + 1);
+					c = DECK (i, g);
+					DECK (i, g) = DECK (t, g);
+					DECK (t, g) = c;
+				}
+			}
+			if (!ndeck[g]) {
+				over[g] = 1;
+				running--;
+				continue;
+			}
+			c = DECK (--ndeck[g], g);
+		}
+		hand[turn[g]][g] |= (mask_t) 1 << c;
+	}
+
+	// Score the hand without each of its cards once, and either close with
+	// the card meld_can_close () would or discard the one
+	// sim_greedy_discard () would
+	for (g = 0; g < size; g++) {
+		if (over[g])
+			continue;
+		h = hand[turn[g]][g];
+		close = discard = -1;
+		best = least = 1000;
+		for (m = h; m; m &= m - 1) {
+			c = mask_first (m);
+			evaluate (table, h & ~((mask_t) 1 << c), &d, &l);
+			if (l <= (flexible_ending ? 1 : 0) && d < best) {
+				best = d;
+				close = c;
+			}
+			if (d < least || (d == least && c % 12 > discard % 12)) {
+				least = d;
+				discard = c;
+			}
+		}
+		if (close != -1) {
+			hand[turn[g]][g] &= ~((mask_t) 1 << close);
+			PILE (npile[g]++, g) = close;
+			closer[g] = turn[g];
+			over[g] = 1;
+			running--;
+			continue;
+		}
+		hand[turn[g]][g] &= ~((mask_t) 1 << discard);
+		PILE (npile[g]++, g) = discard;
+		turn[g] = (turn[g] + 1) & 3;
+		turns[g]++;
+	}
+}
+
+/*
+ * Play until every game is closed or @max_turns turns were played
+ */
+void Batch::play (int max_turns)
+{
+	int g, n;
+
+	for (n = 0; running && n < max_turns; n++)
+		step ();
+	for (g = 0; g < size; g++)
+		over[g] = 1;
+	running = 0;
+}
@@ -0,0 +1,66 @@
+/*
+ *
+ * Copyright 2023 Daniel Dwek
+ *
+ * This file is part of chin-chon-lin.
+ *
+ *  chin-chon-lin is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  chin-chon-lin is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with chin-chon-lin.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#ifndef _BATCH_H_
+#define _BATCH_H_
+#include <stdint.h>
+#include <vector>
+#include "Mask.h"
+
+class Batch {
+public:
+	Batch (int size);
+	Batch (Batch&) = delete;
+	Batch (Batch&&) = delete;
+	Batch& operator= (Batch&) = delete;
+	~Batch ();
+
+	int get_size () const;
+	int get_running () const;
+	mask_t get_hand (int game, int nplayer) const;
+	int get_points (int game, int nplayer) const;
+	int get_closer (int game) const;
+	int get_turns (int game) const;
+	void set_seed (int game, uint64_t seed);
+	void set_flexible_ending (int flexible_ending);
+
+	void deal ();
+	void step ();
+	void play (int max_turns);
+private:
+	uint64_t next (int game);
+
+	int size;
+	int flexible_ending;
+	int running;
+	std::vector<mask_t> hand[4];
+	std::vector<uint8_t> deck;
+	std::vector<uint8_t> pile;
+	std::vector<int> ndeck;
+	std::vector<int> npile;
+	std::vector<int> turn;
+	std::vector<int> turns;
+	std::vector<int> closer;
+	std::vector<uint8_t> over;
+	std::vector<uint8_t> source;
+	std::vector<uint64_t> seed;
+};
+
+#endif
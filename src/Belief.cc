@@ -0,0 +1,431 @@
+/*
+ *
+ * Copyright 2023 Daniel Dwek
+ *
+ * This file is part of chin-chon-lin.
+ *
+ *  chin-chon-lin is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  chin-chon-lin is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with chin-chon-lin.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include <stdlib.h>
+#include <stdint.h>
+#include "Mask.h"
+
+#define BELIEF_PARTICLES 128
+
+// Every hand guessed by one player, frozen at some point of the round
+typedef struct {
+	mask_t particle[4][BELIEF_PARTICLES];
+	double weight[4][BELIEF_PARTICLES];
+} belief_view_t;
+
+class Belief {
+public:
+	Belief ();
+	Belief (Belief&) = delete;
+	Belief (Belief&&) = delete;
+	Belief& operator= (Belief&) = delete;
+	~Belief ();
+
+	bool is_ready () const;
+
+	void reset (const mask_t *hands, mask_t top);
+	void on_draw (int nplayer, mask_t card, mask_t top);
+	void on_pickup (int nplayer, mask_t card);
+	void on_discard (int nplayer, mask_t card);
+	void on_reshuffle ();
+	int sample (int observer, int nplayer, mask_t *ret, int n);
+	void get_view (int observer, belief_view_t *ret) const;
+	double get_probability (int observer, int nplayer, mask_t cards) const;
+	double get_usefulness (int observer, int nplayer, int suit, int number) const;
+private:
+	mask_t get_pool (int observer, int nplayer) const;
+	mask_t draw (mask_t pool, int n);
+	void repair ();
+	void resample (int observer, int nplayer);
+	uint64_t next ();
+
+	mask_t own[4];
+	mask_t held[4];
+	mask_t pile;
+	mask_t particle[4][4][BELIEF_PARTICLES];
+	double weight[4][4][BELIEF_PARTICLES];
+	uint64_t seed;
+	bool ready;
+};
+
+// Likelihood of each action given a hypothetical hand, relative to the
+// most natural choice for that hand
+#define DECLINE_USEFUL	0.3
+#define PICKUP_USELESS	0.4
+#define DISCARD_USEFUL	0.25
+
+Belief::Belief ()
+{
+	seed = 0x9e3779b97f4a7c15ULL;
+	ready = false;
+}
+
+Belief::~Belief ()
+{
+}
+
+bool Belief::is_ready () const
+{
+	return ready;
+}
+
+/*
+ * Start a new round: @hands are the cards dealt to every player and @top
+ * is the card turned face up on the stack. From the point of view of each
+ * player, every opponent's hand is sampled uniformly among the cards that
+ * player cannot see
+ */
+void Belief::reset (const mask_t *hands, mask_t top)
+{
+	int i, o, j;
+
+	seed ^= (uint64_t) rand () << 16 | 1;
+	pile = top;
+	for (i = 0; i < 4; i++) {
+		own[i] = hands[i];
+		held[i] = 0;
+	}
+
+	for (o = 0; o < 4; o++) {
+		for (j = 0; j < 4; j++) {
+			if (o == j)
+				continue;
+			for (i = 0; i < BELIEF_PARTICLES; i++) {
+				particle[o][j][i] = draw (get_pool (o, j), mask_count (hands[j]));
+				weight[o][j][i] = 1.0;
+			}
+		}
+	}
+	ready = true;
+}
+
+/*
+ * @nplayer took @card from the deck, thus declining @top from the stack
+ * (if any). Hands that would have used @top become less likely, and every
+ * sampled hand receives one more unknown card
+ */
+void Belief::on_draw (int nplayer, mask_t card, mask_t top)
+{
+	int o, i, t = top ? mask_first (top) : -1;
+
+	if (!ready)
+		return;
+
+	own[nplayer] |= card;
+	for (o = 0; o < 4; o++) {
+		if (o == nplayer)
+			continue;
+		for (i = 0; i < BELIEF_PARTICLES; i++) {
+			mask_t& p = particle[o][nplayer][i];
+
+			if (t != -1 && mask_useful (p, t / 12, t % 12 + 1))
+				weight[o][nplayer][i] *= DECLINE_USEFUL;
+			p |= draw (get_pool (o, nplayer) & ~p, 1);
+		}
+		resample (o, nplayer);
+	}
+	repair ();
+}
+
+/*
+ * @nplayer took @card from the stack. It is now a known card of that hand,
+ * and it most likely completed a combo
+ */
+void Belief::on_pickup (int nplayer, mask_t card)
+{
+	int o, i, c = mask_first (card);
+
+	if (!ready)
+		return;
+
+	own[nplayer] |= card;
+	held[nplayer] |= card;
+	pile &= ~card;
+	for (o = 0; o < 4; o++) {
+		if (o == nplayer)
+			continue;
+		for (i = 0; i < BELIEF_PARTICLES; i++) {
+			mask_t& p = particle[o][nplayer][i];
+
+			if (!mask_useful (p, c / 12, c % 12 + 1))
+				weight[o][nplayer][i] *= PICKUP_USELESS;
+			p |= card;
+		}
+		resample (o, nplayer);
+	}
+	repair ();
+}
+
+/*
+ * @nplayer discarded @card. Sampled hands which did not contain it get it
+ * in place of one of their unknown cards, so no hand has to be rejected.
+ * Hands where @card was making a combo are unlikely to be the real one
+ */
+void Belief::on_discard (int nplayer, mask_t card)
+{
+	int o, i, n, c = mask_first (card);
+	mask_t hidden;
+
+	if (!ready)
+		return;
+
+	own[nplayer] &= ~card;
+	held[nplayer] &= ~card;
+	for (o = 0; o < 4; o++) {
+		if (o == nplayer)
+			continue;
+		for (i = 0; i < BELIEF_PARTICLES; i++) {
+			mask_t& p = particle[o][nplayer][i];
+
+			if (!(p & card)) {
+				hidden = p & ~held[nplayer];
+				if ((n = mask_count (hidden)) > 0)
+					p &= ~((mask_t) 1 << mask_select (hidden, next () % n));
+				p |= card;
+			}
+			if (mask_useful (p & ~card, c / 12, c % 12 + 1))
+				weight[o][nplayer][i] *= DISCARD_USEFUL;
+			p &= ~card;
+		}
+		resample (o, nplayer);
+	}
+	pile |= card;
+	repair ();
+}
+
+/*
+ * Played cards went back into the deck, so they can be drawn again
+ */
+void Belief::on_reshuffle ()
+{
+	pile = 0;
+}
+
+/*
+ * Pick @n of the BELIEF_PARTICLES hands in @particle in proportion to
+ * their @weight, all of them at once at regular steps starting from @u,
+ * a fraction of the first step
+ */
+static void pick (const mask_t *particle, const double *weight, mask_t *ret, int n, double u)
+{
+	int i, k;
+	double total = 0.0, step, acc;
+
+	for (i = 0; i < BELIEF_PARTICLES; i++)
+		total += weight[i];
+	step = total / n;
+	u *= step;
+	acc = weight[0];
+	for (i = 0, k = 0; k < n; k++, u += step) {
+		while (acc < u && i < BELIEF_PARTICLES - 1)
+			acc += weight[++i];
+		ret[k] = particle[i];
+	}
+}
+
+/*
+ * Copy @n hands of @nplayer, as guessed by @observer, into @ret. Hands are
+ * picked in proportion to their weights, so plain averages over @ret are
+ * expectations under the current belief
+ */
+int Belief::sample (int observer, int nplayer, mask_t *ret, int n)
+{
+	if (!ready || !ret || n <= 0 || observer == nplayer)
+		return 0;
+
+	pick (particle[observer][nplayer], weight[observer][nplayer], ret, n,
+	      (next () >> 11) * (1.0 / 9007199254740992.0));
+
+	return n;
+}
+
+/*
+ * Copy every hand guessed by @observer into @ret, to be sampled later with
+ * belief_sample () without going through (and advancing) the generator
+ * the bots sample from
+ */
+void Belief::get_view (int observer, belief_view_t *ret) const
+{
+	for (int j = 0; j < 4; j++) {
+		for (int i = 0; i < BELIEF_PARTICLES; i++) {
+			ret->particle[j][i] = j != observer ? particle[observer][j][i] : 0;
+			ret->weight[j][i] = j != observer ? weight[observer][j][i] : 0.0;
+		}
+	}
+}
+
+/*
+ * Belief::sample () on a view saved by Belief::get_view (), with steps
+ * starting at random from the caller's own xorshift64* generator @seed.
+ * Without @seed they start halfway, so sampling the same view always gives
+ * the same hands
+ */
+int belief_sample (const belief_view_t *view, int nplayer, mask_t *ret, int n, uint64_t *seed)
+{
+	uint64_t s;
+	double u = 0.5;
+
+	if (!ret || n <= 0)
+		return 0;
+
+	if (seed) {
+		s = *seed ? *seed : 0x9e3779b97f4a7c15ULL;
+		s ^= s >> 12;
+		s ^= s << 25;
+		s ^= s >> 27;
+		*seed = s;
+		u = ((s * 0x2545f4914f6cdd1dULL) >> 11) * (1.0 / 9007199254740992.0);
+	}
+	pick (view->particle[nplayer], view->weight[nplayer], ret, n, u);
+
+	return n;
+}
+
+/*
+ * Probability, according to @observer, that @nplayer holds any of @cards
+ */
+double Belief::get_probability (int observer, int nplayer, mask_t cards) const
+{
+	double total = 0.0, hit = 0.0;
+
+	if (!ready || observer == nplayer)
+		return 0.0;
+
+	for (int i = 0; i < BELIEF_PARTICLES; i++) {
+		total += weight[observer][nplayer][i];
+		if (particle[observer][nplayer][i] & cards)
+			hit += weight[observer][nplayer][i];
+	}
+
+	return total > 0.0 ? hit / total : 0.0;
+}
+
+/*
+ * Probability, according to @observer, that the card of @suit and @number
+ * would complete a combo for @nplayer
+ */
+double Belief::get_usefulness (int observer, int nplayer, int suit, int number) const
+{
+	double total = 0.0, hit = 0.0;
+
+	if (!ready || observer == nplayer)
+		return 0.0;
+
+	for (int i = 0; i < BELIEF_PARTICLES; i++) {
+		total += weight[observer][nplayer][i];
+		if (mask_useful (particle[observer][nplayer][i], suit, number))
+			hit += weight[observer][nplayer][i];
+	}
+
+	return total > 0.0 ? hit / total : 0.0;
+}
+
+/*
+ * Cards that @observer cannot see and that could be in @nplayer's hand
+ */
+mask_t Belief::get_pool (int observer, int nplayer) const
+{
+	mask_t pool = MASK_ALL & ~own[observer] & ~pile;
+
+	for (int k = 0; k < 4; k++)
+		if (k != nplayer)
+			pool &= ~held[k];
+	return pool;
+}
+
+/*
+ * Pick @n different cards uniformly at random from @pool. Every card is
+ * chosen by its rank among the remaining ones, so there is no rejection
+ * loop no matter how sparse @pool is
+ */
+mask_t Belief::draw (mask_t pool, int n)
+{
+	int size;
+	mask_t ret = 0, bit;
+
+	while (n-- > 0 && (size = mask_count (pool)) > 0) {
+		bit = (mask_t) 1 << mask_select (pool, next () % size);
+		ret |= bit;
+		pool &= ~bit;
+	}
+
+	return ret;
+}
+
+/*
+ * Replace cards of sampled hands that became visible to the observer (own
+ * own draws, cards played or taken from the stack by somebody else)
+ */
+void Belief::repair ()
+{
+	int o, j, i;
+	mask_t visible, bad;
+
+	for (o = 0; o < 4; o++) {
+		for (j = 0; j < 4; j++) {
+			if (o == j)
+				continue;
+			visible = ~get_pool (o, j) & ~held[j];
+			for (i = 0; i < BELIEF_PARTICLES; i++) {
+				mask_t& p = particle[o][j][i];
+
+				if ((bad = p & visible) != 0) {
+					p &= ~bad;
+					p |= draw (get_pool (o, j) & ~p, mask_count (bad));
+				}
+			}
+		}
+	}
+}
+
+/*
+ * Systematic resampling, done only when too few hands carry most of the
+ * weight (effective sample size below one half)
+ */
+void Belief::resample (int observer, int nplayer)
+{
+	int i;
+	double total = 0.0, sq = 0.0;
+	mask_t tmp[BELIEF_PARTICLES];
+
+	for (i = 0; i < BELIEF_PARTICLES; i++) {
+		total += weight[observer][nplayer][i];
+		sq += weight[observer][nplayer][i] * weight[observer][nplayer][i];
+	}
+	if (total <= 0.0 || total * total >= sq * BELIEF_PARTICLES / 2.0)
+		return;
+
+	sample (observer, nplayer, tmp, BELIEF_PARTICLES);
+	for (i = 0; i < BELIEF_PARTICLES; i++) {
+		particle[observer][nplayer][i] = tmp[i];
+		weight[observer][nplayer][i] = 1.0;
+	}
+}
+
+/*
+ * xorshift64* generator: cheap and good enough for sampling hands
+ */
+uint64_t Belief::next ()
+{
+	seed ^= seed >> 12;
+	seed ^= seed << 25;
+	seed ^= seed >> 27;
+	return seed * 0x2545f4914f6cdd1dULL;
+}
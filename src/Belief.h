@@ -0,0 +1,73 @@
+/*
+ *
+ * Copyright 2023 Daniel Dwek
+ *
+ * This file is part of chin-chon-lin.
+ *
+ *  chin-chon-lin is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  chin-chon-lin is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with chin-chon-lin.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#ifndef _BELIEF_H_
+#define _BELIEF_H_
+#include <stdint.h>
+#include "Mask.h"
+
+#define BELIEF_PARTICLES 128
+
+// Every hand guessed by one player, frozen at some point of the round
+typedef struct {
+	mask_t particle[4][BELIEF_PARTICLES];
+	double weight[4][BELIEF_PARTICLES];
+} belief_view_t;
+
+class Belief {
+public:
+	Belief ();
+	Belief (Belief&) = delete;
+	Belief (Belief&&) = delete;
+	Belief& operator= (Belief&) = delete;
+	~Belief ();
+
+	bool is_ready () const;
+
+	void reset (const mask_t *hands, mask_t top);
+	void on_draw (int nplayer, mask_t card, mask_t top);
+	void on_pickup (int nplayer, mask_t card);
+	void on_discard (int nplayer, mask_t card);
+	void on_reshuffle ();
+	int sample (int observer, int nplayer, mask_t *ret, int n);
+	void get_view (int observer, belief_view_t *ret) const;
+	double get_probability (int observer, int nplayer, mask_t cards) const;
+	double get_usefulness (int observer, int nplayer, int suit, int number) const;
+private:
+	mask_t get_pool (int observer, int nplayer) const;
+	mask_t draw (mask_t pool, int n);
+	void repair ();
+	void resample (int observer, int nplayer);
+	uint64_t next ();
+
+	mask_t own[4];
+	mask_t held[4];
+	mask_t pile;
+	mask_t particle[4][4][BELIEF_PARTICLES];
+	double weight[4][4][BELIEF_PARTICLES];
+	uint64_t seed;
+	bool ready;
+};
+
+int belief_sample (const belief_view_t *view, int nplayer, mask_t *ret, int n, uint64_t *seed);
+
+extern class Belief belief;
+
+#endif
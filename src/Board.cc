@@ -21,6 +21,7 @@
 #include "gettext.h"
 #define _(String) gettext (String)
 #include <string>
+#include <math.h>
 #include <gtk/gtk.h>
 #include <cairo.h>
 #include "Cmdline.h"
@@ -30,6 +31,12 @@
 #include "Deck.h"
 #include "Stack.h"
 #include "Card.h"
+#include "Tracker.h"
+#include "Belief.h"
+#include "Round.h"
+#include "Hint.h"
+#include "Review.h"
+#include "Hud.h"
 
 typedef enum { IDLE = 0, DECK_DISTRIBUTE,
 		DECK_TO_PLAYER_START, DECK_TO_PLAYER_STOP,
@@ -41,7 +48,7 @@ typedef enum { IDLE = 0, DECK_DISTRIBUTE,
 
 class Board {
 public:
-	Board (int w, int h, double xs, double ys, double frames);
+	Board (int w, int h, double xs, double ys);
 	~Board ();
 
 	int get_turn () const;
@@ -50,9 +57,11 @@ public:
 	int get_height () const;
 	double get_x_scale () const;
 	double get_y_scale () const;
-	double get_framerate () const;
 	cairo_surface_t *get_surface () const;
 	cairo_t *get_cr () const;
+	cairo_surface_t *get_sprite_surface () const;
+	cairo_t *get_sprite_cr () const;
+	bool is_stale () const;
 	bool get_display_scores () const;
 	bool get_reset () const;
 
@@ -62,13 +71,18 @@ public:
 	void set_height (int h);
 	void set_x_scale (double xs);
 	void set_y_scale (double ys);
-	void set_framerate (double f);
 	void set_surface (cairo_surface_t *surface);
 	void set_cr (cairo_t *cr);
+	void set_sprite_surface (cairo_surface_t *sprite_surface);
+	void set_sprite_cr (cairo_t *sprite_cr);
+	void set_stale (bool stale);
 	void set_display_scores (bool display_scores);
 	void set_reset (bool reset);
 
+	void damage (double x, double y, double w, double h);
+	void damage_all ();
 	void paint (cairo_t *cr);
+	void compose (cairo_t *cr);
 	void new_game ();
 	void new_round (cairo_t *cr);
 private:
@@ -78,35 +92,35 @@ private:
 	int height;
 	double x_scale;
 	double y_scale;
-	double framerate;
 	cairo_surface_t *surface;
 	cairo_t *cr;
+	cairo_surface_t *sprite_surface;
+	cairo_t *sprite_cr;
+	bool stale;
 	bool display_scores;
 	bool reset;
 };
 
 extern GtkWidget *window;
 extern GtkWidget *drawing_area;
-extern unsigned deck_dist_tid, play_card_tid;
-extern unsigned stack_to_player_tid, deck_to_player_tid;
-extern unsigned player_ending_round_tid;
 extern class Cmdline cmdline;
 extern class Board board;
 extern class Player player[4];
 extern class Deck deck;
 extern class StackPlayed stack_played;
-extern gboolean on_deck_distribute_cb (GtkWidget *widget, GdkFrameClock *frame_clock, gpointer data);
 
-Board::Board (int w, int h, double xs, double ys, double frames)
+Board::Board (int w, int h, double xs, double ys)
 {
 	turn = 0;
 	width = w;
 	height = h;
 	x_scale = xs;
 	y_scale = ys;
-	framerate = frames;
 	surface = nullptr;
 	cr = nullptr;
+	sprite_surface = nullptr;
+	sprite_cr = nullptr;
+	stale = true;
 }
 
 Board::~Board ()
@@ -143,11 +157,6 @@ double Board::get_y_scale () const
 	return y_scale;
 }
 
-double Board::get_framerate () const
-{
-	return framerate;
-}
-
 cairo_surface_t *Board::get_surface () const
 {
 	return surface;
@@ -158,6 +167,21 @@ cairo_t *Board::get_cr () const
 	return cr;
 }
 
+cairo_surface_t *Board::get_sprite_surface () const
+{
+	return sprite_surface;
+}
+
+cairo_t *Board::get_sprite_cr () const
+{
+	return sprite_cr;
+}
+
+bool Board::is_stale () const
+{
+	return stale;
+}
+
 bool Board::get_display_scores () const
 {
 	return display_scores;
@@ -198,11 +222,6 @@ void Board::set_y_scale (double ys)
 	y_scale = ys;
 }
 
-void Board::set_framerate (double f)
-{
-	framerate = f;
-}
-
 void Board::set_surface (cairo_surface_t *surface)
 {
 	this->surface = surface;
@@ -213,6 +232,21 @@ void Board::set_cr (cairo_t *cr)
 	this->cr = cr;
 }
 
+void Board::set_sprite_surface (cairo_surface_t *sprite_surface)
+{
+	this->sprite_surface = sprite_surface;
+}
+
+void Board::set_sprite_cr (cairo_t *sprite_cr)
+{
+	this->sprite_cr = sprite_cr;
+}
+
+void Board::set_stale (bool stale)
+{
+	this->stale = stale;
+}
+
 void Board::set_display_scores (bool display_scores)
 {
 	this->display_scores = display_scores;
@@ -223,14 +257,85 @@ void Board::set_reset (bool reset)
 	this->reset = reset;
 }
 
+/*
+ * Queue the redraw of just a rectangle of the board, rounded outwards to
+ * whole pixels plus one of margin for antialiased edges
+ */
+void Board::damage (double x, double y, double w, double h)
+{
+	int x1 = (int) floor (x) - 1;
+	int y1 = (int) floor (y) - 1;
+	int x2 = (int) ceil (x + w) + 1;
+	int y2 = (int) ceil (y + h) + 1;
+
+	gtk_widget_queue_draw_area (drawing_area, x1, y1, x2 - x1, y2 - y1);
+}
+
+/*
+ * Queue the redraw of the whole board. Since it is asked for whenever the
+ * state of the game changes, the background layer is rebuilt as well
+ */
+void Board::damage_all ()
+{
+	stale = true;
+	gtk_widget_queue_draw (drawing_area);
+}
+
 void Board::paint (cairo_t *cr)
 {
 	struct _GdkRGBA bgcolor = { 0.2, 0.3, 0.2, 1.0 };
 
+	hud.begin (HUD_PAINT);
 	cairo_save (cr);
 	gdk_cairo_set_source_rgba (cr, &bgcolor);
 	cairo_paint (cr);
 	cairo_restore (cr);
+	hud.end (HUD_PAINT);
+}
+
+/*
+ * The board is drawn in two layers: a background retained in @surface
+ * with everything at rest (felt, hands, deck, names and stack), which is
+ * only rebuilt when stale, and on top of it @sprite_surface, holding
+ * whatever is moving in the current frame
+ */
+void Board::compose (cairo_t *cr)
+{
+	int i;
+
+	if (stale) {
+		bool reshuffle = !deck.get_cards().size ();
+
+		paint (this->cr);
+		for (i = 0; i < 7; i++) {
+			player[0].draw (this->cr, i);
+			player[1].draw (this->cr, i);
+			player[2].draw (this->cr, i);
+			player[3].draw (this->cr, i);
+		}
+		for (i = 0; i < 4; i++)
+			if (player[i].has_extra_card ()) {
+				player[i].draw (this->cr, 7);
+				break;
+			}
+		deck.draw (this->cr);
+		for (i = 0; i < 4; i++)
+			player[i].render_name (this->cr);
+		stack_played.draw (this->cr);
+		stale = false;
+
+		// Drawing the empty deck turns the stack over, which is only
+		// seen once the background is rebuilt again
+		if (reshuffle)
+			damage_all ();
+	}
+
+	cairo_save (cr);
+	cairo_set_source_surface (cr, surface, 0, 0);
+	cairo_paint (cr);
+	cairo_set_source_surface (cr, sprite_surface, 0, 0);
+	cairo_paint (cr);
+	cairo_restore (cr);
 }
 
 void Board::new_game ()
@@ -247,6 +352,10 @@ void Board::new_game ()
 	logic.set_max_total_points (*(int *) g_variant_get_data (v));
 	v = g_settings_get_value (settings, "flex-end");
 	logic.set_flexible_ending (*(int *) g_variant_get_data (v));
+	v = g_settings_get_value (settings, "difficulty");
+	logic.set_difficulty (*(int *) g_variant_get_data (v));
+	v = g_settings_get_value (settings, "hints");
+	hint.set_enabled (*(int *) g_variant_get_data (v));
 	v = g_settings_get_value (settings, "deck-pixbuf");
 	deck.set_cc (*(char **) g_variant_get_data_as_bytes (v));
 
@@ -258,12 +367,19 @@ void Board::new_game ()
 	}
 }
 
+/*
+ * Start a new round. This is a pure in-memory reset, so that the gap
+ * between closing the table of scores and seeing the new deal stays short:
+ * the images of the cards are owned by the raster and referred to by
+ * asset number, so nothing is read from disk or parsed here. The shuffle,
+ * the deal and the guesses of the bots are all left to round_new (), and
+ * the cards are just laid out in the order it dealt them
+ */
 void Board::new_round (cairo_t *cr)
 {
 	int i;
+	round_t round;
 	std::string name[4] = { _("Human"), "Bot_1", "Bot_2", "Bot_3" };
-	std::list<Card>::iterator iter1, iter2;
-	std::list<Card> swapped_list;
 	static bool done = false;
 
 	if (reset)
@@ -276,18 +392,14 @@ void Board::new_round (cairo_t *cr)
 	ui.clear_all ();
 	deck.get_cards().clear ();
 	stack_played.get_cards().clear ();
+	tracker.reset ();
+	review.reset ();
+	logic.cancel_ponder ();
+	round_new (&round, &belief);
 	for (i = 0; i < 48; i++) {
-		card[i].init (i / 12, i % 12 + 1);
-		deck.acquire (card[i]);
-	}
-	swapped_list = deck.get_cards ();
-	for (iter1 = swapped_list.begin (); iter1 != swapped_list.end (); iter1++) {
-		int n = rand () % 48;
-		for (i = 0, iter2 = iter1; iter2 != swapped_list.end (); iter2++, i++)
-			if (i == n)
-				std::iter_swap (iter1, iter2);
+		card[round.perm[i]].init (round.perm[i] / 12, round.perm[i] % 12 + 1);
+		deck.acquire (card[round.perm[i]]);
 	}
-	deck.set_cards (swapped_list);
 	deck.unlock ("deck", -1);
 
 	for (i = 0; i < 4; i++) {
@@ -34,7 +34,7 @@ typedef enum { IDLE = 0, DECK_DISTRIBUTE,
 
 class Board {
 public:
-	Board (int w, int h, double xs, double ys, double frames);
+	Board (int w, int h, double xs, double ys);
 	~Board ();
 
 	int get_turn () const;
@@ -43,9 +43,11 @@ public:
 	int get_height () const;
 	double get_x_scale () const;
 	double get_y_scale () const;
-	double get_framerate () const;
 	cairo_surface_t *get_surface () const;
 	cairo_t *get_cr () const;
+	cairo_surface_t *get_sprite_surface () const;
+	cairo_t *get_sprite_cr () const;
+	bool is_stale () const;
 	bool get_display_scores () const;
 	bool get_reset () const;
 
@@ -55,13 +57,18 @@ public:
 	void set_height (int h);
 	void set_x_scale (double xs);
 	void set_y_scale (double ys);
-	void set_framerate (double f);
 	void set_surface (cairo_surface_t *surface);
 	void set_cr (cairo_t *cr);
+	void set_sprite_surface (cairo_surface_t *sprite_surface);
+	void set_sprite_cr (cairo_t *sprite_cr);
+	void set_stale (bool stale);
 	void set_display_scores (bool display_scores);
 	void set_reset (bool reset);
 
+	void damage (double x, double y, double w, double h);
+	void damage_all ();
 	void paint (cairo_t *cr);
+	void compose (cairo_t *cr);
 	void new_game ();
 	void new_round (cairo_t *cr);
 private:
@@ -71,9 +78,11 @@ private:
 	int height;
 	double x_scale;
 	double y_scale;
-	double framerate;
 	cairo_surface_t *surface;
 	cairo_t *cr;
+	cairo_surface_t *sprite_surface;
+	cairo_t *sprite_cr;
+	bool stale;
 	bool display_scores;
 	bool reset;
 };
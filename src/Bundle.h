@@ -0,0 +1,68 @@
+/*
+ *
+ * Copyright 2023 Daniel Dwek
+ *
+ * This file is part of chin-chon-lin.
+ *
+ *  chin-chon-lin is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  chin-chon-lin is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with chin-chon-lin.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#ifndef _BUNDLE_H_
+#define _BUNDLE_H_
+#include <stdint.h>
+
+/*
+ * Layout of data/tiles/cards.raster, the optional bundle of every card
+ * face and deck back pre-rendered at a few standard board scales by
+ * chin-chon-lin-bake. The file is mapped as is, so it holds the images in
+ * the very format cairo draws from (premultiplied ARGB32, native byte
+ * order) and only makes sense on the kind of machine it was built on.
+ *
+ * It starts with a bundle_header_t, followed by BUNDLE_LEVELS
+ * bundle_level_t, each one pointing to the 52 images of its scale laid
+ * out one after the other in the order of the raster assets
+ */
+#define BUNDLE_MAGIC	"CCLRAST1"
+#define BUNDLE_ASSETS	52
+#define BUNDLE_LEVELS	4
+#define BUNDLE_ALIGN	64
+
+static const double bundle_scale[BUNDLE_LEVELS] = { 1.0, 1.5, 2.0, 3.0 };
+
+typedef struct {
+	double x;
+	double y;
+	double width;
+	double height;
+} bundle_rect_t;
+
+typedef struct {
+	char magic[8];
+	uint32_t endian;	// 0x01020304 when read in the right byte order
+	uint32_t assets;
+	uint32_t levels;
+	uint32_t reserved;
+	bundle_rect_t ink[BUNDLE_ASSETS];
+	bundle_rect_t logical[BUNDLE_ASSETS];
+} bundle_header_t;
+
+typedef struct {
+	double scale;
+	uint32_t width;		// of every image, in pixels
+	uint32_t height;
+	uint32_t stride;
+	uint32_t reserved;
+	uint64_t offset;	// of the first image, from the start of the file
+} bundle_level_t;
+#endif
@@ -20,16 +20,13 @@
  */
 #include "gettext.h"
 #define _(String) gettext (String)
-#include <sstream>
-#include <iomanip>
 #include <math.h>
 #include <gtk/gtk.h>
 #include <cairo.h>
 #include "Logic.h"
 #include "Board.h"
 #include "Tile.h"
-
-static std::string suitname[4] = { _("clubs"), _("cups"), _("golds"), _("swords") };
+#include "Raster.h"
 
 class Card : public Tile {
 public:
@@ -105,22 +102,16 @@ void Card::set_number (int number)
 
 void Card::init (int suit, int number)
 {
-	std::ostringstream filename, svg_id;
-
-	filename << CHIN_CHON_LIN_DATADIR << "data/tiles/";
-	filename << suitname[suit] << std::setw (2) << std::setfill ('0') << number << ".svg";
-	svg_id << "#" << suitname[suit] << std::setw (2) << std::setfill ('0') << number;
-
 	x = .0;
 	y = .0;
 	w = .0;
 	h = .0;
 	this->suit = suit;
 	this->number = number;
+	asset = suit * 12 + number - 1;
 
-	gfile = g_file_new_for_path (filename.str().c_str ());
-	handler = rsvg_handle_new_from_gfile_sync (gfile, RSVG_HANDLE_FLAGS_NONE, NULL, NULL);
-	rsvg_handle_set_dpi (handler, 300);
-	rsvg_handle_get_geometry_for_layer (handler, svg_id.str().c_str (), &viewport, NULL, &logical, NULL);
+	// Faces are only parsed by the raster once shown, all of them being
+	// as big as a back anyway
+	logical = raster.get_logical (RASTER_BACK);
 	displayed = false;
 }
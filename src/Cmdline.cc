@@ -35,12 +35,18 @@ public:
 
 	bool is_testing_file () const;
 	bool is_debug_mode () const;
+	bool is_review_mode () const;
+	bool is_hud_mode () const;
 	void set_testing_file (bool testing_file);
 	void set_debug_mode (bool debug);
+	void set_review_mode (bool review);
+	void set_hud_mode (bool hud);
 	void parse_cmdline_options (int *argc, char ***argv);
 private:
 	bool testing_file;
 	bool debug;
+	bool review;
+	bool hud;
 };
 
 extern class Cmdline cmdline;
@@ -63,6 +69,16 @@ bool Cmdline::is_debug_mode () const
 	return debug;
 }
 
+bool Cmdline::is_review_mode () const
+{
+	return review;
+}
+
+bool Cmdline::is_hud_mode () const
+{
+	return hud;
+}
+
 void Cmdline::set_testing_file (bool testing_file)
 {
 	this->testing_file = testing_file;
@@ -77,6 +93,24 @@ void Cmdline::set_debug_mode (bool debug)
 	this->debug = debug;
 }
 
+/*
+ * At the end of every round, search again each move played by anybody and
+ * report on the console those which lost expected points
+ */
+void Cmdline::set_review_mode (bool review)
+{
+	this->review = review;
+}
+
+/*
+ * Show the timing overlay from the start. It can also be toggled at any
+ * time with F3
+ */
+void Cmdline::set_hud_mode (bool hud)
+{
+	this->hud = hud;
+}
+
 /*
  * Parse special text files used as input files for manual testing.
  * Such files live under "test/" subdirectory and you can use them
@@ -135,6 +169,18 @@ static bool debug_mode_cb ()
 	return true;
 }
 
+static bool review_mode_cb ()
+{
+	cmdline.set_review_mode (true);
+	return true;
+}
+
+static bool hud_mode_cb ()
+{
+	cmdline.set_hud_mode (true);
+	return true;
+}
+
 void Cmdline::parse_cmdline_options (int *argc, char ***argv)
 {
 	GOptionContext *context = nullptr;
@@ -143,6 +189,10 @@ void Cmdline::parse_cmdline_options (int *argc, char ***argv)
 			(void *) test_deck_cb, _("Feed deck with this input file"), "I" },
 		{ "debug", 0, G_OPTION_FLAG_NO_ARG, G_OPTION_ARG_CALLBACK,
 			(void *) debug_mode_cb, _("Enable debug mode"), "D" },
+		{ "review", 0, G_OPTION_FLAG_NO_ARG, G_OPTION_ARG_CALLBACK,
+			(void *) review_mode_cb, _("Review every move at the end of each round"), "R" },
+		{ "hud", 0, G_OPTION_FLAG_NO_ARG, G_OPTION_ARG_CALLBACK,
+			(void *) hud_mode_cb, _("Show frame timings over the board"), "H" },
 		{ NULL },
 	};
 
@@ -31,11 +31,17 @@ public:
 
 	bool is_testing_file () const;
 	bool is_debug_mode () const;
+	bool is_review_mode () const;
+	bool is_hud_mode () const;
 	void set_testing_file (bool testing_file);
 	void set_debug_mode (bool debug);
+	void set_review_mode (bool review);
+	void set_hud_mode (bool hud);
 	void parse_cmdline_options (int *argc, char ***argv);
 private:
 	bool testing_file;
 	bool debug;
+	bool review;
+	bool hud;
 };
 #endif
@@ -18,17 +18,23 @@
  *  along with chin-chon-lin.  If not, see <http://www.gnu.org/licenses/>.
  *
  */
-#include <sstream>
 #include <math.h>
 #include <list>
 #include <gtk/gtk.h>
 #include <cairo.h>
 #include <librsvg/rsvg.h>
+#include "Cmdline.h"
 #include "UserInterface.h"
+#include "Logic.h"
 #include "Board.h"
 #include "Player.h"
 #include "Stack.h"
 #include "Card.h"
+#include "Tracker.h"
+#include "Belief.h"
+#include "Raster.h"
+#include "Timeline.h"
+#include "Hud.h"
 
 class Deck : public Tile {
 public:
@@ -54,16 +60,18 @@ private:
 	std::string cc;
 };
 
+extern class Cmdline cmdline;
 extern class Deck deck;
 extern GtkWidget *drawing_area;
-extern unsigned deck_to_player_tid;
 
+/*
+ * The geometry of the deck is only known once its back has been parsed by
+ * the raster, see set_cc ()
+ */
 Deck::Deck ()
 {
-	gfile = g_file_new_for_path (CHIN_CHON_LIN_DATADIR "data/tiles/deck-ar.svg");
-	handler = rsvg_handle_new_from_gfile_sync (gfile, RSVG_HANDLE_FLAGS_NONE, NULL, NULL);
-	rsvg_handle_set_dpi (handler, 300.0);
-	rsvg_handle_get_geometry_for_layer (handler, "#deck", &viewport, NULL, &logical, NULL);
+	logical = { .0, .0, .0, .0 };
+	asset = RASTER_BACK;
 	relocate ();
 }
 
@@ -89,24 +97,17 @@ void Deck::set_cards (std::list<Card>& cards)
 
 void Deck::set_cc (std::string cc)
 {
-	std::ostringstream filename;
-
-	filename << CHIN_CHON_LIN_DATADIR << "data/tiles/";
 	if (cc == "es")
-		filename << "deck-es.svg";
+		asset = RASTER_BACK + 1;
 	else if (cc == "gb")
-		filename << "deck-gb.svg";
+		asset = RASTER_BACK + 2;
 	else if (cc == "us")
-		filename << "deck-us.svg";
+		asset = RASTER_BACK + 3;
 	else
-		filename << "deck-ar.svg";
+		asset = RASTER_BACK;
 
 	this->cc = cc;
-
-	gfile = g_file_new_for_path (filename.str().c_str ());
-	handler = rsvg_handle_new_from_gfile_sync (gfile, RSVG_HANDLE_FLAGS_NONE, NULL, NULL);
-	rsvg_handle_set_dpi (handler, 300.0);
-	rsvg_handle_get_geometry_for_layer (handler, "#deck", &viewport, NULL, &logical, NULL);
+	logical = raster.get_logical (asset);
 	relocate ();
 }
 
@@ -138,14 +139,9 @@ void Deck::draw (cairo_t *cr)
 
 	// Update depth of the deck as players acquire cards from the deck. It can
 	// be seen as a size-decreasing deck in the middle of the window
-	for (unsigned long i = 0; i < cards.size (); i += 4) {
-		cairo_save (cr);
-		cairo_translate (cr, x + i / 4, y - i / 4);
-		cairo_scale (cr, 5.0 * board.get_x_scale (), 5.0 * board.get_y_scale ());
-		rsvg_handle_render_cairo (handler, cr);
-		cairo_stroke (cr);
-		cairo_restore (cr);
-	}
+	hud.begin (HUD_PILES);
+	draw_pile (cr, cards.size (), x, y);
+	hud.end (HUD_PILES);
 }
 
 /*
@@ -204,51 +200,56 @@ void Deck::draw_empty (cairo_t *cr)
 		}
 	}
 	deck.set_cards (swapped_list);
+	tracker.on_reshuffle ();
+	belief.on_reshuffle ();
 	s.clear (cr);
 }
 
 /*
- * Update X and Y frames asynchronously every time the @frame_clock changes.
- * This is the callback function activated when a player gets one card from the deck
+ * Step of the timeline moving the card a player gets from the deck, @value
+ * going from 0 (on the deck) to 1 (in the eighth place of the hand)
  */
-gboolean on_deck_to_player_cb (GtkWidget *widget, GdkFrameClock *frame_clock, gpointer data)
+void on_deck_to_player_step (double value)
 {
 	double xframe, yframe;
 	Player& p = player[board.get_turn ()];
 	Tile& d = deck;
 
-	xframe = p.get_xframe () + (p.get_xsrc () + p.get_xoffset (7) - d.get_x ()) / board.get_framerate ();
-	yframe = p.get_yframe () + (p.get_ysrc () + p.get_yoffset (7) - d.get_y ()) / board.get_framerate ();
+	xframe = value * (p.get_xsrc () + p.get_xoffset (7) - d.get_x ());
+	yframe = value * (p.get_ysrc () + p.get_yoffset (7) - d.get_y ());
+	d.damage (d.get_x () + p.get_xframe (), d.get_y () + p.get_yframe (), d.get_x () + xframe, d.get_y () + yframe);
 	p.set_xframe (xframe);
 	p.set_yframe (yframe);
-
-	gtk_widget_queue_draw (drawing_area);
-
-	return G_SOURCE_CONTINUE;
 }
 
 void Deck::animate (cairo_t *cr)
 {
 	Player& p = player[board.get_turn ()];
 	Tile& d = deck;
+	mask_t drawn, top = 0;
 
-	if (fabs (d.get_x () + p.get_xframe () - (p.get_xsrc () + p.get_xoffset (7))) < 1.0 &&
-	    fabs (d.get_y () + p.get_yframe () - (p.get_ysrc () + p.get_yoffset (7)) < 1.0)) {
+	if (timeline.is_done (TIMELINE_DECK_TO_PLAYER)) {
 		p.set_xframe (0.0);
 		p.set_yframe (0.0);
+		drawn = mask_bit (cards.front().get_suit (), cards.front().get_number ());
+		if (stack_played.get_cards().size ())
+			top = mask_bit (stack_played.get_cards().front().get_suit (),
+					stack_played.get_cards().front().get_number ());
+		logic.record_move (p.get_id (), LINE_DECK, -1);
 		p.acquire ("deck", deck.get_cards().front (), false);
+		tracker.on_draw (p.get_id ());
+		belief.on_draw (p.get_id (), drawn, top);
 		p.set_extra_card (true);
 		p.get_card(7).set_displayed (true);
 		board.set_status (DECK_TO_PLAYER_STOP);
-		gtk_widget_remove_tick_callback (drawing_area, deck_to_player_tid);
+		timeline.stop (TIMELINE_DECK_TO_PLAYER);
 	}
 
 	if (!cards.size ())
 		return;
-	cairo_save (cr);
-	cairo_translate (cr, d.get_x () + p.get_xframe (), d.get_y () + p.get_yframe ());
-	cairo_scale (cr, 5.0 * board.get_x_scale (), 5.0 * board.get_y_scale ());
-	rsvg_handle_render_cairo (cards.front().get_handler (), cr);
-	cairo_stroke (cr);
-	cairo_restore (cr);
+	// Only the human gets to see the card drawn
+	if (p.get_id () == 0 || cmdline.is_debug_mode ())
+		cards.front().render (cr, d.get_x () + p.get_xframe (), d.get_y () + p.get_yframe ());
+	else
+		render (cr, d.get_x () + p.get_xframe (), d.get_y () + p.get_yframe ());
 }
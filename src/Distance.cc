@@ -0,0 +1,304 @@
+/*
+ *
+ * Copyright 2023 Daniel Dwek
+ *
+ * This file is part of chin-chon-lin.
+ *
+ *  chin-chon-lin is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  chin-chon-lin is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with chin-chon-lin.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include <vector>
+#include "Mask.h"
+
+#define DISTANCE_MELDS3		88
+#define DISTANCE_MELDS4		48
+#define DISTANCE_MELDS		(DISTANCE_MELDS3 + DISTANCE_MELDS4)
+
+class Distance {
+public:
+	Distance ();
+	~Distance ();
+
+	mask_t get_hand () const;
+	mask_t get_dead () const;
+	int get_flexible_ending () const;
+	void set_hand (mask_t hand);
+	void set_dead (mask_t dead);
+	void set_flexible_ending (int flexible_ending);
+
+	void add (int card);
+	void remove (int card);
+	int get_distance ();
+	int get_distance_without (int card);
+	int get_distance_with (int card);
+private:
+	void refresh ();
+
+	mask_t hand;
+	mask_t dead;
+	int flexible_ending;
+	int overlap[DISTANCE_MELDS];
+	bool dirty;
+	int best[2];
+	mask_t needed[2];
+	mask_t missing[2];
+};
+
+// Kinds of endings: one combo of three cards and another one of four (a
+// stair of seven cards is just a stair of three next to one of four), or
+// two combos of three cards when the ending is flexible
+#define ENDING_34	0
+#define ENDING_33	1
+
+typedef struct {
+	mask_t meld[DISTANCE_MELDS];
+	std::vector<int> of_card[48];
+	std::vector<std::pair<int, int> > pairs[2];
+} melds_t;
+
+/*
+ * Every combo of three or four cards, which cards belong to each one and
+ * the pairs of disjoint combos making an ending
+ */
+static melds_t build_melds ()
+{
+	int i, j, n, s, k, len;
+	melds_t melds;
+
+	// Combos of three cards first, then those of four
+	for (n = 0, len = 3; len <= 4; len++) {
+		for (k = 1; k <= 12; k++) {
+			if (len == 3) {
+				for (s = 0; s < 4; s++)
+					melds.meld[n++] = mask_number (k) & ~mask_bit (s, k);
+			} else {
+				melds.meld[n++] = mask_number (k);
+			}
+		}
+		for (s = 0; s < 4; s++)
+			for (k = 1; k + len - 1 <= 12; k++)
+				melds.meld[n++] = (((mask_t) 1 << len) - 1) << mask_idx (s, k);
+	}
+
+	for (i = 0; i < DISTANCE_MELDS; i++)
+		for (mask_t m = melds.meld[i]; m; m &= m - 1)
+			melds.of_card[mask_first (m)].push_back (i);
+
+	for (i = 0; i < DISTANCE_MELDS3; i++) {
+		for (j = DISTANCE_MELDS3; j < DISTANCE_MELDS; j++)
+			if (!(melds.meld[i] & melds.meld[j]))
+				melds.pairs[ENDING_34].push_back (std::make_pair (i, j));
+		for (j = i + 1; j < DISTANCE_MELDS3; j++)
+			if (!(melds.meld[i] & melds.meld[j]))
+				melds.pairs[ENDING_33].push_back (std::make_pair (i, j));
+	}
+
+	return melds;
+}
+
+/*
+ * Built once, on first use, from whichever thread gets here first
+ */
+static const melds_t& get_melds ()
+{
+	static const melds_t melds = build_melds ();
+
+	return melds;
+}
+
+/*
+ * Shanten-like distance of a hand to a legal ending: the least number of
+ * cards that must be swapped for others before the round can be finished
+ * with it. The hand is compared against every possible ending, and how
+ * many cards of each combo it already holds is kept up to date one card
+ * at a time, so following a hand through the round is cheap.
+ *
+ * Besides the distance itself, the same pass over the endings finds out
+ * which cards are held by every closest ending and which ones would bring
+ * the hand one card closer, so that ranking the possible discards and the
+ * card on top of the stack takes O(1) per candidate.
+ *
+ * Cards in @dead (e.g. already played) cannot be part of an ending
+ */
+Distance::Distance ()
+{
+	get_melds ();
+	hand = 0;
+	dead = 0;
+	flexible_ending = 0;
+	for (int i = 0; i < DISTANCE_MELDS; i++)
+		overlap[i] = 0;
+	dirty = true;
+}
+
+Distance::~Distance ()
+{
+}
+
+mask_t Distance::get_hand () const
+{
+	return hand;
+}
+
+mask_t Distance::get_dead () const
+{
+	return dead;
+}
+
+int Distance::get_flexible_ending () const
+{
+	return flexible_ending;
+}
+
+/*
+ * Move to @hand adding and removing only the cards that changed
+ */
+void Distance::set_hand (mask_t hand)
+{
+	mask_t m;
+
+	for (m = this->hand & ~hand; m; m &= m - 1)
+		remove (mask_first (m));
+	for (m = hand & ~this->hand; m; m &= m - 1)
+		add (mask_first (m));
+}
+
+void Distance::set_dead (mask_t dead)
+{
+	if (dead != this->dead)
+		dirty = true;
+	this->dead = dead;
+}
+
+void Distance::set_flexible_ending (int flexible_ending)
+{
+	if (flexible_ending != this->flexible_ending)
+		dirty = true;
+	this->flexible_ending = flexible_ending;
+}
+
+void Distance::add (int card)
+{
+	const melds_t& melds = get_melds ();
+
+	if (hand & ((mask_t) 1 << card))
+		return;
+	hand |= (mask_t) 1 << card;
+	for (int m : melds.of_card[card])
+		overlap[m]++;
+	dirty = true;
+}
+
+void Distance::remove (int card)
+{
+	const melds_t& melds = get_melds ();
+
+	if (!(hand & ((mask_t) 1 << card)))
+		return;
+	hand &= ~((mask_t) 1 << card);
+	for (int m : melds.of_card[card])
+		overlap[m]--;
+	dirty = true;
+}
+
+/*
+ * For each kind of ending, find the most cards of the hand any ending
+ * holds, the cards held by every such ending (@needed) and the cards
+ * missing in any of them (@missing)
+ */
+void Distance::refresh ()
+{
+	int k, v;
+	mask_t m;
+	const melds_t& melds = get_melds ();
+
+	for (k = 0; k < 2; k++) {
+		best[k] = -1;
+		needed[k] = hand;
+		missing[k] = 0;
+		if (k == ENDING_33 && !flexible_ending)
+			continue;
+		for (const std::pair<int, int>& p : melds.pairs[k]) {
+			m = melds.meld[p.first] | melds.meld[p.second];
+			if (m & dead & ~hand)
+				continue;
+			v = overlap[p.first] + overlap[p.second];
+			if (v < best[k])
+				continue;
+			if (v > best[k]) {
+				best[k] = v;
+				needed[k] = hand;
+				missing[k] = 0;
+			}
+			needed[k] &= m;
+			missing[k] |= m & ~hand;
+		}
+	}
+	dirty = false;
+}
+
+/*
+ * Number of cards to be swapped before the hand can finish the round, or
+ * 8 if it cannot do so anymore because of the dead cards
+ */
+int Distance::get_distance ()
+{
+	int d = 8;
+
+	if (dirty)
+		refresh ();
+	if (best[ENDING_34] >= 0)
+		d = 7 - best[ENDING_34];
+	if (best[ENDING_33] >= 0 && 6 - best[ENDING_33] < d)
+		d = 6 - best[ENDING_33];
+	return d < 0 ? 0 : d;
+}
+
+/*
+ * Distance of the hand once @card is discarded
+ */
+int Distance::get_distance_without (int card)
+{
+	int k, d = 8, v, size[2] = { 7, 6 };
+
+	if (dirty)
+		refresh ();
+	for (k = 0; k < 2; k++) {
+		if (best[k] < 0)
+			continue;
+		v = best[k] - ((needed[k] >> card) & 1);
+		if (size[k] - v < d)
+			d = size[k] - v;
+	}
+	return d < 0 ? 0 : d;
+}
+
+/*
+ * Distance of the hand once @card is taken
+ */
+int Distance::get_distance_with (int card)
+{
+	int k, d = 8, v, size[2] = { 7, 6 };
+
+	if (dirty)
+		refresh ();
+	for (k = 0; k < 2; k++) {
+		if (best[k] < 0)
+			continue;
+		v = best[k] + ((missing[k] >> card) & 1);
+		if (size[k] - v < d)
+			d = size[k] - v;
+	}
+	return d < 0 ? 0 : d;
+}
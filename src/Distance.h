@@ -0,0 +1,59 @@
+/*
+ *
+ * Copyright 2023 Daniel Dwek
+ *
+ * This file is part of chin-chon-lin.
+ *
+ *  chin-chon-lin is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  chin-chon-lin is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with chin-chon-lin.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#ifndef _DISTANCE_H_
+#define _DISTANCE_H_
+#include "Mask.h"
+
+#define DISTANCE_MELDS3		88
+#define DISTANCE_MELDS4		48
+#define DISTANCE_MELDS		(DISTANCE_MELDS3 + DISTANCE_MELDS4)
+
+class Distance {
+public:
+	Distance ();
+	~Distance ();
+
+	mask_t get_hand () const;
+	mask_t get_dead () const;
+	int get_flexible_ending () const;
+	void set_hand (mask_t hand);
+	void set_dead (mask_t dead);
+	void set_flexible_ending (int flexible_ending);
+
+	void add (int card);
+	void remove (int card);
+	int get_distance ();
+	int get_distance_without (int card);
+	int get_distance_with (int card);
+private:
+	void refresh ();
+
+	mask_t hand;
+	mask_t dead;
+	int flexible_ending;
+	int overlap[DISTANCE_MELDS];
+	bool dirty;
+	int best[2];
+	mask_t needed[2];
+	mask_t missing[2];
+};
+
+#endif
@@ -0,0 +1,673 @@
+/*
+ *
+ * Copyright 2023 Daniel Dwek
+ *
+ * This file is part of chin-chon-lin.
+ *
+ *  chin-chon-lin is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  chin-chon-lin is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with chin-chon-lin.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+#include <glib.h>
+#include "Mask.h"
+#include "Meld.h"
+#include "Action.h"
+#include "Sim.h"
+#include "Search.h"
+#include "Strategy.h"
+#include "Solver.h"
+#include "Value.h"
+#include "Match.h"
+#include "Batch.h"
+#include "Belief.h"
+#include "Round.h"
+
+class Search search;
+class Strategy strategy;
+class Value value;
+
+static gboolean bench_search = FALSE;
+static gint threads = 0;
+static gint budget = 0;
+static gint depth = 0;
+static gint turns = 12;
+static gint64 seed = 1;
+static gchar *mode = nullptr;
+static gint64 solve = 0;
+static gint deals = 0;
+static gint checkpoint = -1;
+static gchar *output = nullptr;
+static gboolean resume = FALSE;
+static gint generate = 0;
+static gint train = 0;
+static gchar *data = nullptr;
+static gdouble rate = 0.002;
+static gboolean bench_value = FALSE;
+static gint64 duplicate = 0;
+static gchar *bot_a = nullptr;
+static gchar *bot_b = nullptr;
+static gint64 sprt = 0;
+static gdouble delta = 0.5;
+static gdouble alpha = 0.05;
+static gint bench_batch = 0;
+static gint bench_reset = 0;
+static gint check_rules = 0;
+
+/*
+ * Deal a round from @seed and let the greedy bots play @turns turns, so
+ * that benchmarks start from a position in the middle of a round
+ */
+static void get_random_position (uint64_t seed, int turns, position_t *ret)
+{
+	int i, perm[48];
+	Sim sim;
+
+	for (i = 0; i < 48; i++)
+		perm[i] = i;
+	sim.set_seed (seed);
+	sim.shuffle (perm, 48);
+	sim.deal (perm);
+	sim.play (turns);
+
+	ret->observer = sim.get_turn ();
+	ret->hand = sim.get_hand (ret->observer);
+	ret->npile = sim.get_played (ret->pile);
+	ret->deck_size = sim.get_deck_size ();
+	ret->flexible_ending = sim.get_flexible_ending ();
+	for (i = 0; i < 4; i++) {
+		ret->hand_size[i] = mask_count (sim.get_hand (i));
+		ret->known[i] = 0;
+		ret->nsamples[i] = 0;
+	}
+}
+
+static int run_bench_search ()
+{
+	position_t pos;
+
+	get_random_position (seed, turns, &pos);
+	std::cout << "Position after " << turns << " turns (seed " << seed << "): player " <<
+		pos.observer << " to move, " << pos.deck_size << " cards in the deck" << std::endl;
+	std::cout << "Search budget: " << search.get_budget () << " ms, depth: " <<
+		search.get_depth () << " turns, " << std::thread::hardware_concurrency () <<
+		" hardware threads" << std::endl;
+
+	if (!mode || std::string (mode) == "root") {
+		std::cout << std::endl << "Root parallelism" << std::endl;
+		search.set_mode (SEARCH_ROOT);
+		search.bench (&pos, threads ? threads : 8);
+	}
+	if (!mode || std::string (mode) == "shared") {
+		std::cout << std::endl << "Shared statistics with virtual loss" << std::endl;
+		search.set_mode (SEARCH_SHARED);
+		search.bench (&pos, threads ? threads : 8);
+	}
+
+	return 0;
+}
+
+/*
+ * Compute the strategy table the bots load at startup. A run can be stopped
+ * at any time and resumed from its last checkpoint with --resume
+ */
+static int run_solve ()
+{
+	const char *filename = output ? output : "strategy.txt";
+	Solver solver (&strategy);
+
+	if (resume && !strategy.load (filename)) {
+		std::cerr << "Cannot resume from " << filename << std::endl;
+		return 1;
+	}
+	if (threads > 0)
+		solver.set_threads (threads);
+	if (deals > 0)
+		solver.set_deals (deals);
+	if (checkpoint >= 0)
+		solver.set_checkpoint (checkpoint);
+
+	std::cout << "Solving from iteration " << strategy.get_iterations () << " with " <<
+		solver.get_threads () << " threads, " << solver.get_deals () <<
+		" rounds per thread and iteration" << std::endl;
+	if (!solver.solve (solve, filename)) {
+		std::cerr << "Cannot write " << filename << std::endl;
+		return 1;
+	}
+	std::cout << "Strategy table written to " << filename << std::endl;
+
+	return 0;
+}
+
+// Fraction of the discards made at random while generating samples, so
+// that the value function also sees the hands the greedy bots avoid
+#define EXPLORE		0.1
+
+/*
+ * Let the greedy bots play @generate rounds against themselves and write
+ * down the state after every turn, together with the points its player
+ * was charged with at the end of the round (negated), as training samples
+ * for the value function
+ */
+static int run_generate ()
+{
+	int i, n, c, player, perm[48], top, nsamples = 0;
+	mask_t hand;
+	const char *filename = output ? output : "value-data.txt";
+	std::vector<sample_t> round;
+	std::vector<int> players;
+	FILE *fp;
+	Sim sim;
+
+	if (!(fp = fopen (filename, "w"))) {
+		std::cerr << "Cannot write " << filename << std::endl;
+		return 1;
+	}
+	sim.set_seed (seed);
+	for (n = 0; n < generate; n++) {
+		for (i = 0; i < 48; i++)
+			perm[i] = i;
+		sim.shuffle (perm, 48);
+		sim.deal (perm);
+		round.clear ();
+		players.clear ();
+		while (!sim.is_over () && sim.get_turns () < 48) {
+			player = sim.get_turn ();
+			if (sim.draw (sim.choose_source ()) == -1) {
+				sim.finish ();
+				break;
+			}
+			hand = sim.get_hand (player);
+			if (meld_can_close (hand, sim.get_flexible_ending (), &c) && sim.close (c))
+				break;
+			if ((sim.next () >> 11) * (1.0 / 9007199254740992.0) < EXPLORE) {
+				for (i = sim.next () % mask_count (hand); i; i--)
+					hand &= hand - 1;
+				c = mask_first (hand);
+			} else
+				c = sim.choose_discard ();
+			sim.discard (c);
+			top = sim.get_top ();
+			round.push_back ({ sim.get_hand (player), sim.get_pile () & ~((mask_t) 1 << top), top,
+					   sim.get_deck_size (), 0.0f });
+			players.push_back (player);
+		}
+		if (!sim.is_over ())
+			continue;
+		for (i = 0; i < (int) round.size (); i++) {
+			sample_t &s = round[i];
+
+			s.target = -sim.get_points (players[i]);
+			fprintf (fp, "%016llx %016llx %d %d %g\n", (unsigned long long) s.hand,
+				(unsigned long long) s.pile, s.top, s.deck_size, s.target);
+			nsamples++;
+		}
+	}
+	if (fclose (fp) != 0) {
+		std::cerr << "Cannot write " << filename << std::endl;
+		return 1;
+	}
+	std::cout << nsamples << " samples from " << generate << " rounds written to " << filename << std::endl;
+
+	return 0;
+}
+
+/*
+ * Fit the value function to the samples in --data for @train epochs,
+ * holding out one sample in ten to report how well it generalizes
+ */
+static int run_train ()
+{
+	int epoch, nvalid;
+	unsigned long long hand, pile;
+	const char *filename = output ? output : "value.txt";
+	std::vector<sample_t> samples;
+	sample_t s;
+	FILE *fp;
+
+	if (!data || !(fp = fopen (data, "r"))) {
+		std::cerr << "Cannot read the samples, see --data" << std::endl;
+		return 1;
+	}
+	while (fscanf (fp, "%llx %llx %d %d %f", &hand, &pile, &s.top, &s.deck_size, &s.target) == 5) {
+		s.hand = hand;
+		s.pile = pile;
+		samples.push_back (s);
+	}
+	fclose (fp);
+	if (samples.size () < 10) {
+		std::cerr << "Not enough samples in " << data << std::endl;
+		return 1;
+	}
+
+	if (resume) {
+		if (!value.load (filename)) {
+			std::cerr << "Cannot resume from " << filename << std::endl;
+			return 1;
+		}
+	} else
+		value.randomize (seed);
+	nvalid = samples.size () / 10;
+	std::cout << "Training on " << samples.size () - nvalid << " samples, validating on " <<
+		nvalid << std::endl;
+	for (epoch = 1; epoch <= train; epoch++) {
+		double err = value.train (&samples[nvalid], samples.size () - nvalid, rate, seed + epoch);
+		std::cout << "Epoch " << epoch << ": training error " << err << ", validation error " <<
+			value.get_error (&samples[0], nvalid) << std::endl;
+		if (!value.save (filename)) {
+			std::cerr << "Cannot write " << filename << std::endl;
+			return 1;
+		}
+	}
+	std::cout << "Value function written to " << filename << std::endl;
+
+	return 0;
+}
+
+/*
+ * Measure how many positions the value function evaluates per second on
+ * a single core
+ */
+static int run_bench_value ()
+{
+	int i, n = 1 << 22;
+	float sum = 0.0f;
+	position_t pos;
+	mask_t pile = 0;
+	std::chrono::steady_clock::time_point start;
+	double elapsed;
+
+	if (!value.load (output ? output : "value.txt"))
+		value.randomize (seed);
+	get_random_position (seed, turns, &pos);
+	for (i = 0; i < pos.npile - 1; i++)
+		pile |= (mask_t) 1 << pos.pile[i];
+
+	start = std::chrono::steady_clock::now ();
+	for (i = 0; i < n; i++)
+		sum += value.evaluate (pos.hand ^ ((mask_t) 1 << (i % 48)), pile,
+			pos.npile ? pos.pile[pos.npile - 1] : -1, pos.deck_size);
+	elapsed = std::chrono::duration<double> (std::chrono::steady_clock::now () - start).count ();
+
+	std::cout << VALUE_WEIGHTS << " weights, " <<
+#ifdef __SSE2__
+		"SSE2" <<
+#else
+		"scalar" <<
+#endif
+		" inference: " << (long) (n / elapsed) << " evaluations per second (" <<
+		1e9 * elapsed / n << " ns each, checksum " << sum << ")" << std::endl;
+
+	return 0;
+}
+
+/*
+ * Bot described by @spec: "greedy", "strategy[:FILE]" or "value[:FILE]",
+ * where FILE defaults to strategy.txt or value.txt respectively
+ */
+static bool parse_bot (const char *spec, bot_t *ret)
+{
+	std::string s (spec ? spec : "greedy"), kind = s.substr (0, s.find (':')), filename;
+	Strategy *table;
+	Value *weights;
+
+	filename = s.find (':') != std::string::npos ? s.substr (s.find (':') + 1) : "";
+	ret->table = nullptr;
+	ret->weights = nullptr;
+	if (kind == "greedy") {
+		ret->kind = BOT_GREEDY;
+	} else if (kind == "strategy") {
+		// Bots live as long as the program does
+		table = new Strategy ();
+		if (!table->load (filename.size () ? filename.c_str () : "strategy.txt")) {
+			std::cerr << "Cannot load the strategy table of " << s << std::endl;
+			return false;
+		}
+		ret->kind = BOT_STRATEGY;
+		ret->table = table;
+	} else if (kind == "value") {
+		weights = new Value ();
+		if (!weights->load (filename.size () ? filename.c_str () : "value.txt")) {
+			std::cerr << "Cannot load the value function of " << s << std::endl;
+			return false;
+		}
+		ret->kind = BOT_VALUE;
+		ret->weights = weights;
+	} else {
+		std::cerr << "Unknown bot: " << s << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+static void print_match (const Match *match)
+{
+	const char *a = bot_a ? bot_a : "greedy", *b = bot_b ? bot_b : "greedy";
+
+	std::cout << match->get_deals () << " deals (" << 4 * match->get_deals () << " games): " << a <<
+		" saves " << match->get_mean () << " +/- " << 1.96 * match->get_error () <<
+		" points per round with respect to " << b << " (95% confidence)" << std::endl;
+	std::cout << "Points per round: " << a << " " << match->get_points (0) << " +/- " <<
+		1.96 * match->get_points_error (0) << ", " << b << " " << match->get_points (1) << " +/- " <<
+		1.96 * match->get_points_error (1) << std::endl;
+	std::cout << "Win rate of " << a << ": " << 100.0 * match->get_win_rate () << "% +/- " <<
+		196.0 * match->get_win_error () << "%" << std::endl;
+	if (match->get_error () > 0.0)
+		std::cout << "Random deals would have needed about " <<
+			match->get_naive_error () * match->get_naive_error () /
+			(match->get_error () * match->get_error ()) <<
+			" times as many games for the same precision" << std::endl;
+}
+
+/*
+ * Compare two bots over @duplicate deals, each one played four times with
+ * the bots rotated through the seats
+ */
+static int run_duplicate ()
+{
+	bot_t a, b;
+	Match match;
+
+	if (!parse_bot (bot_a, &a) || !parse_bot (bot_b, &b))
+		return 1;
+	match.set_bot (0, &a);
+	match.set_bot (1, &b);
+	match.set_seed (seed);
+	match.duplicate (duplicate);
+	print_match (&match);
+
+	return 0;
+}
+
+/*
+ * Compare two bots on every core, stopping as soon as the sequential test
+ * tells which one is better or after @sprt deals
+ */
+static int run_sprt ()
+{
+	int better;
+	bot_t a, b;
+	Match match;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now ();
+	double elapsed;
+
+	if (!parse_bot (bot_a, &a) || !parse_bot (bot_b, &b))
+		return 1;
+	match.set_bot (0, &a);
+	match.set_bot (1, &b);
+	match.set_seed (seed);
+	if (threads > 0)
+		match.set_threads (threads);
+	match.set_delta (delta);
+	match.set_alpha (alpha);
+
+	std::cout << "Testing whether either bot saves " << match.get_delta () << " points per round, at " <<
+		100.0 * match.get_alpha () << "% error, on " << match.get_threads () << " threads" << std::endl;
+	better = match.sequential (sprt);
+	elapsed = std::chrono::duration<double> (std::chrono::steady_clock::now () - start).count ();
+
+	if (better == -1)
+		std::cout << "Undecided after " << match.get_deals () << " deals (LLR " << match.get_llr () << ")";
+	else
+		std::cout << (better == 0 ? (bot_a ? bot_a : "greedy") : (bot_b ? bot_b : "greedy")) <<
+			" is better, decided after " << match.get_deals () << " deals (LLR " << match.get_llr () << ")";
+	std::cout << " in " << elapsed << " s" << std::endl;
+	print_match (&match);
+
+	return 0;
+}
+
+/*
+ * Play @bench_batch greedy rounds in lockstep and then one at a time, and
+ * compare both the throughput and the outcome of every round
+ */
+static int run_bench_batch ()
+{
+	int g, i, perm[48], mismatches = 0;
+	Batch batch (bench_batch);
+	Sim sim;
+	std::chrono::steady_clock::time_point start;
+	double batched, single;
+
+	start = std::chrono::steady_clock::now ();
+	for (g = 0; g < bench_batch; g++)
+		batch.set_seed (g, seed + g);
+	batch.deal ();
+	batch.play (200);
+	batched = std::chrono::duration<double> (std::chrono::steady_clock::now () - start).count ();
+
+	start = std::chrono::steady_clock::now ();
+	for (g = 0; g < bench_batch; g++) {
+		for (i = 0; i < 48; i++)
+			perm[i] = i;
+		sim.set_seed (seed + g);
+		sim.shuffle (perm, 48);
+		sim.deal (perm);
+		sim.play (200);
+		for (i = 0; i < 4; i++)
+			if (sim.get_hand (i) != batch.get_hand (g, i))
+				mismatches++;
+	}
+	single = std::chrono::duration<double> (std::chrono::steady_clock::now () - start).count ();
+
+	std::cout << bench_batch << " rounds on one core: " << (long) (bench_batch / batched) <<
+		" rounds per second in lockstep, " << (long) (bench_batch / single) <<
+		" one at a time (" << mismatches << " hands differ)" << std::endl;
+
+	return mismatches ? 1 : 0;
+}
+
+/*
+ * Start @bench_reset rounds with round_new (), just as Board::new_round ()
+ * does (the shuffle, the deal and the guesses of the bots about every
+ * hand), and report both the mean and the worst gap between two rounds
+ */
+static int run_bench_reset ()
+{
+	int g;
+	round_t round;
+	Belief belief;
+	std::chrono::steady_clock::time_point start, next;
+	double elapsed, gap, worst = 0.0;
+	mask_t check = 0;
+
+	srand (seed);
+	start = std::chrono::steady_clock::now ();
+	for (g = 0; g < bench_reset; g++) {
+		next = std::chrono::steady_clock::now ();
+		round_new (&round, &belief);
+		check ^= round.hands[0];
+		gap = std::chrono::duration<double> (std::chrono::steady_clock::now () - next).count ();
+		if (gap > worst)
+			worst = gap;
+	}
+	elapsed = std::chrono::duration<double> (std::chrono::steady_clock::now () - start).count ();
+
+	std::cout << bench_reset << " round resets: " << 1e9 * elapsed / bench_reset <<
+		" ns each, " << 1e9 * worst << " ns at worst (checksum " << check << ")" << std::endl;
+
+	return 0;
+}
+
+/*
+ * Whether the cards of @sim are all there, each one exactly once: in a
+ * hand, on the stack or in the deck
+ */
+static bool check_cards (const Sim *sim)
+{
+	int i, n = 0, played[48];
+	mask_t seen = 0;
+
+	for (i = 0; i < 4; i++) {
+		if (seen & sim->get_hand (i))
+			return false;
+		seen |= sim->get_hand (i);
+		n += mask_count (sim->get_hand (i));
+	}
+	for (i = sim->get_played (played) - 1; i >= 0; i--, n++) {
+		if (seen & (mask_t) 1 << played[i])
+			return false;
+		seen |= (mask_t) 1 << played[i];
+	}
+
+	return n + sim->get_deck_size () == 48;
+}
+
+/*
+ * Play @check_rules rounds taking any of the legal actions at random, and
+ * check after every one of them that the player on turn was offered only
+ * moves of the right kind for the cards in hand, that all of them could be
+ * played and that no card got lost or duplicated on the way, also across
+ * the reshuffles of the stack into the deck
+ */
+static int run_check_rules ()
+{
+	int g, i, n, c, perm[48], actions[ACTION_MAX], errors = 0;
+	long nactions = 0;
+	bool drawing;
+	Sim sim;
+
+	sim.set_seed (seed);
+	for (g = 0; g < check_rules; g++) {
+		for (i = 0; i < 48; i++)
+			perm[i] = i;
+		sim.shuffle (perm, 48);
+		sim.deal (perm);
+		while (!sim.is_over () && sim.get_turns () < 200) {
+			drawing = mask_count (sim.get_hand (sim.get_turn ())) == 7;
+			n = sim.get_actions (actions);
+			for (i = 0; i < n; i++) {
+				c = action_card (actions[i]);
+				if (actions[i] < 0 || actions[i] >= ACTIONS || action_is_draw (actions[i]) != drawing ||
+				    (c != -1 && !(sim.get_hand (sim.get_turn ()) & (mask_t) 1 << c)))
+					break;
+			}
+			if (n < 1 || n > ACTION_MAX || i < n) {
+				std::cerr << "Round " << g << ", turn " << sim.get_turns () << ": illegal actions offered" << std::endl;
+				errors++;
+				break;
+			}
+			if (!sim.apply (actions[sim.next () % n]) || !check_cards (&sim)) {
+				std::cerr << "Round " << g << ", turn " << sim.get_turns () << ": cards lost or duplicated" << std::endl;
+				errors++;
+				break;
+			}
+			nactions++;
+		}
+	}
+
+	std::cout << check_rules << " random rounds, " << nactions << " actions: " << errors << " errors" << std::endl;
+
+	return errors ? 1 : 0;
+}
+
+/*
+ * chin-chon-lin-sim runs the game logic without any GUI, for benchmarking
+ * and tuning the bots from the command line
+ */
+int main (int argc, char *argv[])
+{
+	GError *error = nullptr;
+	GOptionContext *context;
+	const GOptionEntry entries[] = {
+		{ "bench-search", 0, 0, G_OPTION_ARG_NONE, &bench_search,
+			"Measure how the lookahead scales with the number of threads", nullptr },
+		{ "threads", 0, 0, G_OPTION_ARG_INT, &threads, "Number of threads (default: every core)", "N" },
+		{ "budget", 0, 0, G_OPTION_ARG_INT, &budget, "Time budget of a decision in milliseconds", "MS" },
+		{ "depth", 0, 0, G_OPTION_ARG_INT, &depth, "Turns simulated after each candidate move", "N" },
+		{ "mode", 0, 0, G_OPTION_ARG_STRING, &mode, "Parallel search mode: root or shared", "MODE" },
+		{ "turns", 0, 0, G_OPTION_ARG_INT, &turns, "Turns played before the benchmarked position", "N" },
+		{ "seed", 0, 0, G_OPTION_ARG_INT64, &seed, "Seed of the random deals", "S" },
+		{ "solve", 0, 0, G_OPTION_ARG_INT64, &solve, "Run this number of CFR+ iterations on the strategy table", "N" },
+		{ "deals", 0, 0, G_OPTION_ARG_INT, &deals, "Rounds dealt by every thread on each iteration", "N" },
+		{ "checkpoint", 0, 0, G_OPTION_ARG_INT, &checkpoint, "Save the table every this number of iterations", "N" },
+		{ "output", 0, 0, G_OPTION_ARG_FILENAME, &output,
+			"Output file (default: strategy.txt, value-data.txt or value.txt)", "FILE" },
+		{ "resume", 0, 0, G_OPTION_ARG_NONE, &resume, "Go on from the table or weights saved in the output file", nullptr },
+		{ "generate", 0, 0, G_OPTION_ARG_INT, &generate, "Write the samples of this number of self-play rounds", "N" },
+		{ "train", 0, 0, G_OPTION_ARG_INT, &train, "Train the value function for this number of epochs", "N" },
+		{ "data", 0, 0, G_OPTION_ARG_FILENAME, &data, "Samples the value function is trained on", "FILE" },
+		{ "rate", 0, 0, G_OPTION_ARG_DOUBLE, &rate, "Learning rate of the value function (default: 0.002)", "R" },
+		{ "bench-value", 0, 0, G_OPTION_ARG_NONE, &bench_value,
+			"Measure how fast the value function evaluates positions", nullptr },
+		{ "duplicate", 0, 0, G_OPTION_ARG_INT64, &duplicate,
+			"Compare two bots over this number of deals, each one played from every seat", "N" },
+		{ "bot-a", 0, 0, G_OPTION_ARG_STRING, &bot_a, "First bot: greedy, strategy[:FILE] or value[:FILE]", "BOT" },
+		{ "bot-b", 0, 0, G_OPTION_ARG_STRING, &bot_b, "Second bot (default: greedy)", "BOT" },
+		{ "sprt", 0, 0, G_OPTION_ARG_INT64, &sprt,
+			"Compare two bots on every core until either is better, for at most this number of deals", "N" },
+		{ "delta", 0, 0, G_OPTION_ARG_DOUBLE, &delta, "Points per round not worth telling apart (default: 0.5)", "D" },
+		{ "alpha", 0, 0, G_OPTION_ARG_DOUBLE, &alpha, "Error rate of the sequential test (default: 0.05)", "A" },
+		{ "bench-batch", 0, 0, G_OPTION_ARG_INT, &bench_batch,
+			"Compare playing this number of rounds in lockstep with playing them one at a time", "N" },
+		{ "bench-reset", 0, 0, G_OPTION_ARG_INT, &bench_reset,
+			"Measure the gap between rounds over this number of round resets", "N" },
+		{ "check-rules", 0, 0, G_OPTION_ARG_INT, &check_rules,
+			"Check the legal actions over this number of rounds played at random", "N" },
+		{ NULL },
+	};
+
+	context = g_option_context_new ("- play chin-chon without GUI");
+	g_option_context_add_main_entries (context, entries, nullptr);
+	if (!g_option_context_parse (context, &argc, &argv, &error)) {
+		std::cerr << error->message << std::endl;
+		g_error_free (error);
+		g_option_context_free (context);
+		return 1;
+	}
+	g_option_context_free (context);
+
+	if (threads > 0)
+		search.set_threads (threads);
+	if (budget > 0)
+		search.set_budget (budget);
+	if (depth > 0)
+		search.set_depth (depth);
+	if (mode && std::string (mode) == "root")
+		search.set_mode (SEARCH_ROOT);
+	else if (mode && std::string (mode) != "shared") {
+		std::cerr << "Unknown search mode: " << mode << std::endl;
+		return 1;
+	}
+
+	if (bench_search)
+		return run_bench_search ();
+	if (solve > 0)
+		return run_solve ();
+	if (generate > 0)
+		return run_generate ();
+	if (train > 0)
+		return run_train ();
+	if (bench_value)
+		return run_bench_value ();
+	if (duplicate > 0)
+		return run_duplicate ();
+	if (sprt > 0)
+		return run_sprt ();
+	if (bench_batch > 0)
+		return run_bench_batch ();
+	if (bench_reset > 0)
+		return run_bench_reset ();
+	if (check_rules > 0)
+		return run_check_rules ();
+
+	std::cerr << "Nothing to do, see --help" << std::endl;
+	return 1;
+}
@@ -0,0 +1,256 @@
+/*
+ *
+ * Copyright 2023 Daniel Dwek
+ *
+ * This file is part of chin-chon-lin.
+ *
+ *  chin-chon-lin is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  chin-chon-lin is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with chin-chon-lin.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include "Belief.h"
+#include "Mask.h"
+#include "Search.h"
+
+// Hand of no hint at all, since hands have at most eight cards
+#define HINT_NONE	(~(mask_t) 0)
+
+class Hint {
+public:
+	Hint ();
+	Hint (Hint&) = delete;
+	Hint (Hint&&) = delete;
+	Hint& operator= (Hint&) = delete;
+	~Hint ();
+
+	bool is_enabled () const;
+	bool is_ready ();
+	bool is_running () const;
+	mask_t get_hand () const;
+	int get_source ();
+	int get_discard ();
+	int get_budget () const;
+
+	void set_enabled (bool enabled);
+	void set_budget (int budget);
+	void set_notify (void (*notify) ());
+
+	void request (const position_t *pos, const belief_view_t *view);
+	void cancel ();
+private:
+	void run (position_t pos, unsigned generation);
+
+	Search search;
+	std::thread worker;
+	std::mutex lock;
+	std::atomic<unsigned> generation;
+	std::atomic<bool> running;
+	bool enabled;
+	bool ready;
+	mask_t hand;
+	int source;
+	int discard;
+	belief_view_t view;
+	bool guessed;
+	uint64_t seed;
+	void (*notify) ();
+};
+
+/*
+ * Hints for the human player, worked out on a background thread by the
+ * same lookahead the bots use at the hardest difficulty, but within a time
+ * budget of a few milliseconds so that they are ready long before the
+ * next frame. Every cancellation, when the human plays, invalidates
+ * whatever was being computed until then.
+ *
+ * Neither requests nor cancellations ever wait for the background thread,
+ * since they come from the GUI thread: a request made while a cancelled
+ * hint is still winding down is just dropped, and the GUI asks again once
+ * told that the thread is done. The GUI is told about that, and about a
+ * hint being ready, through the @notify callback, which is called from the
+ * background thread
+ */
+Hint::Hint ()
+{
+	int threads = std::thread::hardware_concurrency ();
+
+	search.set_threads (threads > 1 ? threads - 1 : 1);
+	search.set_budget (5);
+	generation = 0;
+	running = false;
+	enabled = false;
+	ready = false;
+	hand = HINT_NONE;
+	source = -1;
+	discard = -1;
+	guessed = false;
+	seed = 0x9e3779b97f4a7c15ULL;
+	notify = nullptr;
+}
+
+Hint::~Hint ()
+{
+	cancel ();
+	if (worker.joinable ())
+		worker.join ();
+}
+
+bool Hint::is_enabled () const
+{
+	return enabled;
+}
+
+bool Hint::is_ready ()
+{
+	std::lock_guard<std::mutex> guard (lock);
+
+	return ready;
+}
+
+/*
+ * Whether the background thread is still working out a hint, even one
+ * already cancelled
+ */
+bool Hint::is_running () const
+{
+	return running;
+}
+
+/*
+ * Hand the last hint was requested for, or HINT_NONE if it was cancelled
+ * or could not be requested
+ */
+mask_t Hint::get_hand () const
+{
+	return hand;
+}
+
+/*
+ * 0 if the card on top of the stack should be taken, 1 if the deck should
+ * be drawn from, -1 if there is nothing to choose (eight cards in hand)
+ */
+int Hint::get_source ()
+{
+	std::lock_guard<std::mutex> guard (lock);
+
+	return source;
+}
+
+/*
+ * Card to be discarded, as an index of the global card[48] array, or -1
+ * before drawing
+ */
+int Hint::get_discard ()
+{
+	std::lock_guard<std::mutex> guard (lock);
+
+	return discard;
+}
+
+int Hint::get_budget () const
+{
+	return search.get_budget ();
+}
+
+void Hint::set_enabled (bool enabled)
+{
+	if (!enabled)
+		cancel ();
+	this->enabled = enabled;
+}
+
+void Hint::set_budget (int budget)
+{
+	search.set_budget (budget);
+}
+
+void Hint::set_notify (void (*notify) ())
+{
+	this->notify = notify;
+}
+
+void Hint::run (position_t pos, unsigned generation)
+{
+	int i, n, best;
+	line_t lines[SEARCH_LINES];
+
+	// Guesses come from the hint's own generator, so that asking for hints
+	// does not change how the bots play
+	if (guessed)
+		for (i = 0; i < 4; i++)
+			if (i != pos.observer)
+				pos.nsamples[i] = belief_sample (&view, i, pos.samples[i], SEARCH_SAMPLES, &seed);
+
+	n = search.get_lines (&pos, lines);
+	best = n ? search.choose (&pos, lines, n) : -1;
+
+	if (best != -1) {
+		std::lock_guard<std::mutex> guard (lock);
+
+		if (generation == this->generation) {
+			if (lines[best].source == LINE_NONE) {
+				source = -1;
+				discard = lines[best].discard;
+			} else {
+				source = lines[best].source == LINE_STACK ? 0 : 1;
+				discard = -1;
+			}
+			ready = true;
+		}
+	}
+
+	running = false;
+	if (notify)
+		notify ();
+}
+
+/*
+ * Start working out a hint for @pos, as given by Logic::get_known (), and
+ * the guesses in @view, if any, unless the previous one is still running.
+ * Both are copied
+ */
+void Hint::request (const position_t *pos, const belief_view_t *view)
+{
+	if (!enabled || running)
+		return;
+	// The thread is done, so this does not wait
+	if (worker.joinable ())
+		worker.join ();
+
+	cancel ();
+	hand = pos->hand;
+	guessed = view != nullptr;
+	if (view)
+		this->view = *view;
+	search.clear_cancel ();
+	running = true;
+	worker = std::thread (&Hint::run, this, *pos, (unsigned) generation);
+}
+
+/*
+ * Drop the current hint, telling its computation to stop if still running
+ */
+void Hint::cancel ()
+{
+	generation++;
+	search.cancel ();
+	hand = HINT_NONE;
+
+	std::lock_guard<std::mutex> guard (lock);
+	ready = false;
+	source = -1;
+	discard = -1;
+}
@@ -0,0 +1,76 @@
+/*
+ *
+ * Copyright 2023 Daniel Dwek
+ *
+ * This file is part of chin-chon-lin.
+ *
+ *  chin-chon-lin is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  chin-chon-lin is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with chin-chon-lin.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#ifndef _HINT_H_
+#define _HINT_H_
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include "Belief.h"
+#include "Mask.h"
+#include "Search.h"
+
+// Hand of no hint at all, since hands have at most eight cards
+#define HINT_NONE	(~(mask_t) 0)
+
+class Hint {
+public:
+	Hint ();
+	Hint (Hint&) = delete;
+	Hint (Hint&&) = delete;
+	Hint& operator= (Hint&) = delete;
+	~Hint ();
+
+	bool is_enabled () const;
+	bool is_ready ();
+	bool is_running () const;
+	mask_t get_hand () const;
+	int get_source ();
+	int get_discard ();
+	int get_budget () const;
+
+	void set_enabled (bool enabled);
+	void set_budget (int budget);
+	void set_notify (void (*notify) ());
+
+	void request (const position_t *pos, const belief_view_t *view);
+	void cancel ();
+private:
+	void run (position_t pos, unsigned generation);
+
+	Search search;
+	std::thread worker;
+	std::mutex lock;
+	std::atomic<unsigned> generation;
+	std::atomic<bool> running;
+	bool enabled;
+	bool ready;
+	mask_t hand;
+	int source;
+	int discard;
+	belief_view_t view;
+	bool guessed;
+	uint64_t seed;
+	void (*notify) ();
+};
+
+extern class Hint hint;
+
+#endif
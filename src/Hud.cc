@@ -0,0 +1,235 @@
+/*
+ *
+ * Copyright 2023 Daniel Dwek
+ *
+ * This file is part of chin-chon-lin.
+ *
+ *  chin-chon-lin is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  chin-chon-lin is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with chin-chon-lin.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include "gettext.h"
+#define _(String) gettext (String)
+#include <stdio.h>
+#include <algorithm>
+#include <atomic>
+#include <gtk/gtk.h>
+#include <cairo.h>
+
+typedef enum { HUD_PAINT = 0, HUD_HANDS, HUD_PILES, HUD_BOTS, HUD_ANIMATION, HUD_STAGES } stage_t;
+
+// Number of frames statistics are taken over
+#define HUD_FRAMES	128
+
+class Hud {
+public:
+	Hud ();
+	Hud (Hud&) = delete;
+	Hud (Hud&&) = delete;
+	Hud& operator= (Hud&) = delete;
+	~Hud ();
+
+	bool is_enabled () const;
+	void set_enabled (bool enabled);
+
+	void begin (stage_t stage);
+	void end (stage_t stage);
+	void count_render ();
+	void start_frame ();
+	void end_frame ();
+	void draw (cairo_t *cr);
+private:
+	static gboolean refresh_cb (gpointer data);
+
+	bool enabled;
+	gint64 started[HUD_STAGES];
+	gint64 current[HUD_STAGES];
+	gint64 stage[HUD_STAGES][HUD_FRAMES];
+	gint64 frame_start;
+	gint64 last_start;
+	gint64 interval[HUD_FRAMES];
+	gint64 duration[HUD_FRAMES];
+	unsigned rendered[HUD_FRAMES];
+	unsigned long frames;
+	std::atomic<unsigned> renders;
+	guint tid;
+};
+
+extern GtkWidget *drawing_area;
+
+static const char *stagename[HUD_STAGES] = { "paint", "hands", "piles", "bots", "animation" };
+
+// Corner of the board the overlay is drawn at, and its size
+#define HUD_X		10.0
+#define HUD_Y		10.0
+#define HUD_WIDTH	300.0
+#define HUD_LINE	15.0
+#define HUD_LINES	(HUD_STAGES + 3)
+
+/*
+ * Overlay telling where the time of every frame goes: frames per second,
+ * percentiles of the time taken to draw a frame, how much of it each
+ * stage took on average and how many SVG renders were done, all of them
+ * over the last HUD_FRAMES frames.
+ *
+ * Stages are timed by begin () and end () calls around them, which cost
+ * nothing but a test while the overlay is disabled. A stage may be timed
+ * several times in a frame, e.g. for every card of a hand, and adds up.
+ * Renders are counted from any thread
+ */
+Hud::Hud ()
+{
+	enabled = false;
+	for (int i = 0; i < HUD_STAGES; i++) {
+		started[i] = -1;
+		current[i] = 0;
+	}
+	frame_start = 0;
+	last_start = 0;
+	frames = 0;
+	renders = 0;
+	tid = 0;
+}
+
+Hud::~Hud ()
+{
+}
+
+bool Hud::is_enabled () const
+{
+	return enabled;
+}
+
+void Hud::set_enabled (bool enabled)
+{
+	if (enabled == this->enabled)
+		return;
+	this->enabled = enabled;
+	frames = 0;
+	frame_start = 0;
+	last_start = 0;
+	for (int i = 0; i < HUD_STAGES; i++) {
+		started[i] = -1;
+		current[i] = 0;
+	}
+	renders = 0;
+
+	// Only the damaged parts of the board are redrawn, so the overlay is
+	// refreshed on its own twice a second
+	if (tid)
+		g_source_remove (tid);
+	tid = enabled ? g_timeout_add (500, refresh_cb, this) : 0;
+	if (drawing_area)
+		gtk_widget_queue_draw (drawing_area);
+}
+
+gboolean Hud::refresh_cb (gpointer data)
+{
+	gtk_widget_queue_draw_area (drawing_area, HUD_X, HUD_Y, HUD_WIDTH, HUD_LINES * HUD_LINE + 10.0);
+	return G_SOURCE_CONTINUE;
+}
+
+void Hud::begin (stage_t stage)
+{
+	if (!enabled)
+		return;
+	started[stage] = g_get_monotonic_time ();
+}
+
+void Hud::end (stage_t stage)
+{
+	if (!enabled || started[stage] < 0)
+		return;
+	current[stage] += g_get_monotonic_time () - started[stage];
+	started[stage] = -1;
+}
+
+/*
+ * Called for every rsvg_handle_render_cairo (), from any thread
+ */
+void Hud::count_render ()
+{
+	if (enabled)
+		renders++;
+}
+
+void Hud::start_frame ()
+{
+	if (!enabled)
+		return;
+	frame_start = g_get_monotonic_time ();
+}
+
+/*
+ * Close the statistics of the frame just drawn. Whatever was timed since
+ * the previous one (e.g. the animation step, run by the frame clock before
+ * drawing) is accounted to it
+ */
+void Hud::end_frame ()
+{
+	int i = frames % HUD_FRAMES;
+
+	if (!enabled || !frame_start)
+		return;
+	duration[i] = g_get_monotonic_time () - frame_start;
+	interval[i] = last_start ? frame_start - last_start : 0;
+	last_start = frame_start;
+	for (int s = 0; s < HUD_STAGES; s++) {
+		stage[s][i] = current[s];
+		current[s] = 0;
+	}
+	rendered[i] = renders.exchange (0);
+	frames++;
+}
+
+void Hud::draw (cairo_t *cr)
+{
+	int n = frames < HUD_FRAMES ? frames : HUD_FRAMES;
+	gint64 sorted[HUD_FRAMES], elapsed = 0, total;
+	unsigned most = 0;
+	char line[HUD_LINES][64];
+	int s, i;
+
+	if (!enabled || !n)
+		return;
+
+	for (i = 0; i < n; i++) {
+		sorted[i] = duration[i];
+		elapsed += interval[i];
+		most = rendered[i] > most ? rendered[i] : most;
+	}
+	std::sort (sorted, sorted + n);
+	snprintf (line[0], sizeof (line[0]), _("%.1f fps over %d frames"), elapsed ? 1e6 * n / elapsed : .0, n);
+	snprintf (line[1], sizeof (line[1]), _("frame p50 %.2f  p95 %.2f  p99 %.2f ms"),
+		sorted[n / 2] / 1e3, sorted[n * 95 / 100] / 1e3, sorted[n * 99 / 100] / 1e3);
+	for (s = 0; s < HUD_STAGES; s++) {
+		for (i = 0, total = 0; i < n; i++)
+			total += stage[s][i];
+		snprintf (line[2 + s], sizeof (line[2 + s]), "%-10s %.3f ms", stagename[s], total / 1e3 / n);
+	}
+	snprintf (line[HUD_LINES - 1], sizeof (line[HUD_LINES - 1]), _("rsvg renders %u last, %u at most"),
+		rendered[(frames - 1) % HUD_FRAMES], most);
+
+	cairo_save (cr);
+	cairo_set_source_rgba (cr, 0.0, 0.0, 0.0, 0.7);
+	cairo_rectangle (cr, HUD_X, HUD_Y, HUD_WIDTH, HUD_LINES * HUD_LINE + 10.0);
+	cairo_fill (cr);
+	cairo_set_source_rgb (cr, 1.0, 1.0, 1.0);
+	cairo_select_font_face (cr, "monospace", CAIRO_FONT_SLANT_NORMAL, CAIRO_FONT_WEIGHT_NORMAL);
+	cairo_set_font_size (cr, 12.0);
+	for (i = 0; i < HUD_LINES; i++) {
+		cairo_move_to (cr, HUD_X + 5.0, HUD_Y + 5.0 + (i + 1) * HUD_LINE - 3.0);
+		cairo_show_text (cr, line[i]);
+	}
+	cairo_restore (cr);
+}
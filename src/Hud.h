@@ -0,0 +1,67 @@
+/*
+ *
+ * Copyright 2023 Daniel Dwek
+ *
+ * This file is part of chin-chon-lin.
+ *
+ *  chin-chon-lin is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  chin-chon-lin is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with chin-chon-lin.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#ifndef _HUD_H_
+#define _HUD_H_
+#include <atomic>
+#include <gtk/gtk.h>
+#include <cairo.h>
+
+typedef enum { HUD_PAINT = 0, HUD_HANDS, HUD_PILES, HUD_BOTS, HUD_ANIMATION, HUD_STAGES } stage_t;
+
+// Number of frames statistics are taken over
+#define HUD_FRAMES	128
+
+class Hud {
+public:
+	Hud ();
+	Hud (Hud&) = delete;
+	Hud (Hud&&) = delete;
+	Hud& operator= (Hud&) = delete;
+	~Hud ();
+
+	bool is_enabled () const;
+	void set_enabled (bool enabled);
+
+	void begin (stage_t stage);
+	void end (stage_t stage);
+	void count_render ();
+	void start_frame ();
+	void end_frame ();
+	void draw (cairo_t *cr);
+private:
+	static gboolean refresh_cb (gpointer data);
+
+	bool enabled;
+	gint64 started[HUD_STAGES];
+	gint64 current[HUD_STAGES];
+	gint64 stage[HUD_STAGES][HUD_FRAMES];
+	gint64 frame_start;
+	gint64 last_start;
+	gint64 interval[HUD_FRAMES];
+	gint64 duration[HUD_FRAMES];
+	unsigned rendered[HUD_FRAMES];
+	unsigned long frames;
+	std::atomic<unsigned> renders;
+	guint tid;
+};
+
+extern class Hud hud;
+#endif
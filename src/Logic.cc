@@ -22,12 +22,24 @@
 #define _(String) gettext (String)
 #include <iostream>
 #include <iomanip>
+#include <atomic>
+#include <mutex>
 #include <string>
 #include <set>
+#include <thread>
 #include "Board.h"
 #include "Player.h"
 #include "Deck.h"
 #include "Stack.h"
+#include "Mask.h"
+#include "Tracker.h"
+#include "Belief.h"
+#include "Search.h"
+#include "Distance.h"
+#include "Strategy.h"
+#include "Value.h"
+#include "Review.h"
+#include "Cmdline.h"
 
 typedef struct {
 	int number;
@@ -52,13 +64,24 @@ public:
 	std::string get_comp_criteria ();
 	int get_max_total_points () const;
 	int get_flexible_ending () const;
+	int get_difficulty () const;
 
 	void set_comp_criteria (std::string comp);
 	void set_max_total_points (int max_total_points);
 	void set_flexible_ending (int flexible_ending);
+	void set_difficulty (int difficulty);
+	void set_notify (void (*notify) ());
 
 	std::set<struct card_st> determine_missing_cards (int nplayer);
+	double get_live_outs (int nplayer, mask_t hand);
+	void get_known (int nplayer, position_t *ret);
+	void get_position (int nplayer, position_t *ret);
+	bool ponder (int nplayer);
+	void cancel_ponder ();
+	void stop_ponder ();
 	int choose_source ();
+	int choose_discard (int nplayer);
+	void record_move (int nplayer, source_t source, int discard);
 	bool get_sub_stair (stair_t *stair, int *io_start, int *ret_length);
 	bool check_extra_cards_for_stair (stair_t *stair, int *last, int n_extra, int start);
 	void get_next_end_for_stair (stair_t *stair, int suit, int *end1, int *end2);
@@ -67,6 +90,9 @@ public:
 	stair_t *get_existing_cards_for_stair (int nplayer, int suit);
 	void get_game_combos ();
 	void rearrange_common_cards ();
+	bool is_worth_finishing (int nplayer);
+	Distance *get_distance (int nplayer);
+	int get_distance_to_close (int nplayer);
 	int advise_to_finish ();
 	void calc_scores (int nplayer);
 private:
@@ -74,15 +100,45 @@ private:
 	bool ordered;
 	int max_total_points;
 	int flexible_ending;
+	int difficulty;
+	int planned;
+	Distance distance[4];
+
+	void think (position_t pos, unsigned generation);
+	bool has_thought (int nplayer);
+
+	std::thread worker;
+	std::mutex lock;
+	std::atomic<unsigned> generation;
+	std::atomic<bool> thinking;
+	bool thought;			// the lookahead below is worked out
+	int thought_player;
+	mask_t thought_hand;
+	line_t thought_line;
+	long thought_rollouts;
+	double thought_value;
+	void (*notify) ();
 };
 
+extern class Cmdline cmdline;
+
 Logic::Logic ()
 {
 	ordered = false;
+	difficulty = 1;
+	planned = -1;
+	generation = 0;
+	thinking = false;
+	thought = false;
+	thought_player = -1;
+	thought_hand = 0;
+	notify = nullptr;
 }
 
 Logic::~Logic ()
 {
+	if (worker.joinable ())
+		worker.join ();
 }
 
 std::string Logic::get_comp_criteria ()
@@ -100,6 +156,16 @@ int Logic::get_flexible_ending () const
 	return flexible_ending;
 }
 
+/*
+ * 0 (easy) leaves bots with the plain heuristics, 1 (normal) lets them
+ * guess what their opponents hold and 2 (hard) makes them look ahead
+ * before every move
+ */
+int Logic::get_difficulty () const
+{
+	return difficulty;
+}
+
 void Logic::set_comp_criteria (std::string comp)
 {
 	this->comp = comp;
@@ -115,6 +181,20 @@ void Logic::set_flexible_ending (int flexible_ending)
 	this->flexible_ending = flexible_ending;
 }
 
+void Logic::set_difficulty (int difficulty)
+{
+	this->difficulty = difficulty;
+}
+
+/*
+ * @notify is called from the background thread whenever a lookahead
+ * started by ponder () is done
+ */
+void Logic::set_notify (void (*notify) ())
+{
+	this->notify = notify;
+}
+
 std::set<struct card_st> Logic::determine_missing_cards (int nplayer)
 {
 	int i, j, number, suit, prev, next;
@@ -180,9 +260,176 @@ std::set<struct card_st> Logic::determine_missing_cards (int nplayer)
 	return ret_missing;
 }
 
+/*
+ * Expected number of cards which would complete a combo together with
+ * @hand and which are still alive, i.e. neither lying on the stack nor,
+ * according to the belief of @nplayer, held by any opponent
+ */
+double Logic::get_live_outs (int nplayer, mask_t hand)
+{
+	int i, c;
+	double live, outs = 0.0;
+	mask_t pool = MASK_ALL & ~hand & ~tracker.get_pile ();
+
+	for (i = 0; i < 4; i++)
+		if (i != nplayer)
+			pool &= ~tracker.get_held (i);
+
+	for (; pool; pool &= pool - 1) {
+		c = mask_first (pool);
+		if (!mask_useful (hand, c / 12, c % 12 + 1))
+			continue;
+		live = 1.0;
+		for (i = 0; i < 4; i++)
+			if (i != nplayer)
+				live *= 1.0 - belief.get_probability (nplayer, i, (mask_t) 1 << c);
+		outs += live;
+	}
+
+	return outs;
+}
+
+/*
+ * What @nplayer knows for sure about the round: its own hand, the stack of
+ * played cards, how many cards everybody holds and which of them were seen
+ * being picked up, without any guesses of the rest
+ */
+void Logic::get_known (int nplayer, position_t *ret)
+{
+	int i;
+	std::list<Card>::reverse_iterator iter;
+	std::list<Card>& pile = stack_played.get_cards ();
+
+	ret->observer = nplayer;
+	ret->hand = tracker.get_mask (player[nplayer].get_cards ());
+	ret->npile = 0;
+	for (iter = pile.rbegin (); iter != pile.rend (); iter++)
+		ret->pile[ret->npile++] = mask_idx (iter->get_suit (), iter->get_number ());
+	ret->deck_size = deck.get_cards().size ();
+	ret->flexible_ending = flexible_ending;
+	for (i = 0; i < 4; i++) {
+		ret->hand_size[i] = player[i].get_cards().size ();
+		ret->known[i] = i != nplayer ? tracker.get_held (i) : 0;
+		ret->nsamples[i] = 0;
+	}
+}
+
+/*
+ * Everything @nplayer knows about the round, as needed by the lookahead:
+ * get_known () and some guesses of the rest
+ */
+void Logic::get_position (int nplayer, position_t *ret)
+{
+	get_known (nplayer, ret);
+	for (int i = 0; i < 4; i++)
+		if (i != nplayer && belief.is_ready ())
+			ret->nsamples[i] = belief.sample (nplayer, i, ret->samples[i], SEARCH_SAMPLES);
+}
+
+/*
+ * Background thread of ponder (): search @pos and keep the best line
+ */
+void Logic::think (position_t pos, unsigned generation)
+{
+	int n, best;
+	line_t lines[SEARCH_LINES];
+
+	n = search.get_lines (&pos, lines);
+	best = n ? search.choose (&pos, lines, n) : -1;
+	{
+		std::lock_guard<std::mutex> guard (lock);
+
+		if (best != -1 && generation == this->generation) {
+			thought_player = pos.observer;
+			thought_hand = pos.hand;
+			thought_line = lines[best];
+			thought_rollouts = search.get_rollouts ();
+			thought_value = search.get_value (best);
+			thought = true;
+		}
+	}
+
+	thinking = false;
+	if (notify)
+		notify ();
+}
+
+/*
+ * Whether the lookahead worked out by ponder () is the one of @nplayer
+ * holding its current hand
+ */
+bool Logic::has_thought (int nplayer)
+{
+	std::lock_guard<std::mutex> guard (lock);
+
+	return thought && thought_player == nplayer &&
+	       thought_hand == tracker.get_mask (player[nplayer].get_cards ());
+}
+
+/*
+ * At the hardest difficulty, bots search for up to a few hundred
+ * milliseconds before drawing and again before discarding (unless the
+ * discard came with the draw). The search runs on a background thread, so
+ * that the GUI keeps drawing: the game asks here before every decision of
+ * a bot, and only goes on with it once this returns true. Until then the
+ * search is started, if not running yet, and the GUI is told when it is
+ * done through the notify callback
+ */
+bool Logic::ponder (int nplayer)
+{
+	int c = planned;
+	position_t pos;
+
+	if (difficulty != 2 || thinking)
+		return difficulty != 2;
+	if (player[nplayer].get_cards().size () == 7 && !stack_played.get_cards().size ())
+		return true;
+	if (player[nplayer].get_cards().size () == 8 && c != -1 && player[nplayer].get_idx (c / 12, c % 12 + 1) != -1)
+		return true;
+	if (has_thought (nplayer))
+		return true;
+
+	// The thread is done, so this does not wait
+	if (worker.joinable ())
+		worker.join ();
+	get_position (nplayer, &pos);
+	search.clear_cancel ();
+	thinking = true;
+	worker = std::thread (&Logic::think, this, pos, (unsigned) generation);
+
+	return false;
+}
+
+/*
+ * Drop whatever ponder () worked out or is still working out, e.g. when a
+ * new round starts, without waiting for it
+ */
+void Logic::cancel_ponder ()
+{
+	generation++;
+	search.cancel ();
+
+	std::lock_guard<std::mutex> guard (lock);
+	thought = false;
+}
+
+/*
+ * Cancel ponder () and wait for it, when quitting: its thread runs on the
+ * global search, which is destroyed before the logic
+ */
+void Logic::stop_ponder ()
+{
+	cancel_ponder ();
+	if (worker.joinable ())
+		worker.join ();
+}
+
 int Logic::choose_source ()
 {
-	int source = 1;
+	int source = 1, n, action, c, t, discard, nunseen;
+	float from_stack, from_deck;
+	mask_t hand, top, pile, unseen;
+	Distance *distance;
 	std::set<struct card_st> cards;
 	std::set<struct card_st>::const_iterator iter;
 	StackPlayed& s = stack_played;
@@ -193,6 +440,76 @@ int Logic::choose_source ()
 		    iter->number == s.get_cards().front().get_number ())
 			source = 0;
 
+	// Take it as well whenever it brings the hand closer to an ending
+	if (source && difficulty > 0 && s.get_cards().size ()) {
+		distance = get_distance (board.get_turn ());
+		if (distance->get_distance_with (mask_idx (s.get_cards().front().get_suit (),
+							s.get_cards().front().get_number ())) < distance->get_distance ())
+			source = 0;
+	}
+
+	// Even if it does not complete a combo right now, the card on top of
+	// the stack is worth taking when it opens at least two new ways of
+	// making one that, on average over the opponents' guessed hands, are
+	// still available
+	if (source && difficulty > 0 && belief.is_ready () && s.get_cards().size ()) {
+		hand = tracker.get_mask (player[board.get_turn ()].get_cards ());
+		top = mask_bit (s.get_cards().front().get_suit (), s.get_cards().front().get_number ());
+		if (!(hand & top) && get_live_outs (board.get_turn (), hand | top) -
+					get_live_outs (board.get_turn (), hand) >= 2.0)
+			source = 0;
+	}
+
+	// Bots at the normal difficulty rank both sources by the value function
+	// trained offline: the best discard after taking the stack's top card
+	// against the average best discard over every card the deck may hold
+	if (difficulty == 1 && value.is_loaded () && player[board.get_turn ()].get_cards().size () == 7 &&
+	    s.get_cards().size () && deck.get_cards().size ()) {
+		hand = tracker.get_mask (player[board.get_turn ()].get_cards ());
+		pile = tracker.get_pile ();
+		t = mask_idx (s.get_cards().front().get_suit (), s.get_cards().front().get_number ());
+		from_stack = value.evaluate_best (hand | (mask_t) 1 << t, pile & ~((mask_t) 1 << t),
+						  deck.get_cards().size (), &discard);
+		unseen = MASK_ALL & ~hand & ~pile;
+		for (n = 0; n < 4; n++)
+			if (n != board.get_turn ())
+				unseen &= ~tracker.get_held (n);
+		from_deck = 0.0f;
+		nunseen = 0;
+		for (; unseen; unseen &= unseen - 1, nunseen++)
+			from_deck += value.evaluate_best (hand | (unseen & -unseen), pile,
+							deck.get_cards().size () - 1, &c);
+		if (nunseen) {
+			source = from_stack > from_deck / nunseen ? 0 : 1;
+			planned = source ? -1 : discard;
+		}
+	// Otherwise they follow the strategy table computed offline, whenever
+	// it has seen enough hands like this one
+	} else if (difficulty == 1 && strategy.is_loaded () && player[board.get_turn ()].get_cards().size () == 7 &&
+	    s.get_cards().size ()) {
+		action = strategy.choose (strategy.get_source_infoset (
+					tracker.get_mask (player[board.get_turn ()].get_cards ()),
+					tracker.get_pile (),
+					mask_idx (s.get_cards().front().get_suit (), s.get_cards().front().get_number ()),
+					deck.get_cards().size ()), rand () / (RAND_MAX + 1.0));
+		if (action != -1)
+			source = action;
+	}
+
+	// At the hardest difficulty the lookahead worked out by ponder () has
+	// the last word. It also decides which card to play afterwards, if
+	// taking the stack's one
+	if (difficulty == 2 && player[board.get_turn ()].get_cards().size () == 7 && s.get_cards().size () &&
+	    has_thought (board.get_turn ())) {
+		std::lock_guard<std::mutex> guard (lock);
+
+		source = thought_line.source == LINE_STACK ? 0 : 1;
+		planned = thought_line.source == LINE_STACK ? thought_line.discard : -1;
+		thought = false;
+		std::cout << __FUNCTION__ << ": " << thought_rollouts << " rollouts, expected gain = " <<
+			thought_value << std::endl;
+	}
+
 	if (!deck.get_cards().size ())
 		source = 0;
 	if (!stack_played.get_cards().size ())
@@ -201,6 +518,67 @@ int Logic::choose_source ()
 	return source;
 }
 
+/*
+ * Card to be played by @nplayer as the value function or the strategy
+ * table (normal difficulty) or the lookahead (hard difficulty) say, as an
+ * index into its hand, or -1 to let the usual heuristics decide
+ */
+int Logic::choose_discard (int nplayer)
+{
+	int action, c = planned, cards[2];
+
+	planned = -1;
+	if (difficulty == 1 && value.is_loaded ()) {
+		if (c == -1 || player[nplayer].get_idx (c / 12, c % 12 + 1) == -1)
+			value.evaluate_best (tracker.get_mask (player[nplayer].get_cards ()), tracker.get_pile (),
+					     deck.get_cards().size (), &c);
+		return c != -1 ? player[nplayer].get_idx (c / 12, c % 12 + 1) : -1;
+	}
+	if (difficulty == 1) {
+		action = strategy.choose (strategy.get_discard_infoset (
+					tracker.get_mask (player[nplayer].get_cards ()),
+					tracker.get_pile (), deck.get_cards().size (), cards),
+					rand () / (RAND_MAX + 1.0));
+		return action != -1 ? player[nplayer].get_idx (cards[action] / 12, cards[action] % 12 + 1) : -1;
+	}
+	if (difficulty < 2)
+		return -1;
+
+	if (c == -1 || player[nplayer].get_idx (c / 12, c % 12 + 1) == -1) {
+		if (!has_thought (nplayer))
+			return -1;
+
+		std::lock_guard<std::mutex> guard (lock);
+		c = thought_line.discard;
+		thought = false;
+	}
+
+	return player[nplayer].get_idx (c / 12, c % 12 + 1);
+}
+
+/*
+ * Keep the move of @nplayer for the review at the end of the round, if
+ * enabled. It must be called right before the move changes anything
+ */
+void Logic::record_move (int nplayer, source_t source, int discard)
+{
+	position_t pos;
+	line_t line;
+	belief_view_t view;
+
+	if (!cmdline.is_review_mode ())
+		return;
+	// Guesses are only sampled by the review itself, so that reviewing
+	// does not change how the bots play
+	get_known (nplayer, &pos);
+	if (belief.is_ready ())
+		belief.get_view (nplayer, &view);
+	line.source = source;
+	line.discard = discard;
+	line.close = false;
+	review.record (nplayer, &pos, belief.is_ready () ? &view : nullptr, &line);
+}
+
 bool Logic::get_sub_stair (stair_t *stair, int *io_start, int *ret_length)
 {
 	int i, start = 0, length = 0;
@@ -595,6 +973,114 @@ void Logic::rearrange_common_cards ()
 	}
 }
 
+/*
+ * With flexible ending a player may close with two combos of three cards
+ * each, being charged the points of the card left out. Compare doing so
+ * right now against keeping on playing one more turn, hoping to draw a card
+ * which turns one of the combos into a combo of four. Waiting is risky,
+ * though: any opponent could close before, and then nobody else would get
+ * the points the closing player was expected to be charged
+ */
+bool Logic::is_worth_finishing (int nplayer)
+{
+	int i, j, n, npool, leftover;
+	double risk = 1.0, opp_pts = 0.0, improve, now, wait;
+	mask_t hand, combos = 0, outs = 0, rest, pool;
+	struct card_st *c = nullptr;
+	threat_t threat;
+	Player& p = player[nplayer];
+
+	hand = tracker.get_mask (p.get_cards ());
+	for (i = 0; i < 2; i++) {
+		for (j = 0; j < p.get_combo_length (i); j++) {
+			c = p.get_combo_card (i, j);
+			if (c->suit < 0 || c->number < 1)
+				continue;
+			combos |= mask_bit (c->suit, c->number);
+			if (p.get_combo_type (i) == TYPE_GROUP) {
+				outs |= mask_number (c->number);
+			} else {
+				if (c->number > 1)
+					outs |= mask_bit (c->suit, c->number - 1);
+				if (c->number < 12)
+					outs |= mask_bit (c->suit, c->number + 1);
+			}
+		}
+	}
+
+	// The highest card out of the combos is the one to be discarded
+	rest = hand & ~combos;
+	leftover = mask_points (rest);
+	if (mask_count (rest) > 1) {
+		for (n = 12; n > 0; n--) {
+			if (rest & mask_number (n)) {
+				leftover -= n;
+				break;
+			}
+		}
+	}
+
+	pool = MASK_ALL & ~hand & ~tracker.get_pile ();
+	for (i = 0; i < 4; i++)
+		if (i != nplayer)
+			pool &= ~tracker.get_held (i);
+	npool = mask_count (pool);
+	outs &= pool;
+	improve = npool ? (double) mask_count (outs) / npool : 0.0;
+
+	for (i = 0; i < 4; i++) {
+		if (i == nplayer)
+			continue;
+		tracker.get_threat (i, hand, &threat);
+		risk *= 1.0 - threat.closing;
+		opp_pts += threat.points / 3.0;
+	}
+	risk = 1.0 - risk;
+
+	now = leftover - opp_pts;
+	wait = risk * (leftover - opp_pts * 2.0 / 3.0) +
+		(1.0 - risk) * (improve * -opp_pts + (1.0 - improve) * now);
+
+	std::cout << _("Player #") << nplayer << _(": leftover = ") << leftover <<
+		_(", risk = ") << risk << _(", improve = ") << improve <<
+		_(", opponents = ") << opp_pts << std::endl;
+
+	return now <= wait;
+}
+
+/*
+ * Distance calculator of @nplayer, brought up to date with its hand and the
+ * cards nobody can take anymore: those buried in the stack (the one on top
+ * is still available) and those the other players were seen picking up
+ */
+Distance *Logic::get_distance (int nplayer)
+{
+	int i;
+	mask_t dead = tracker.get_pile ();
+	StackPlayed& s = stack_played;
+
+	if (s.get_cards().size ())
+		dead &= ~mask_bit (s.get_cards().front().get_suit (), s.get_cards().front().get_number ());
+	for (i = 0; i < 4; i++)
+		if (i != nplayer)
+			dead |= tracker.get_held (i);
+
+	distance[nplayer].set_flexible_ending (flexible_ending);
+	distance[nplayer].set_dead (dead);
+	distance[nplayer].set_hand (tracker.get_mask (player[nplayer].get_cards ()));
+
+	return &distance[nplayer];
+}
+
+/*
+ * How many cards @nplayer has to swap before being able to finish the
+ * round, whatever the kind of ending
+ */
+int Logic::get_distance_to_close (int nplayer)
+{
+	return get_distance (nplayer)->get_distance ();
+}
+
 int Logic::advise_to_finish ()
 {
 	Player& p = player[board.get_turn ()];
@@ -619,6 +1105,8 @@ int Logic::advise_to_finish ()
 	} else if (p.get_combo_length (0) == 3 && p.get_combo_length (1) == 3 && flexible_ending == 1) {
 		std::cout << _("Warning: ") << player[board.get_turn ()].get_name () <<
 			_(" has two combos of three cards each") << std::endl;
+		if (!is_worth_finishing (board.get_turn ()))
+			return 0;
 		return 1;
 	}
 
@@ -20,8 +20,14 @@
  */
 #ifndef _LOGIC_H_
 #define _LOGIC_H_
+#include <atomic>
+#include <mutex>
 #include <string>
 #include <set>
+#include <thread>
+#include "Mask.h"
+#include "Search.h"
+#include "Distance.h"
 
 typedef struct {
 	int number;
@@ -46,13 +52,24 @@ public:
 	std::string get_comp_criteria ();
 	int get_max_total_points () const;
 	int get_flexible_ending () const;
+	int get_difficulty () const;
 
 	void set_comp_criteria (std::string comp);
 	void set_max_total_points (int max_total_points);
 	void set_flexible_ending (int flexible_ending);
+	void set_difficulty (int difficulty);
+	void set_notify (void (*notify) ());
 
 	std::set<struct card_st> determine_missing_cards (int nplayer);
+	double get_live_outs (int nplayer, mask_t hand);
+	void get_known (int nplayer, position_t *ret);
+	void get_position (int nplayer, position_t *ret);
+	bool ponder (int nplayer);
+	void cancel_ponder ();
+	void stop_ponder ();
 	int choose_source ();
+	int choose_discard (int nplayer);
+	void record_move (int nplayer, source_t source, int discard);
 	bool get_sub_stair (stair_t *stair, int *io_start, int *ret_length);
 	bool check_extra_cards_for_stair (stair_t *stair, int *last, int n_extra, int start);
 	void get_next_end_for_stair (stair_t *stair, int suit, int *end1, int *end2);
@@ -61,6 +78,9 @@ public:
 	stair_t *get_existing_cards_for_stair (int nplayer, int suit);
 	void get_game_combos ();
 	void rearrange_common_cards ();
+	bool is_worth_finishing (int nplayer);
+	Distance *get_distance (int nplayer);
+	int get_distance_to_close (int nplayer);
 	int advise_to_finish ();
 	void calc_scores (int nplayer);
 private:
@@ -68,6 +88,24 @@ private:
 	bool ordered;
 	int max_total_points;
 	int flexible_ending;
+	int difficulty;
+	int planned;
+	Distance distance[4];
+
+	void think (position_t pos, unsigned generation);
+	bool has_thought (int nplayer);
+
+	std::thread worker;
+	std::mutex lock;
+	std::atomic<unsigned> generation;
+	std::atomic<bool> thinking;
+	bool thought;			// the lookahead below is worked out
+	int thought_player;
+	mask_t thought_hand;
+	line_t thought_line;
+	long thought_rollouts;
+	double thought_value;
+	void (*notify) ();
 };
 
 extern class Logic logic;
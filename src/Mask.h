@@ -0,0 +1,114 @@
+/*
+ *
+ * Copyright 2023 Daniel Dwek
+ *
+ * This file is part of chin-chon-lin.
+ *
+ *  chin-chon-lin is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  chin-chon-lin is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with chin-chon-lin.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#ifndef _MASK_H_
+#define _MASK_H_
+#include <stdint.h>
+
+/*
+ * Compact representation of a set of cards as a 48-bit mask. Bit number
+ * "suit * 12 + number - 1" stands for the card of such suit and number,
+ * which is the very same index used for the global card[48] array
+ */
+typedef uint64_t mask_t;
+
+#define MASK_ALL	((mask_t) 0xffffffffffffULL)
+#define MASK_SUIT	((mask_t) 0xfffULL)
+#define MASK_NUMBER	((mask_t) 0x001001001001ULL)
+
+static inline int mask_idx (int suit, int number)
+{
+	return suit * 12 + number - 1;
+}
+
+static inline mask_t mask_bit (int suit, int number)
+{
+	return (mask_t) 1 << mask_idx (suit, number);
+}
+
+static inline mask_t mask_suit (int suit)
+{
+	return MASK_SUIT << (suit * 12);
+}
+
+static inline mask_t mask_number (int number)
+{
+	return MASK_NUMBER << (number - 1);
+}
+
+static inline int mask_count (mask_t m)
+{
+	return __builtin_popcountll (m);
+}
+
+static inline int mask_first (mask_t m)
+{
+	return __builtin_ctzll (m);
+}
+
+/*
+ * Sum of the numbers of every card in @m, i.e. the points a player
+ * would be charged for them when the round ends
+ */
+static inline int mask_points (mask_t m)
+{
+	int points = 0;
+
+	for (int number = 1; number < 13; number++)
+		points += number * mask_count (m & mask_number (number));
+	return points;
+}
+
+/*
+ * Index of the @r-th card (counting from zero) set in @m
+ */
+static inline int mask_select (mask_t m, int r)
+{
+	int n;
+
+	for (int suit = 0; suit < 4; suit++) {
+		n = mask_count (m & mask_suit (suit));
+		if (r < n)
+			break;
+		r -= n;
+		m &= ~mask_suit (suit);
+	}
+	while (r--)
+		m &= m - 1;
+	return mask_first (m);
+}
+
+/*
+ * Whether the card of @suit and @number would complete a combo of three
+ * cards (or extend a longer one) together with the cards in @hand
+ */
+static inline bool mask_useful (mask_t hand, int suit, int number)
+{
+	bool b[5];
+
+	if (mask_count (hand & mask_number (number) & ~mask_bit (suit, number)) >= 2)
+		return true;
+	for (int k = -2; k <= 2; k++)
+		b[k + 2] = k && number + k >= 1 && number + k <= 12 &&
+				(hand & mask_bit (suit, number + k));
+	return (b[0] && b[1]) || (b[1] && b[3]) || (b[3] && b[4]);
+}
+
+#endif
@@ -0,0 +1,583 @@
+/*
+ *
+ * Copyright 2023 Daniel Dwek
+ *
+ * This file is part of chin-chon-lin.
+ *
+ *  chin-chon-lin is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  chin-chon-lin is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with chin-chon-lin.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include <math.h>
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "Mask.h"
+#include "Meld.h"
+#include "Sim.h"
+#include "Strategy.h"
+#include "Value.h"
+
+typedef enum {
+	BOT_GREEDY,
+	BOT_STRATEGY,
+	BOT_VALUE
+} bot_kind_t;
+
+typedef struct {
+	bot_kind_t kind;
+	const Strategy *table;
+	const Value *weights;
+} bot_t;
+
+// Deals the workers may play ahead of the sequential test
+#define MATCH_RING	256
+
+typedef struct {
+	double diff;
+	double points[4][4];
+} deal_t;
+
+// Deals played by the workers, each one in the slot of its number modulo
+// MATCH_RING. A slot is published by storing the number of its deal into
+// its sequence, and handed back once the test added up past it
+typedef struct {
+	deal_t deal[MATCH_RING];
+	std::atomic<long> seq[MATCH_RING];
+	std::atomic<long> first;	// next deal to be added up
+	std::atomic<bool> stop;
+} queue_t;
+
+class Match {
+public:
+	Match ();
+	Match (Match&) = delete;
+	Match (Match&&) = delete;
+	Match& operator= (Match&) = delete;
+	~Match ();
+
+	long get_deals () const;
+	double get_mean () const;
+	double get_error () const;
+	double get_naive_error () const;
+	double get_points (int nbot) const;
+	double get_points_error (int nbot) const;
+	double get_win_rate () const;
+	double get_win_error () const;
+	double get_llr () const;
+	int get_threads () const;
+	double get_delta () const;
+	double get_alpha () const;
+	void set_bot (int nbot, const bot_t *bot);
+	void set_seed (uint64_t seed);
+	void set_threads (int threads);
+	void set_delta (double delta);
+	void set_alpha (double alpha);
+
+	void reset ();
+	double play_deal (uint64_t seed, double (*ret_points)[4]) const;
+	void duplicate (long deals);
+	int sequential (long max_deals);
+private:
+	bool choose_source (Sim *sim, const bot_t *bot, uint64_t *rng) const;
+	int choose_discard (Sim *sim, const bot_t *bot, uint64_t *rng) const;
+	void play_turn (Sim *sim, const bot_t *bot, uint64_t *rng) const;
+	uint64_t get_deal_seed (long n) const;
+	void add (double diff, double (*points)[4]);
+	void run (queue_t *queue, std::atomic<long> *next) const;
+
+	bot_t bot[2];
+	uint64_t seed;
+	int threads;
+	double delta;
+	double alpha;
+	long deals;
+	double sum;
+	double sum2;
+	double seat_sum[2];
+	double seat_sum2[2];
+	double wins;
+};
+
+// Rounds longer than this are ended without a closer
+#define MAX_TURNS	200
+
+// Bots sitting on each of the four seats in every game of a deal, so that
+// both of them play every seat (and every hand) twice
+static const int seating[4][4] = {
+	{ 0, 0, 1, 1 },
+	{ 1, 0, 0, 1 },
+	{ 1, 1, 0, 0 },
+	{ 0, 1, 1, 0 },
+};
+
+/*
+ * Duplicate match between two bots, as in duplicate bridge: every deal is
+ * played four times from the same shuffled deck (and the same reshuffles
+ * of the stack), with the bots rotated through the seats. The luck of the
+ * cards partly cancels out within a deal, so the difference of points
+ * between both bots averaged over the four games varies less than the one
+ * of independent games, the less the more alike both bots play.
+ *
+ * Matches may also be played on every core until a sequential probability
+ * ratio test tells which bot is better: workers publish the deals they
+ * play into a shared ring, without locks, and the thread running the test
+ * reads them back in the order of their seeds, backing off while the next
+ * one is not there yet
+ */
+Match::Match ()
+{
+	bot[0] = bot[1] = { BOT_GREEDY, nullptr, nullptr };
+	seed = 1;
+	threads = std::thread::hardware_concurrency ();
+	if (threads < 1)
+		threads = 1;
+	delta = 0.5;
+	alpha = 0.05;
+	reset ();
+}
+
+Match::~Match ()
+{
+}
+
+long Match::get_deals () const
+{
+	return deals;
+}
+
+/*
+ * Average points per round that bot 0 saves with respect to bot 1
+ */
+double Match::get_mean () const
+{
+	return deals ? sum / deals : 0.0;
+}
+
+/*
+ * Standard error of get_mean ()
+ */
+double Match::get_error () const
+{
+	double mean = get_mean ();
+
+	if (deals < 2)
+		return 0.0;
+	return sqrt ((sum2 / deals - mean * mean) / (deals - 1));
+}
+
+/*
+ * Standard error that get_mean () would have if the points of each bot had
+ * been averaged over as many games of their own dealt at random, for
+ * comparison
+ */
+double Match::get_naive_error () const
+{
+	int i;
+	long n = 8 * deals;
+	double mean, var = 0.0;
+
+	if (n < 2)
+		return 0.0;
+	for (i = 0; i < 2; i++) {
+		mean = seat_sum[i] / n;
+		var += (seat_sum2[i] / n - mean * mean) / (n - 1);
+	}
+	return sqrt (var);
+}
+
+/*
+ * Average points per round of bot @nbot
+ */
+double Match::get_points (int nbot) const
+{
+	long n = 8 * deals;
+
+	return n ? seat_sum[nbot] / n : 0.0;
+}
+
+double Match::get_points_error (int nbot) const
+{
+	long n = 8 * deals;
+	double mean = get_points (nbot);
+
+	if (n < 2)
+		return 0.0;
+	return sqrt ((seat_sum2[nbot] / n - mean * mean) / (n - 1));
+}
+
+/*
+ * Fraction of the games where bot 0 ended the round with the lowest
+ * points (ties count as half a win)
+ */
+double Match::get_win_rate () const
+{
+	return deals ? wins / (4 * deals) : 0.0;
+}
+
+double Match::get_win_error () const
+{
+	double p = get_win_rate ();
+
+	return deals ? sqrt (p * (1.0 - p) / (4 * deals)) : 0.0;
+}
+
+/*
+ * Log-likelihood ratio of bot 0 saving get_delta () points per round
+ * against bot 1 doing so, assuming normally distributed deals
+ */
+double Match::get_llr () const
+{
+	double mean = get_mean (), var;
+
+	if (deals < 2)
+		return 0.0;
+	var = (sum2 / deals - mean * mean) * deals / (deals - 1);
+	return var > 0.0 ? 2.0 * delta * sum / var : 0.0;
+}
+
+int Match::get_threads () const
+{
+	return threads;
+}
+
+/*
+ * Difference of points per round not worth telling apart
+ */
+double Match::get_delta () const
+{
+	return delta;
+}
+
+/*
+ * Probability of declaring the worse bot the better one
+ */
+double Match::get_alpha () const
+{
+	return alpha;
+}
+
+void Match::set_bot (int nbot, const bot_t *bot)
+{
+	this->bot[nbot] = *bot;
+}
+
+void Match::set_seed (uint64_t seed)
+{
+	this->seed = seed ? seed : 1;
+}
+
+void Match::set_threads (int threads)
+{
+	this->threads = threads > 0 ? threads : 1;
+}
+
+void Match::set_delta (double delta)
+{
+	this->delta = delta > 0.0 ? delta : 0.5;
+}
+
+void Match::set_alpha (double alpha)
+{
+	this->alpha = alpha > 0.0 && alpha < 0.5 ? alpha : 0.05;
+}
+
+void Match::reset ()
+{
+	deals = 0;
+	sum = sum2 = 0.0;
+	seat_sum[0] = seat_sum[1] = 0.0;
+	seat_sum2[0] = seat_sum2[1] = 0.0;
+	wins = 0.0;
+}
+
+/*
+ * Seed of the choices of the bot sitting on @seat in the deal shuffled
+ * from @seed (splitmix64). Bots draw from a stream of their own instead of
+ * the one of the deal, so that the reshuffles of the stack stay the same
+ * in every game of a deal whatever the bots chose
+ */
+static uint64_t policy_seed (uint64_t seed, int seat)
+{
+	uint64_t z = seed ^ (seat + 1) * 0x9e3779b97f4a7c15ULL;
+
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+	z ^= z >> 31;
+	return z ? z : 1;
+}
+
+/*
+ * Uniform random number in [0, 1) from the xorshift64* stream @rng, the
+ * same generator as Sim::next ()
+ */
+static double policy_random (uint64_t *rng)
+{
+	uint64_t s = *rng;
+
+	s ^= s >> 12;
+	s ^= s << 25;
+	s ^= s >> 27;
+	*rng = s;
+	return ((s * 0x2545f4914f6cdd1dULL) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+bool Match::choose_source (Sim *sim, const bot_t *bot, uint64_t *rng) const
+{
+	int a, c, n, top = sim->get_top ();
+	float from_stack, from_deck;
+	mask_t hand = sim->get_hand (sim->get_turn ()), pile = sim->get_pile (), unseen;
+
+	if (top == -1 || !sim->get_deck_size ())
+		return sim->choose_source ();
+
+	switch (bot->kind) {
+	case BOT_STRATEGY:
+		a = bot->table->choose (bot->table->get_source_infoset (hand, pile, top, sim->get_deck_size ()),
+					policy_random (rng));
+		if (a != -1)
+			return a == 0;
+		break;
+	case BOT_VALUE:
+		from_stack = bot->weights->evaluate_best (hand | (mask_t) 1 << top, pile & ~((mask_t) 1 << top),
+							  sim->get_deck_size (), &c);
+		from_deck = 0.0f;
+		n = 0;
+		for (unseen = MASK_ALL & ~hand & ~pile; unseen; unseen &= unseen - 1, n++)
+			from_deck += bot->weights->evaluate_best (hand | (unseen & -unseen), pile,
+								  sim->get_deck_size () - 1, &c);
+		if (n)
+			return from_stack > from_deck / n;
+		break;
+	default:
+		break;
+	}
+
+	return sim->choose_source ();
+}
+
+int Match::choose_discard (Sim *sim, const bot_t *bot, uint64_t *rng) const
+{
+	int a, c = -1, cards[2];
+	mask_t hand = sim->get_hand (sim->get_turn ()), pile = sim->get_pile ();
+
+	switch (bot->kind) {
+	case BOT_STRATEGY:
+		a = bot->table->choose (bot->table->get_discard_infoset (hand, pile, sim->get_deck_size (), cards),
+					policy_random (rng));
+		if (a != -1)
+			return cards[a];
+		break;
+	case BOT_VALUE:
+		bot->weights->evaluate_best (hand, pile, sim->get_deck_size (), &c);
+		if (c != -1)
+			return c;
+		break;
+	default:
+		break;
+	}
+
+	return sim->choose_discard ();
+}
+
+void Match::play_turn (Sim *sim, const bot_t *bot, uint64_t *rng) const
+{
+	int c;
+
+	if (sim->draw (choose_source (sim, bot, rng)) == -1) {
+		sim->finish ();
+		return;
+	}
+	if (meld_can_close (sim->get_hand (sim->get_turn ()), sim->get_flexible_ending (), &c) && sim->close (c))
+		return;
+	sim->discard (choose_discard (sim, bot, rng));
+}
+
+/*
+ * Play the four games of the deal shuffled from @seed and return the
+ * average points per round that bot 0 saved with respect to bot 1. The
+ * points of every seat are stored into @ret_points, if not null
+ */
+double Match::play_deal (uint64_t seed, double (*ret_points)[4]) const
+{
+	int i, g, perm[48];
+	uint64_t rng[4];
+	double points[2], total = 0.0;
+	Sim sim;
+
+	for (g = 0; g < 4; g++) {
+		for (i = 0; i < 48; i++)
+			perm[i] = i;
+		for (i = 0; i < 4; i++)
+			rng[i] = policy_seed (seed, i);
+		sim.set_seed (seed);
+		sim.shuffle (perm, 48);
+		sim.deal (perm);
+		while (!sim.is_over () && sim.get_turns () < MAX_TURNS)
+			play_turn (&sim, &bot[seating[g][sim.get_turn ()]], &rng[sim.get_turn ()]);
+		if (!sim.is_over ())
+			sim.finish ();
+
+		points[0] = points[1] = 0.0;
+		for (i = 0; i < 4; i++) {
+			points[seating[g][i]] += sim.get_points (i) / 2.0;
+			if (ret_points)
+				ret_points[g][i] = sim.get_points (i);
+		}
+		total += points[1] - points[0];
+	}
+
+	return total / 4;
+}
+
+/*
+ * Seed of the @n-th deal of the match (splitmix64), the same whichever
+ * thread plays it
+ */
+uint64_t Match::get_deal_seed (long n) const
+{
+	uint64_t z = seed + (n + 1) * 0x9e3779b97f4a7c15ULL;
+
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+	z ^= z >> 31;
+	return z ? z : 1;
+}
+
+/*
+ * Add up a deal to the statistics
+ */
+void Match::add (double diff, double (*points)[4])
+{
+	int g, i;
+	double best[2];
+
+	deals++;
+	sum += diff;
+	sum2 += diff * diff;
+	for (g = 0; g < 4; g++) {
+		best[0] = best[1] = 1e9;
+		for (i = 0; i < 4; i++) {
+			seat_sum[seating[g][i]] += points[g][i];
+			seat_sum2[seating[g][i]] += points[g][i] * points[g][i];
+			if (points[g][i] < best[seating[g][i]])
+				best[seating[g][i]] = points[g][i];
+		}
+		wins += best[0] < best[1] ? 1.0 : best[0] == best[1] ? 0.5 : 0.0;
+	}
+}
+
+/*
+ * Play @deals more deals and add them up to the statistics
+ */
+void Match::duplicate (long deals)
+{
+	long n, first = this->deals;
+	double diff, points[4][4];
+
+	for (n = first; n < first + deals; n++) {
+		diff = play_deal (get_deal_seed (n), points);
+		add (diff, points);
+	}
+}
+
+/*
+ * Wait a bit longer each time @spins grows, first spinning, then giving
+ * up the core, and finally sleeping, so that a thread waiting long (the
+ * test for the next deal, or a worker too far ahead) costs nothing
+ */
+static void backoff (int *spins)
+{
+	if (++*spins < 64)
+		return;
+	if (*spins < 128)
+		std::this_thread::yield ();
+	else
+		std::this_thread::sleep_for (std::chrono::microseconds (*spins < 256 ? 20 : 200));
+}
+
+/*
+ * Worker of sequential (): play the deals handed out by @next, at most
+ * MATCH_RING ahead of the ones added up, and publish them into @queue
+ * until it is stopped
+ */
+void Match::run (queue_t *queue, std::atomic<long> *next) const
+{
+	long n;
+	int spins;
+	deal_t *deal;
+
+	while (!queue->stop.load (std::memory_order_relaxed)) {
+		n = next->fetch_add (1, std::memory_order_relaxed);
+
+		// The slot is free once the test added up the deal before in it
+		for (spins = 0; n - queue->first.load (std::memory_order_acquire) >= MATCH_RING; backoff (&spins))
+			if (queue->stop.load (std::memory_order_relaxed))
+				return;
+
+		deal = &queue->deal[n % MATCH_RING];
+		deal->diff = play_deal (get_deal_seed (n), deal->points);
+		queue->seq[n % MATCH_RING].store (n, std::memory_order_release);
+	}
+}
+
+/*
+ * Play deals on get_threads () threads until the sequential probability
+ * ratio test between "bot 0 saves get_delta () points per round" and "bot
+ * 1 does" is decided, or @max_deals deals were played. Returns 0 or 1 for
+ * the better bot, or -1 if undecided.
+ *
+ * Deals are added up in the order of their seeds whichever thread played
+ * them first, so the test stops at the same deal, with the same result,
+ * on any number of threads; the deals played beyond it are dropped
+ */
+int Match::sequential (long max_deals)
+{
+	int i, spins, ret = -1;
+	long n;
+	double llr, upper = log ((1.0 - alpha) / alpha), lower = -upper;
+	std::atomic<long> next (deals);
+	std::unique_ptr<queue_t> queue (new queue_t);
+	std::vector<std::thread> workers;
+
+	for (i = 0; i < MATCH_RING; i++)
+		queue->seq[i].store (-1, std::memory_order_relaxed);
+	queue->first.store (deals, std::memory_order_relaxed);
+	queue->stop.store (false, std::memory_order_relaxed);
+	for (i = 0; i < threads; i++)
+		workers.push_back (std::thread (&Match::run, this, queue.get (), &next));
+
+	while (ret == -1 && deals < max_deals) {
+		n = deals;
+		for (spins = 0; queue->seq[n % MATCH_RING].load (std::memory_order_acquire) != n; backoff (&spins))
+			;
+		add (queue->deal[n % MATCH_RING].diff, queue->deal[n % MATCH_RING].points);
+		queue->first.store (deals, std::memory_order_release);
+
+		// Too few deals give an unreliable estimate of the variance
+		llr = deals >= 16 ? get_llr () : 0.0;
+		if (llr >= upper)
+			ret = 0;
+		else if (llr <= lower)
+			ret = 1;
+	}
+
+	queue->stop.store (true, std::memory_order_relaxed);
+	for (i = 0; i < threads; i++)
+		workers[i].join ();
+
+	return ret;
+}
@@ -0,0 +1,110 @@
+/*
+ *
+ * Copyright 2023 Daniel Dwek
+ *
+ * This file is part of chin-chon-lin.
+ *
+ *  chin-chon-lin is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  chin-chon-lin is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with chin-chon-lin.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#ifndef _MATCH_H_
+#define _MATCH_H_
+#include <stdint.h>
+#include <atomic>
+#include "Sim.h"
+#include "Strategy.h"
+#include "Value.h"
+
+typedef enum {
+	BOT_GREEDY,
+	BOT_STRATEGY,
+	BOT_VALUE
+} bot_kind_t;
+
+typedef struct {
+	bot_kind_t kind;
+	const Strategy *table;
+	const Value *weights;
+} bot_t;
+
+// Deals the workers may play ahead of the sequential test
+#define MATCH_RING	256
+
+typedef struct {
+	double diff;
+	double points[4][4];
+} deal_t;
+
+// Deals played by the workers, each one in the slot of its number modulo
+// MATCH_RING. A slot is published by storing the number of its deal into
+// its sequence, and handed back once the test added up past it
+typedef struct {
+	deal_t deal[MATCH_RING];
+	std::atomic<long> seq[MATCH_RING];
+	std::atomic<long> first;	// next deal to be added up
+	std::atomic<bool> stop;
+} queue_t;
+
+class Match {
+public:
+	Match ();
+	Match (Match&) = delete;
+	Match (Match&&) = delete;
+	Match& operator= (Match&) = delete;
+	~Match ();
+
+	long get_deals () const;
+	double get_mean () const;
+	double get_error () const;
+	double get_naive_error () const;
+	double get_points (int nbot) const;
+	double get_points_error (int nbot) const;
+	double get_win_rate () const;
+	double get_win_error () const;
+	double get_llr () const;
+	int get_threads () const;
+	double get_delta () const;
+	double get_alpha () const;
+	void set_bot (int nbot, const bot_t *bot);
+	void set_seed (uint64_t seed);
+	void set_threads (int threads);
+	void set_delta (double delta);
+	void set_alpha (double alpha);
+
+	void reset ();
+	double play_deal (uint64_t seed, double (*ret_points)[4]) const;
+	void duplicate (long deals);
+	int sequential (long max_deals);
+private:
+	bool choose_source (Sim *sim, const bot_t *bot, uint64_t *rng) const;
+	int choose_discard (Sim *sim, const bot_t *bot, uint64_t *rng) const;
+	void play_turn (Sim *sim, const bot_t *bot, uint64_t *rng) const;
+	uint64_t get_deal_seed (long n) const;
+	void add (double diff, double (*points)[4]);
+	void run (queue_t *queue, std::atomic<long> *next) const;
+
+	bot_t bot[2];
+	uint64_t seed;
+	int threads;
+	double delta;
+	double alpha;
+	long deals;
+	double sum;
+	double sum2;
+	double seat_sum[2];
+	double seat_sum2[2];
+	double wins;
+};
+
+#endif
@@ -0,0 +1,109 @@
+/*
+ *
+ * Copyright 2023 Daniel Dwek
+ *
+ * This file is part of chin-chon-lin.
+ *
+ *  chin-chon-lin is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  chin-chon-lin is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with chin-chon-lin.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include "Mask.h"
+
+/*
+ * Arrange @hand in disjoint combos (groups of three or four cards of the
+ * same number, stairs of three or more consecutive cards of the same suit)
+ * so that the cards left out cost the least. Every card left out costs its
+ * number when @count is false, or just one when it is true.
+ *
+ * The lowest card of @hand is either left out or belongs to a combo, and
+ * such combo can only be a group made with cards of the same number or a
+ * stair starting right at it, since there are no lower cards left. That
+ * keeps the recursion tiny for hands of seven or eight cards
+ */
+static int arrange (mask_t hand, bool count)
+{
+	int c, n, len, best, cost;
+	mask_t rest, same, sub, stair;
+
+	if (!hand)
+		return 0;
+
+	c = mask_first (hand);
+	n = c % 12 + 1;
+	rest = hand & ~((mask_t) 1 << c);
+	best = (count ? 1 : n) + arrange (rest, count);
+
+	same = rest & mask_number (n);
+	if (mask_count (same) >= 2) {
+		for (sub = same; sub; sub = (sub - 1) & same) {
+			if (mask_count (sub) < 2)
+				continue;
+			if ((cost = arrange (rest & ~sub, count)) < best)
+				best = cost;
+		}
+	}
+
+	stair = (mask_t) 1 << c;
+	for (len = 1; n + len <= 12 && (hand & ((mask_t) 1 << (c + len))); len++) {
+		stair |= (mask_t) 1 << (c + len);
+		if (len >= 2 && (cost = arrange (hand & ~stair, count)) < best)
+			best = cost;
+	}
+
+	return best;
+}
+
+/*
+ * Least points @hand can be charged when the round ends
+ */
+int meld_deadwood (mask_t hand)
+{
+	return arrange (hand, false);
+}
+
+/*
+ * Least number of cards of @hand that cannot be part of any combo
+ */
+int meld_loose (mask_t hand)
+{
+	return arrange (hand, true);
+}
+
+/*
+ * Whether the round can be ended with @hand (the seven cards of a player
+ * plus the one just taken) by discarding one of its cards: the remaining
+ * seven must make a big stairway or two combos of three and four cards, or
+ * two combos of three cards each when @flexible_ending is set. The discard
+ * leaving the fewest points is returned in @ret_discard
+ */
+bool meld_can_close (mask_t hand, int flexible_ending, int *ret_discard)
+{
+	int c, points, best = -1;
+	mask_t m, rest;
+
+	for (m = hand; m; m &= m - 1) {
+		c = mask_first (m);
+		rest = hand & ~((mask_t) 1 << c);
+		if (meld_loose (rest) > (flexible_ending ? 1 : 0))
+			continue;
+		points = meld_deadwood (rest);
+		if (best == -1 || points < best) {
+			best = points;
+			if (ret_discard)
+				*ret_discard = c;
+		}
+	}
+
+	return best != -1;
+}
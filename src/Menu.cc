@@ -30,9 +30,10 @@
 #include "Board.h"
 #include "Player.h"
 #include "Deck.h"
+#include "Hint.h"
 
 static GtkWidget *entry;
-static GtkWidget *spin_button_1, *spin_button_2;
+static GtkWidget *spin_button_1, *spin_button_2, *spin_button_3, *spin_button_4;
 static GtkWidget *button, *combobox;
 static GtkWidget *rb_group, *rb2, *rb3, *rb4;
 static GtkBuilder *builder;
@@ -66,6 +67,10 @@ static void prefs_reload_default_settings (gpointer dialog)
 	g_settings_set_int (settings, "total-points", *(int *) g_variant_get_data (v));
 	v = g_settings_get_default_value (settings, "flex-end");
 	g_settings_set_int (settings, "flex-end", *(int *) g_variant_get_data (v));
+	v = g_settings_get_default_value (settings, "difficulty");
+	g_settings_set_int (settings, "difficulty", *(int *) g_variant_get_data (v));
+	v = g_settings_get_default_value (settings, "hints");
+	g_settings_set_int (settings, "hints", *(int *) g_variant_get_data (v));
 	v = g_settings_get_default_value (settings, "language");
 	g_settings_set_string (settings, "language", *(char **) g_variant_get_data_as_bytes (v));
 	v = g_settings_get_default_value (settings, "deck-pixbuf");
@@ -90,6 +95,10 @@ static void prefs_apply_changes (gpointer dialog)
 	logic.set_max_total_points (*(int *) g_variant_get_data (v));
 	v = g_settings_get_value (settings, "flex-end");
 	logic.set_flexible_ending (*(int *) g_variant_get_data (v));
+	v = g_settings_get_value (settings, "difficulty");
+	logic.set_difficulty (*(int *) g_variant_get_data (v));
+	v = g_settings_get_value (settings, "hints");
+	hint.set_enabled (*(int *) g_variant_get_data (v));
 	v = g_settings_get_value (settings, "language");
 	lang = *(char **) g_variant_get_data_as_bytes (v);
 
@@ -109,6 +118,7 @@ static void prefs_apply_changes (gpointer dialog)
 
 	v = g_settings_get_value (settings, "deck-pixbuf");
 	deck.set_cc (*(char **) g_variant_get_data_as_bytes (v));
+	board.damage_all ();
 
 	gtk_widget_destroy (GTK_WIDGET (dialog));
 }
@@ -130,6 +140,8 @@ void show_preferences_cb ()
 	entry = GTK_WIDGET (gtk_builder_get_object (builder, "name-entry"));
 	spin_button_1 = GTK_WIDGET (gtk_builder_get_object (builder, "total-points"));
 	spin_button_2 = GTK_WIDGET (gtk_builder_get_object (builder, "flex-end"));
+	spin_button_3 = GTK_WIDGET (gtk_builder_get_object (builder, "difficulty"));
+	spin_button_4 = GTK_WIDGET (gtk_builder_get_object (builder, "hints"));
 	combobox = GTK_WIDGET (gtk_builder_get_object (builder, "language"));
 
 	for (i = 0; i < 4; i++)
@@ -158,6 +170,8 @@ void show_preferences_cb ()
 	g_settings_bind (settings, "your-name", entry, "text", G_SETTINGS_BIND_DEFAULT);
 	g_settings_bind (settings, "total-points", spin_button_1, "value", G_SETTINGS_BIND_DEFAULT);
 	g_settings_bind (settings, "flex-end", spin_button_2, "value", G_SETTINGS_BIND_DEFAULT);
+	g_settings_bind (settings, "difficulty", spin_button_3, "value", G_SETTINGS_BIND_DEFAULT);
+	g_settings_bind (settings, "hints", spin_button_4, "value", G_SETTINGS_BIND_DEFAULT);
 	g_settings_bind (settings, "language", combobox, "active-id", G_SETTINGS_BIND_DEFAULT);
 	g_settings_bind (settings, "deck-pixbuf", rb_group, "active-id", G_SETTINGS_BIND_DEFAULT);
 
@@ -33,6 +33,10 @@
 #include "Deck.h"
 #include "Stack.h"
 #include "Card.h"
+#include "Belief.h"
+#include "Raster.h"
+#include "Timeline.h"
+#include "Hud.h"
 
 typedef enum { TYPE_EMPTY = 0, TYPE_STAIR, TYPE_GROUP } game_type_t;
 
@@ -115,12 +119,15 @@ public:
 	void draw (cairo_t *cr, int ncard);
 	void draw_all (cairo_t *cr);
 	void draw_selector (cairo_t *cr, int ncard);
+	void draw_hint (cairo_t *cr, int ncard);
+	void get_bounds (int ncard, double *x, double *y, double *w, double *h) const;
 	void render_name (cairo_t *cr);
 	void animate (cairo_t *cr);
 	void finish (cairo_t *cr);
 	void play (cairo_t *cr, int ncard);
 	void erase_cards (cairo_t *cr);
 	void show_cards (cairo_t *cr);
+	void prefetch ();
 private:
 	int id;
 	std::string name;
@@ -148,7 +155,6 @@ extern class Cmdline cmdline;
 extern class Player player[4];
 extern class StackPlayed stack_played;
 extern GtkWidget *drawing_area;
-extern unsigned deck_dist_tid, play_card_tid, player_ending_round_tid;
 
 bool card_st::operator< (struct card_st& c)
 {
@@ -262,7 +268,9 @@ int Player::get_selected () const
 
 int Player::get_ncard_to_play ()
 {
-	int i;
+	int i, ret = -1;
+	double score, best = 0.0;
+	Distance *distance;
 	card_st c = { 0 };
 	std::list<struct card_st> cnt;
 	std::list<struct card_st>::iterator cnt_iter, cnt_next;
@@ -270,6 +278,12 @@ int Player::get_ncard_to_play ()
 	std::set<Card>::iterator pos;
 	bool gc0 = false, gc1 = false;
 
+	// The value function, the strategy table or the lookahead may pick the
+	// card, except when finishing the round, where the combos found by
+	// get_game_combos () rule
+	if (board.get_status () != FINISHING_ROUND_START && (ret = logic.choose_discard (id)) != -1)
+		return ret;
+
 	cards_set.clear ();
 	for (iter = cards.begin (); iter != cards.end (); iter++) {
 		for (i = 0; i < game_combo[0].length; i++) {
@@ -308,6 +322,26 @@ int Player::get_ncard_to_play ()
 		cnt.push_back (c);
 	}
 
+	// Among the cards not making combos, prefer those whose loss keeps the
+	// hand closest to an ending, and then the high ones the guessed hands
+	// of the next player are unlikely to make use of
+	if (logic.get_difficulty () > 0 && belief.is_ready () && cnt.size ()) {
+		distance = logic.get_distance (id);
+		for (cnt_iter = cnt.begin (); cnt_iter != cnt.end (); cnt_iter++) {
+			score = cnt_iter->number - 20.0 * distance->get_distance_without (
+							mask_idx (cnt_iter->suit, cnt_iter->number));
+			score -= 8.0 * belief.get_usefulness (id, (id + 1) & 3,
+							cnt_iter->suit, cnt_iter->number);
+			if (ret == -1 || score > best) {
+				best = score;
+				ret = cnt_iter->idx;
+			}
+		}
+		return ret;
+	}
+
+	// Rule of thumb of the easiest bots, and of any bot before the guessed
+	// hands are set up: get rid of the last card not making combos
 	cnt.sort ();
 	for (cnt_iter = cnt.begin (); cnt_iter != cnt.end (); cnt_iter++) {
 		cnt_next = cnt_iter;
@@ -539,6 +573,8 @@ void Player::acquire (std::string origin, Card& card, bool reset)
 	for (j = 0, iter = src.begin(); iter != src.end(); iter++, j++) {
 		if (iter->get_suit () == card.get_suit () && iter->get_number () == card.get_number ()) {
 			cards.push_back (card);
+			if (id == 0 || cmdline.is_debug_mode ())
+				raster.want (cards.back().get_asset ());
 			src.erase (iter);
 			Card& c = get_card (i);
 
@@ -669,39 +705,32 @@ void Player::relocate ()
 
 void Player::draw (cairo_t *cr, int ncard)
 {
-	RsvgHandle *handler;
+	Tile *tile;
 
 	if (!get_card(ncard).is_displayed ())
 		return;
 
 	if (cmdline.is_debug_mode ())
-		handler = get_card(ncard).get_handler ();
+		tile = &get_card(ncard);
 	else
-		handler = deck.get_handler ();
+		tile = &deck;
 
 	if (!cmdline.is_debug_mode () && id == 0)
-		handler = get_card(ncard).get_handler ();
+		tile = &get_card(ncard);
 
-	cairo_save (cr);
-	cairo_translate (cr, xsrc + xoffset[ncard], ysrc + yoffset[ncard]);
-	cairo_scale (cr, 5.0 * board.get_x_scale (), 5.0 * board.get_y_scale ());
-	rsvg_handle_render_cairo (handler, cr);
-	cairo_stroke (cr);
-	cairo_restore (cr);
+	hud.begin (HUD_HANDS);
+	tile->render (cr, xsrc + xoffset[ncard], ysrc + yoffset[ncard]);
+	hud.end (HUD_HANDS);
 }
 
 void Player::draw_all (cairo_t *cr)
 {
 	int end = extra_card ? 8 : 7;
 
-	for (int i = 0; i < end; i++) {
-		cairo_save (cr);
-		cairo_translate (cr, xsrc + xoffset[i], ysrc + yoffset[i]);
-		cairo_scale (cr, 5.0 * board.get_x_scale (), 5.0 * board.get_y_scale ());
-		rsvg_handle_render_cairo (get_card(i).get_handler (), cr);
-		cairo_stroke (cr);
-		cairo_restore (cr);
-	}
+	hud.begin (HUD_HANDS);
+	for (int i = 0; i < end; i++)
+		get_card(i).render (cr, xsrc + xoffset[i], ysrc + yoffset[i]);
+	hud.end (HUD_HANDS);
 }
 
 void Player::draw_selector (cairo_t *cr, int ncard)
@@ -719,6 +748,46 @@ void Player::draw_selector (cairo_t *cr, int ncard)
 	cairo_restore (cr);
 }
 
+void Player::draw_hint (cairo_t *cr, int ncard)
+{
+	if (id != 0 || ncard == -1)
+		return;
+
+	relocate ();
+	get_card(ncard).draw_hint (cr);
+}
+
+/*
+ * Rectangle covered by the @ncard-th card resting in the hand, or by the
+ * whole hand if @ncard is -1
+ */
+void Player::get_bounds (int ncard, double *x, double *y, double *w, double *h) const
+{
+	double cw = raster.get_width (deck.get_asset ());
+	double ch = raster.get_height (deck.get_asset ());
+	double x1, y1, x2, y2;
+	int first = ncard, last = ncard;
+
+	if (ncard == -1) {
+		first = 0;
+		last = extra_card ? 7 : 6;
+	}
+
+	x1 = x2 = xsrc + xoffset[first];
+	y1 = y2 = ysrc + yoffset[first];
+	for (int i = first + 1; i <= last; i++) {
+		x1 = fmin (x1, xsrc + xoffset[i]);
+		y1 = fmin (y1, ysrc + yoffset[i]);
+		x2 = fmax (x2, xsrc + xoffset[i]);
+		y2 = fmax (y2, ysrc + yoffset[i]);
+	}
+
+	*x = x1;
+	*y = y1;
+	*w = x2 - x1 + cw;
+	*h = y2 - y1 + ch;
+}
+
 void Player::render_name (cairo_t *cr)
 {
 	double x = 0.0, y = 0.0, rotation_factor = 0.0;
@@ -753,193 +822,152 @@ void Player::render_name (cairo_t *cr)
 	cairo_restore (cr);
 }
 
+// Card of the hand being dealt to the player on turn
+static int dealing = 0;
+
+/*
+ * Where cards are dealt from: the top layer of the pile of the deck, as
+ * Tile::draw_pile () lays it out
+ */
+static void get_deal_origin (double *x, double *y)
+{
+	int layers = ((int) deck.get_cards().size () + 3) / 4;
+
+	if (layers > TILE_PILES - 1)
+		layers = TILE_PILES - 1;
+	layers = layers > 0 ? layers - 1 : 0;
+	*x = deck.get_x () + layers;
+	*y = deck.get_y () - layers;
+}
+
+/*
+ * Step of the timeline dealing a card from the deck to its slot in the
+ * hand of the player on turn
+ */
+void on_deal_step (double value)
+{
+	double x, y, xframe, yframe;
+	Player& p = player[board.get_turn ()];
+
+	get_deal_origin (&x, &y);
+	xframe = value * (p.get_xsrc () + p.get_xoffset (dealing & 7) - x);
+	yframe = value * (p.get_ysrc () + p.get_yoffset (dealing & 7) - y);
+	deck.damage (x + p.get_xframe (), y + p.get_yframe (), x + xframe, y + yframe);
+	p.set_xframe (xframe);
+	p.set_yframe (yframe);
+}
+
 void Player::animate (cairo_t *cr)
 {
-	static int i = 0;
+	double x, y;
 
-	switch (board.get_turn ()) {
-	case 0:
-		if (fabs (deck.get_y () + yframe - ysrc) < board.get_framerate ()) {
-			xframe = 0.0;
-			yframe = 0.0;
-			board.set_turn ((board.get_turn () + 1) & 3);
-			get_card(i & 7).set_displayed (true);
-		}
-		break;
-	case 1:
-		if (fabs (deck.get_y () + yframe - ysrc) < board.get_framerate ()) {
-			xframe = 0.0;
-			yframe = 0.0;
-			board.set_turn ((board.get_turn () + 1) & 3);
-			get_card(i & 7).set_displayed (true);
-		}
-		break;
-	case 2:
-		if (fabs (deck.get_y () + yframe - ysrc) < board.get_framerate ()) {
-			xframe = 0.0;
-			yframe = 0.0;
-			board.set_turn ((board.get_turn () + 1) & 3);
-			get_card(i & 7).set_displayed (true);
-		}
-		break;
-	case 3:
-		if (fabs (deck.get_y () + yframe - ysrc) < board.get_framerate ()) {
-			xframe = 0.0;
-			yframe = 0.0;
-			board.set_turn ((board.get_turn () + 1) & 3);
-			get_card(i & 7).set_displayed (true);
-			if (i == 6 && !player[0].has_extra_card ()) {
-				gtk_widget_remove_tick_callback (drawing_area, deck_dist_tid);
+	// Once a card has arrived, the next one is dealt to the next player
+	// until everybody has seven
+	if (id == board.get_turn () && timeline.is_done (TIMELINE_DEAL)) {
+		xframe = 0.0;
+		yframe = 0.0;
+		board.set_turn ((board.get_turn () + 1) & 3);
+		get_card(dealing & 7).set_displayed (true);
+		if (id == 3) {
+			if (dealing == 6 && !player[0].has_extra_card ()) {
+				timeline.stop (TIMELINE_DEAL);
 				return;
-			} else {
-				i++;
 			}
+			dealing++;
 		}
-		break;
-	};
+		timeline.start (TIMELINE_DEAL, TIMELINE_DEAL_MS, EASE_OUT, on_deal_step);
+	}
 
+	// Cards dealt to the bots fly face down
 	if (player[0].get_cards().size () != 8) {
-		cairo_save (cr);
-		cairo_translate (cr, deck.get_x () + xframe, deck.get_y () + yframe);
-		cairo_scale (cr, 5.0 * board.get_x_scale (), 5.0 * board.get_y_scale ());
-		rsvg_handle_render_cairo (player[board.get_turn ()].get_card(i & 7).get_handler (), cr);
-		cairo_stroke (cr);
-		cairo_restore (cr);
+		get_deal_origin (&x, &y);
+		if (board.get_turn () == 0 || cmdline.is_debug_mode ())
+			player[board.get_turn ()].get_card(dealing & 7).render (cr, x + xframe, y + yframe);
+		else
+			deck.render (cr, x + xframe, y + yframe);
 	}
 }
 
-gboolean on_player_ending_round_cb (GtkWidget *widget, GdkFrameClock *frame_clock, gpointer data)
+/*
+ * Step of the timeline of the card a player closes the round with: it flies
+ * to the center of the stack, spinning twice on its way
+ */
+void on_ending_round_step (double value)
 {
 	Player& p = player[board.get_turn ()];
 	StackPlayed& s = stack_played;
 	double xc = s.get_x () + s.get_logical().width / 2.0 * 5.0 * board.get_x_scale ();
 	double yc = s.get_y () + s.get_logical().height / 2.0 * 5.0 * board.get_y_scale ();
+	double x = p.get_xsrc () + p.get_xoffset (p.get_selected ());
+	double y = p.get_ysrc () + p.get_yoffset (p.get_selected ());
+	double x0 = x + p.get_xframe ();
+	double y0 = y + p.get_yframe ();
+	double x1 = x + value * (xc - x);
+	double y1 = y + value * (yc - y);
+	double r = hypot (raster.get_width (deck.get_asset ()), raster.get_height (deck.get_asset ())) / 2.0;
 
-	p.set_xframe (p.get_xframe () + 10.0 / (xc / (xc - (p.get_xsrc () + p.get_xoffset (p.get_selected ())))));
-	p.set_yframe (p.get_yframe () + 10.0 / (xc / (yc - (p.get_ysrc () + p.get_yoffset (p.get_selected ())))));
-	angle += M_PI / 18.0;
-
-	if (fabs (p.get_xsrc () + p.get_xoffset (p.get_selected ()) + p.get_xframe () - s.get_x ()) < 5.0 &&
-	    fabs (p.get_ysrc () + p.get_yoffset (p.get_selected ()) + p.get_yframe () - s.get_y ()) < 5.0) {
-		p.set_xframe (0.0);
-		p.set_yframe (0.0);
-		board.set_status (FINISHING_ROUND_STOP);
-	}
-	gtk_widget_queue_draw (drawing_area);
-
-	return G_SOURCE_CONTINUE;
-}
-
-static bool fn_less (double v, double bound)
-{
-	if (v < bound)
-		return true;
-	return false;
-}
+	p.set_xframe (x1 - x);
+	p.set_yframe (y1 - y);
+	angle = value * 4.0 * M_PI;
 
-static bool fn_greater (double v, double bound)
-{
-	if (v > bound)
-		return true;
-	return false;
+	// The card spins around its center, so any rotation of it fits in the
+	// circle through its corners
+	board.damage (fmin (x0, x1) - r, fmin (y0, y1) - r, fabs (x1 - x0) + 2.0 * r, fabs (y1 - y0) + 2.0 * r);
 }
 
-typedef bool (*cond_fn_t) (double v, double bound);
-
 void Player::finish (cairo_t *cr)
 {
 	StackPlayed& s = stack_played;
-	double x = xsrc + xoffset[selected];
-	double y = ysrc + yoffset[selected];
-	double xc = s.get_x () + s.get_logical().width / 2.0 * 5.0 * board.get_x_scale ();
-	double yc = s.get_y () + s.get_logical().height / 2.0 * 5.0 * board.get_y_scale ();
-	static bool cond_set = false;
-	static cond_fn_t x_op = nullptr, y_op = nullptr;
-
-	if (!cond_set) {
-		if (x < xc)
-			x_op = fn_less;
-		else
-			x_op = fn_greater;
-		if (y < yc)
-			y_op = fn_less;
-		else
-			y_op = fn_greater;
-		cond_set = true;
-	}
 
-	if (x_op (x + xframe, xc) && y_op (y + yframe, yc)) {
-		cairo_save (cr);
-		cairo_translate (cr, xsrc + xoffset[selected] + xframe, ysrc + yoffset[selected] + yframe);
-		cairo_rotate (cr, angle);
-		cairo_translate (cr, - (s.get_logical().width / 2.0) * 5.0 * board.get_x_scale (),
-					- (s.get_logical().height / 2.0) * 5.0 * board.get_y_scale ());
-		cairo_scale (cr, 5.0 * board.get_x_scale (), 5.0 * board.get_y_scale ());
-		rsvg_handle_render_cairo (deck.get_handler (), cr);
-		cairo_stroke (cr);
-		cairo_restore (cr);
-	} else {
-		x_op = nullptr;
-		y_op = nullptr;
-		cond_set = false;
-		gtk_widget_remove_tick_callback (drawing_area, player_ending_round_tid);
+	if (timeline.is_done (TIMELINE_ENDING_ROUND)) {
+		xframe = 0.0;
+		yframe = 0.0;
+		timeline.stop (TIMELINE_ENDING_ROUND);
 		board.set_status (FINISHING_ROUND_STOP);
+		return;
 	}
+
+	cairo_save (cr);
+	cairo_translate (cr, xsrc + xoffset[selected] + xframe, ysrc + yoffset[selected] + yframe);
+	cairo_rotate (cr, angle);
+	cairo_translate (cr, - (s.get_logical().width / 2.0) * 5.0 * board.get_x_scale (),
+				- (s.get_logical().height / 2.0) * 5.0 * board.get_y_scale ());
+	deck.render (cr, 0.0, 0.0);
+	cairo_restore (cr);
 }
 
-gboolean on_play_card_cb (GtkWidget *widget, GdkFrameClock *frame_clock, gpointer data)
+/*
+ * Step of the timeline moving the card played by the player on turn from
+ * the hand to the stack
+ */
+void on_play_card_step (double value)
 {
 	Player& p = player[board.get_turn ()];
 	Tile& s = stack_played;
-	double xframe = p.get_xframe ();
-	double yframe = p.get_yframe ();
-
-	switch (board.get_turn ()) {
-	case 0:
-		xframe = p.get_xframe () + ((p.get_xsrc () + p.get_xoffset (p.get_selected ()) - s.get_x ()) / (s.get_y () - p.get_ysrc ())) * 20.0 * board.get_framerate ();
-		yframe = p.get_yframe () - 1.0 * 20.0 * board.get_framerate ();
-		break;
-	case 1:
-		xframe = p.get_xframe () + 1.0 * 20.0 * board.get_framerate ();
-		yframe = p.get_yframe () - ((p.get_ysrc () + p.get_yoffset (p.get_selected ()) - s.get_y ()) / (s.get_x () - p.get_xsrc ())) * 20.0 * board.get_framerate ();
-		break;
-	case 2:
-		xframe = p.get_xframe () - ((p.get_xsrc () + p.get_xoffset (p.get_selected ()) - s.get_x ()) / (s.get_y () - p.get_ysrc ())) * 20.0 * board.get_framerate ();
-		yframe = p.get_yframe () + 1.0 * 20.0 * board.get_framerate ();
-		break;
-	case 3:
-		xframe = p.get_xframe () - 1.0 * 20.0 * board.get_framerate ();
-		yframe = p.get_yframe () + ((p.get_ysrc () + p.get_yoffset (p.get_selected ()) - s.get_y ()) / (s.get_x () - p.get_xsrc ())) * 20.0 * board.get_framerate ();
-		break;
-	};
+	double x = p.get_xsrc () + p.get_xoffset (p.get_selected ());
+	double y = p.get_ysrc () + p.get_yoffset (p.get_selected ());
+	double xframe = value * (s.get_x () - x);
+	double yframe = value * (s.get_y () - y);
 
+	deck.damage (x + p.get_xframe (), y + p.get_yframe (), x + xframe, y + yframe);
 	p.set_xframe (xframe);
 	p.set_yframe (yframe);
-	gtk_widget_queue_draw (drawing_area);
-
-	return G_SOURCE_CONTINUE;
 }
 
 void Player::play (cairo_t *cr, int ncard)
 {
-	if (fabs (stack_played.get_x () - (xsrc + xframe + xoffset[ncard])) < 20.0 * board.get_framerate () &&
-	    fabs (stack_played.get_y () - (ysrc + yframe + yoffset[ncard])) < 20.0 * board.get_framerate ()) {
+	if (timeline.is_done (TIMELINE_PLAY_CARD)) {
 		xframe = 0.0;
 		yframe = 0.0;
 		extra_card = false;
 		stack_played.set_only_once_value (true);
 		stack_played.acquire ("player");
 		board.set_status (PLAY_CARD_STOP);
-		gtk_widget_remove_tick_callback (drawing_area, play_card_tid);
+		timeline.stop (TIMELINE_PLAY_CARD);
 		board.set_turn ((board.get_turn () + 1) & 3);
 	}
 
-	cairo_save (cr);
-	cairo_translate (cr, xsrc + xoffset[ncard] + xframe, ysrc + yoffset[ncard] + yframe);
-	cairo_scale (cr, 5.0 * board.get_x_scale (), 5.0 * board.get_y_scale ());
-	rsvg_handle_render_cairo (get_card(ncard).get_handler (), cr);
-	cairo_stroke (cr);
-	cairo_restore (cr);
+	get_card(ncard).render (cr, xsrc + xoffset[ncard] + xframe, ysrc + yoffset[ncard] + yframe);
 }
 
 void Player::erase_cards (cairo_t *cr)
@@ -1020,10 +1048,20 @@ void Player::show_cards (cairo_t *cr)
 		angle += incr;
 		cairo_translate (cr, - (s.get_logical().width / 2.0) * 5.0 * board.get_x_scale (),
 				- (s.get_logical().height / 2.0) * 5.0 * board.get_y_scale ());
-		cairo_scale (cr, 5.0 * board.get_x_scale (), 5.0 * board.get_y_scale ());
-		rsvg_handle_render_cairo (get_card(j).get_handler (), cr);
-		cairo_stroke (cr);
+		get_card(j).render (cr, 0.0, 0.0);
 		cairo_restore (cr);
 		j++;
 	}
 }
+
+/*
+ * Have the faces of the whole hand brought in, before showing them at the
+ * end of the round
+ */
+void Player::prefetch ()
+{
+	std::list<Card>::iterator iter;
+
+	for (iter = cards.begin (); iter != cards.end (); iter++)
+		raster.want (iter->get_asset ());
+}
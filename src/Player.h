@@ -108,12 +108,15 @@ public:
 	void draw (cairo_t *cr, int ncard);
 	void draw_all (cairo_t *cr);
 	void draw_selector (cairo_t *cr, int ncard);
+	void draw_hint (cairo_t *cr, int ncard);
+	void get_bounds (int ncard, double *x, double *y, double *w, double *h) const;
 	void render_name (cairo_t *cr);
 	void animate (cairo_t *cr);
 	void finish (cairo_t *cr);
 	void play (cairo_t *cr, int ncard);
 	void erase_cards (cairo_t *cr);
 	void show_cards (cairo_t *cr);
+	void prefetch ();
 private:
 	int id;
 	std::string name;
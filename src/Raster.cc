@@ -0,0 +1,771 @@
+/*
+ *
+ * Copyright 2023 Daniel Dwek
+ *
+ * This file is part of chin-chon-lin.
+ *
+ *  chin-chon-lin is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  chin-chon-lin is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with chin-chon-lin.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include <math.h>
+#include <string.h>
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <cairo.h>
+#include <librsvg/rsvg.h>
+#include "Bundle.h"
+#include "Board.h"
+#include "Hud.h"
+
+#define RASTER_FACES	48
+#define RASTER_BACK	48
+#define RASTER_ASSETS	52
+
+class Raster {
+public:
+	Raster ();
+	Raster (Raster&) = delete;
+	Raster (Raster&&) = delete;
+	Raster& operator= (Raster&) = delete;
+	~Raster ();
+
+	bool is_loaded () const;
+	bool is_ready () const;
+	bool is_current () const;
+	bool is_present (int asset) const;
+	cairo_surface_t *get_atlas () const;
+	cairo_rectangle_int_t get_rect (int asset) const;
+	RsvgRectangle get_logical (int asset) const;
+	unsigned get_serial () const;
+	double get_width (int asset) const;
+	double get_height (int asset) const;
+	void set_notify (void (*notify) ());
+
+	void load ();
+	void want (int asset);
+	void resize (double xs, double ys);
+	bool swap ();
+	void unload ();
+	void paint (cairo_t *cr, int asset, double x, double y);
+private:
+	bool map ();
+	int get_level (double xs, double ys) const;
+	bool open (int asset);
+	void draw (cairo_t *cr, int asset, double xs, double ys, int level);
+	void parse ();
+	void fetch ();
+	void get_cell (double xs, double ys, int *w, int *h);
+	cairo_surface_t *build (double xs, double ys, cairo_rectangle_int_t *rect, bool *have);
+	void run ();
+
+	GMappedFile *bundle;
+	const bundle_level_t *bundle_level;
+	RsvgHandle *handler[RASTER_ASSETS];
+	RsvgRectangle ink[RASTER_ASSETS];
+	RsvgRectangle logical[RASTER_ASSETS];
+	cairo_surface_t *atlas;
+	unsigned serial;
+	cairo_rectangle_int_t rect[RASTER_ASSETS];
+	bool present[RASTER_ASSETS];
+	double x_scale;
+	double y_scale;
+	cairo_surface_t *pending;
+	cairo_rectangle_int_t pending_rect[RASTER_ASSETS];
+	bool pending_have[RASTER_ASSETS];
+	double pending_x_scale;
+	double pending_y_scale;
+	cairo_surface_t *face[RASTER_ASSETS];
+	double face_x_scale[RASTER_ASSETS];
+	double face_y_scale[RASTER_ASSETS];
+	bool requested[RASTER_ASSETS];
+	std::deque<int> queue;
+	double wanted_x_scale;
+	double wanted_y_scale;
+	bool busy;
+	bool stopping;
+	std::atomic<bool> loaded;
+	std::atomic<int> next;
+	int loaders_left;
+	std::vector<std::thread> loaders;
+	std::thread worker;
+	std::thread fetcher;
+	std::mutex lock;
+	std::mutex render_lock;
+	std::condition_variable wakeup;
+	void (*notify) ();
+};
+
+static const char *suitname[4] = { "clubs", "cups", "golds", "swords" };
+static const char *backname[4] = { "ar", "es", "gb", "us" };
+
+/*
+ * The atlas is a grid of 13 columns by 4 rows: a row per suit holding its
+ * twelve faces, the last column holding the backs of the four decks.
+ *
+ * Backs are parsed by a pool of threads as soon as the game starts, so that
+ * the window shows up right away. Once they are, and whenever the window
+ * is resized later on, the atlas is built on a background thread, the old
+ * one (if any) being drawn scaled meanwhile.
+ *
+ * Faces are only parsed the first time they are wanted, since most of them
+ * stay hidden in the hands of the bots until the end of the round. Another
+ * thread parses and rasterizes them, and they are copied into the atlas
+ * on the next swap ().
+ *
+ * If the optional bundle of pre-rendered cards has been installed (see
+ * Bundle.h), no SVG is parsed at all as long as the board scale is below
+ * its largest level: the atlas is a copy of the nearest level, or a
+ * downscale of it, and every face is there from the very first frame. The
+ * SVGs are only parsed for bigger scales.
+ *
+ * The GUI is told about a new atlas or face being ready through the
+ * @notify callback, which is called from a background thread, and then it
+ * has to swap () them in
+ */
+Raster::Raster ()
+{
+	bundle = nullptr;
+	bundle_level = nullptr;
+	for (int i = 0; i < RASTER_ASSETS; i++) {
+		handler[i] = nullptr;
+		ink[i] = { .0, .0, .0, .0 };
+		logical[i] = { .0, .0, .0, .0 };
+		present[i] = false;
+		face[i] = nullptr;
+		face_x_scale[i] = .0;
+		face_y_scale[i] = .0;
+		requested[i] = false;
+	}
+	atlas = nullptr;
+	serial = 0;
+	pending = nullptr;
+	x_scale = .0;
+	y_scale = .0;
+	pending_x_scale = .0;
+	pending_y_scale = .0;
+	wanted_x_scale = .0;
+	wanted_y_scale = .0;
+	busy = false;
+	stopping = false;
+	loaded = false;
+	next = 0;
+	loaders_left = 0;
+	notify = nullptr;
+}
+
+Raster::~Raster ()
+{
+	unload ();
+}
+
+/*
+ * Whether the backs have been parsed, so that the geometry of a card can
+ * be asked for
+ */
+bool Raster::is_loaded () const
+{
+	return loaded;
+}
+
+/*
+ * Whether there is an atlas to draw cards from
+ */
+bool Raster::is_ready () const
+{
+	return atlas != nullptr;
+}
+
+/*
+ * Whether the atlas has been built at the current board scale, rather than
+ * being stretched from a previous one
+ */
+bool Raster::is_current () const
+{
+	return atlas && x_scale == board.get_x_scale () && y_scale == board.get_y_scale ();
+}
+
+/*
+ * Whether the atlas holds the image of @asset already
+ */
+bool Raster::is_present (int asset) const
+{
+	return present[asset];
+}
+
+cairo_surface_t *Raster::get_atlas () const
+{
+	return atlas;
+}
+
+cairo_rectangle_int_t Raster::get_rect (int asset) const
+{
+	return rect[asset];
+}
+
+/*
+ * Bounds of the card drawn by @asset in SVG units, as Card::init used to
+ * read them from each file. Only known for faces once they are parsed
+ */
+RsvgRectangle Raster::get_logical (int asset) const
+{
+	return logical[asset];
+}
+
+/*
+ * Changes every time a new atlas is put in place, so that images composed
+ * from the previous one can be told apart
+ */
+unsigned Raster::get_serial () const
+{
+	return serial;
+}
+
+/*
+ * Size @asset is drawn at on the board, which differs from the one in the
+ * atlas while a resize is pending
+ */
+double Raster::get_width (int asset) const
+{
+	if (!atlas || asset < 0 || asset >= RASTER_ASSETS)
+		return .0;
+	return rect[asset].width * board.get_x_scale () / x_scale;
+}
+
+double Raster::get_height (int asset) const
+{
+	if (!atlas || asset < 0 || asset >= RASTER_ASSETS)
+		return .0;
+	return rect[asset].height * board.get_y_scale () / y_scale;
+}
+
+void Raster::set_notify (void (*notify) ())
+{
+	this->notify = notify;
+}
+
+/*
+ * Start parsing the backs in the background. Faces are numbered as the
+ * cards of a mask (suit * 12 + number - 1), backs follow them in the order
+ * of backname[]
+ */
+void Raster::load ()
+{
+	int threads = std::thread::hardware_concurrency ();
+
+	if (map ()) {
+		loaded = true;
+		fetcher = std::thread (&Raster::fetch, this);
+		return;
+	}
+	if (threads < 1)
+		threads = 1;
+	if (threads > RASTER_ASSETS - RASTER_FACES)
+		threads = RASTER_ASSETS - RASTER_FACES;
+	next = 0;
+	loaders_left = threads;
+	for (int i = 0; i < threads; i++)
+		loaders.push_back (std::thread (&Raster::parse, this));
+	fetcher = std::thread (&Raster::fetch, this);
+}
+
+/*
+ * Ask for the face @asset to be in the atlas as soon as possible, e.g.
+ * because the card is about to be shown. Wanting it again is harmless
+ */
+void Raster::want (int asset)
+{
+	if (asset < 0 || asset >= RASTER_FACES || present[asset])
+		return;
+
+	std::lock_guard<std::mutex> guard (lock);
+	if (requested[asset])
+		return;
+	requested[asset] = true;
+	queue.push_back (asset);
+	wakeup.notify_one ();
+}
+
+/*
+ * Map the bundle of pre-rendered cards, if installed and built for this
+ * kind of machine, taking the geometry of every card from it
+ */
+bool Raster::map ()
+{
+	std::string filename = std::string (CHIN_CHON_LIN_DATADIR) + "data/tiles/cards.raster";
+	const bundle_header_t *header;
+	const bundle_level_t *level;
+	GMappedFile *file;
+	const char *data;
+	gsize size;
+	int l;
+
+	file = g_mapped_file_new (filename.c_str (), FALSE, NULL);
+	if (!file)
+		return false;
+	data = g_mapped_file_get_contents (file);
+	size = g_mapped_file_get_length (file);
+	header = (const bundle_header_t *) data;
+	level = (const bundle_level_t *) (data + sizeof (bundle_header_t));
+	if (size < sizeof (bundle_header_t) + BUNDLE_LEVELS * sizeof (bundle_level_t) ||
+	    memcmp (header->magic, BUNDLE_MAGIC, sizeof (header->magic)) || header->endian != 0x01020304 ||
+	    header->assets != RASTER_ASSETS || header->levels != BUNDLE_LEVELS) {
+		std::cerr << "Ignoring " << filename << std::endl;
+		g_mapped_file_unref (file);
+		return false;
+	}
+	for (l = 0; l < BUNDLE_LEVELS; l++) {
+		if (level[l].scale <= .0 || level[l].offset % BUNDLE_ALIGN ||
+		    (int) level[l].stride != cairo_format_stride_for_width (CAIRO_FORMAT_ARGB32, level[l].width) ||
+		    level[l].offset + (uint64_t) level[l].stride * level[l].height * RASTER_ASSETS > size) {
+			std::cerr << "Ignoring " << filename << std::endl;
+			g_mapped_file_unref (file);
+			return false;
+		}
+	}
+
+	for (int i = 0; i < RASTER_ASSETS; i++) {
+		ink[i] = { header->ink[i].x, header->ink[i].y, header->ink[i].width, header->ink[i].height };
+		logical[i] = { header->logical[i].x, header->logical[i].y,
+				header->logical[i].width, header->logical[i].height };
+	}
+	bundle = file;
+	bundle_level = level;
+
+	return true;
+}
+
+/*
+ * Level of the bundle to draw from at the given board scale: the smallest
+ * one not below it, so that it is either used as is or downscaled. -1 if
+ * there is no bundle or the scale is bigger than all of its levels, the
+ * SVGs having to be rendered then
+ */
+int Raster::get_level (double xs, double ys) const
+{
+	double s = fmax (xs, ys);
+	int ret = -1;
+
+	if (!bundle)
+		return -1;
+	for (int l = 0; l < BUNDLE_LEVELS; l++)
+		if (bundle_level[l].scale >= s - 1e-9 && (ret < 0 || bundle_level[l].scale < bundle_level[ret].scale))
+			ret = l;
+
+	return ret;
+}
+
+/*
+ * Parse the SVG of @asset and read the geometry of the card in it
+ */
+bool Raster::open (int asset)
+{
+	std::ostringstream filename, id;
+	RsvgDimensionData dim;
+	RsvgRectangle viewport, r1, r2;
+	RsvgHandle *h;
+
+	filename << CHIN_CHON_LIN_DATADIR << "data/tiles/";
+	if (asset < RASTER_FACES) {
+		filename << suitname[asset / 12] << std::setw (2) << std::setfill ('0') << asset % 12 + 1 << ".svg";
+		id << "#" << suitname[asset / 12] << std::setw (2) << std::setfill ('0') << asset % 12 + 1;
+	} else {
+		filename << "deck-" << backname[asset - RASTER_BACK] << ".svg";
+		id << "#deck";
+	}
+
+	h = rsvg_handle_new_from_file (filename.str().c_str (), NULL);
+	if (!h) {
+		std::cerr << "Cannot load " << filename.str () << std::endl;
+		return false;
+	}
+	rsvg_handle_set_dpi (h, 300.0);
+	rsvg_handle_get_dimensions (h, &dim);
+	viewport = { .0, .0, (double) dim.width, (double) dim.height };
+	rsvg_handle_get_geometry_for_layer (h, id.str().c_str (), &viewport, &r1, &r2, NULL);
+
+	std::lock_guard<std::mutex> guard (render_lock);
+	handler[asset] = h;
+	ink[asset] = r1;
+	logical[asset] = r2;
+
+	return true;
+}
+
+/*
+ * Draw @asset at the given board scale with its top-left corner at the
+ * origin of @cr, from @level of the bundle or, if -1, from its SVG
+ */
+void Raster::draw (cairo_t *cr, int asset, double xs, double ys, int level)
+{
+	const bundle_level_t *bl;
+	cairo_surface_t *surface;
+	unsigned char *data;
+
+	cairo_save (cr);
+	if (level >= 0) {
+		bl = &bundle_level[level];
+		data = (unsigned char *) g_mapped_file_get_contents (bundle) + bl->offset +
+			(uint64_t) asset * bl->stride * bl->height;
+		surface = cairo_image_surface_create_for_data (data, CAIRO_FORMAT_ARGB32,
+						bl->width, bl->height, bl->stride);
+		if (xs != bl->scale || ys != bl->scale)
+			cairo_scale (cr, xs / bl->scale, ys / bl->scale);
+		cairo_set_source_surface (cr, surface, 0, 0);
+		cairo_paint (cr);
+		cairo_surface_destroy (surface);
+	} else if (handler[asset]) {
+		cairo_scale (cr, 5.0 * xs, 5.0 * ys);
+		rsvg_handle_render_cairo (handler[asset], cr);
+		hud.count_render ();
+	}
+	cairo_restore (cr);
+}
+
+/*
+ * Body of every loading thread: take the next back not taken by another
+ * one until there are none left. The last thread to finish goes on
+ * building the atlas if the window has been configured by then
+ */
+void Raster::parse ()
+{
+	bool build = false;
+	int n;
+
+	while ((n = next++) < RASTER_ASSETS - RASTER_FACES)
+		open (RASTER_BACK + n);
+
+	lock.lock ();
+	if (--loaders_left == 0) {
+		loaded = true;
+		wakeup.notify_one ();
+		if (wanted_x_scale != .0 && !busy) {
+			busy = true;
+			build = true;
+		}
+	}
+	lock.unlock ();
+
+	if (build)
+		run ();
+}
+
+/*
+ * Body of the thread bringing in the faces wanted, one at a time
+ */
+void Raster::fetch ()
+{
+	cairo_surface_t *surface;
+	cairo_t *cr;
+	double xs, ys;
+	int asset, cw, ch, level;
+
+	for (;;) {
+		std::unique_lock<std::mutex> guard (lock);
+		wakeup.wait (guard, [this] { return stopping || (loaded && wanted_x_scale != .0 && !queue.empty ()); });
+		if (stopping)
+			return;
+		asset = queue.front ();
+		queue.pop_front ();
+		xs = wanted_x_scale;
+		ys = wanted_y_scale;
+		guard.unlock ();
+
+		level = get_level (xs, ys);
+		if (level < 0 && !handler[asset] && !open (asset))
+			continue;
+
+		get_cell (xs, ys, &cw, &ch);
+		surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, cw, ch);
+		cr = cairo_create (surface);
+		render_lock.lock ();
+		draw (cr, asset, xs, ys, level);
+		render_lock.unlock ();
+		cairo_destroy (cr);
+		cairo_surface_flush (surface);
+
+		guard.lock ();
+		if (face[asset])
+			cairo_surface_destroy (face[asset]);
+		face[asset] = surface;
+		face_x_scale[asset] = xs;
+		face_y_scale[asset] = ys;
+		guard.unlock ();
+
+		if (notify)
+			notify ();
+	}
+}
+
+/*
+ * Size of a card at the given board scale, from the origin of the SVG
+ * document to the far corner of the card in it, the rest of the page being
+ * empty. Faces take the size of the backs, so that their cells can be laid
+ * out before they are parsed
+ */
+void Raster::get_cell (double xs, double ys, int *w, int *h)
+{
+	int cw = 0, ch = 0, n;
+
+	for (int i = RASTER_BACK; i < RASTER_ASSETS; i++) {
+		n = (int) ceil (fmax (ink[i].x + ink[i].width, logical[i].x + logical[i].width) * 5.0 * xs);
+		cw = n > cw ? n : cw;
+		n = (int) ceil (fmax (ink[i].y + ink[i].height, logical[i].y + logical[i].height) * 5.0 * ys);
+		ch = n > ch ? n : ch;
+	}
+	*w = cw > 0 ? cw : 1;
+	*h = ch > 0 ? ch : 1;
+}
+
+/*
+ * Render every asset parsed so far (all of them, if the bundle has a level
+ * for this scale) at the given board scale into a new atlas, filling @rect with where each one was placed and @have with which
+ * ones were drawn
+ */
+cairo_surface_t *Raster::build (double xs, double ys, cairo_rectangle_int_t *rect, bool *have)
+{
+	std::lock_guard<std::mutex> guard (render_lock);
+	cairo_surface_t *surface;
+	cairo_t *cr;
+	int cw, ch, level;
+
+	get_cell (xs, ys, &cw, &ch);
+	level = get_level (xs, ys);
+
+	// A pixel of padding between cells so that a filtered blit never
+	// bleeds into the neighbouring asset
+	surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, 13 * (cw + 1), 4 * (ch + 1));
+	cr = cairo_create (surface);
+	for (int i = 0; i < RASTER_ASSETS; i++) {
+		if (i < RASTER_FACES) {
+			rect[i].x = (i % 12) * (cw + 1);
+			rect[i].y = (i / 12) * (ch + 1);
+		} else {
+			rect[i].x = 12 * (cw + 1);
+			rect[i].y = (i - RASTER_BACK) * (ch + 1);
+		}
+		rect[i].width = cw;
+		rect[i].height = ch;
+		have[i] = level >= 0 || handler[i] != nullptr;
+		if (!have[i])
+			continue;
+		cairo_save (cr);
+		cairo_rectangle (cr, rect[i].x, rect[i].y, cw, ch);
+		cairo_clip (cr);
+		cairo_translate (cr, rect[i].x, rect[i].y);
+		draw (cr, i, xs, ys, level);
+		cairo_restore (cr);
+	}
+	cairo_destroy (cr);
+	cairo_surface_flush (surface);
+
+	return surface;
+}
+
+/*
+ * Ask for an atlas at a new board scale. It is built on the background
+ * thread, unless the backs are still being parsed, in which case the last
+ * loading thread does it
+ */
+void Raster::resize (double xs, double ys)
+{
+	std::lock_guard<std::mutex> guard (lock);
+
+	wanted_x_scale = xs;
+	wanted_y_scale = ys;
+	wakeup.notify_one ();
+	if (!loaded || busy)
+		return;
+	if (worker.joinable ())
+		worker.join ();
+	busy = true;
+	worker = std::thread (&Raster::run, this);
+}
+
+/*
+ * Keep building until the atlas matches the last scale asked for, since the
+ * window may have been resized again in the meantime
+ */
+void Raster::run ()
+{
+	cairo_rectangle_int_t r[RASTER_ASSETS];
+	bool have[RASTER_ASSETS];
+	cairo_surface_t *surface;
+	double xs, ys;
+
+	for (;;) {
+		lock.lock ();
+		xs = wanted_x_scale;
+		ys = wanted_y_scale;
+		lock.unlock ();
+
+		// Past the largest level of the bundle the backs have to be
+		// parsed after all
+		if (get_level (xs, ys) < 0)
+			for (int i = RASTER_BACK; i < RASTER_ASSETS; i++)
+				if (!handler[i])
+					open (i);
+
+		surface = build (xs, ys, r, have);
+
+		std::lock_guard<std::mutex> guard (lock);
+		if (xs != wanted_x_scale || ys != wanted_y_scale) {
+			cairo_surface_destroy (surface);
+			continue;
+		}
+		if (pending)
+			cairo_surface_destroy (pending);
+		pending = surface;
+		for (int i = 0; i < RASTER_ASSETS; i++) {
+			pending_rect[i] = r[i];
+			pending_have[i] = have[i];
+		}
+		pending_x_scale = xs;
+		pending_y_scale = ys;
+		busy = false;
+		break;
+	}
+
+	if (notify)
+		notify ();
+}
+
+/*
+ * Replace the atlas being drawn with the last one built in the background,
+ * if any, and copy into it the faces brought in since. Faces rendered at
+ * a scale other than the atlas' are dropped, to be wanted again when drawn.
+ * Only to be called from the GUI thread
+ */
+bool Raster::swap ()
+{
+	std::lock_guard<std::mutex> guard (lock);
+	bool ret = false;
+	cairo_t *cr;
+
+	if (pending) {
+		if (atlas)
+			cairo_surface_destroy (atlas);
+		atlas = pending;
+		pending = nullptr;
+		for (int i = 0; i < RASTER_ASSETS; i++) {
+			rect[i] = pending_rect[i];
+			present[i] = pending_have[i];
+		}
+		x_scale = pending_x_scale;
+		y_scale = pending_y_scale;
+		serial++;
+		ret = true;
+	}
+
+	for (int i = 0; i < RASTER_FACES; i++) {
+		if (!face[i])
+			continue;
+		if (atlas && face_x_scale[i] == x_scale && face_y_scale[i] == y_scale && !present[i]) {
+			cr = cairo_create (atlas);
+			cairo_rectangle (cr, rect[i].x, rect[i].y, rect[i].width, rect[i].height);
+			cairo_clip (cr);
+			cairo_set_operator (cr, CAIRO_OPERATOR_SOURCE);
+			cairo_set_source_surface (cr, face[i], rect[i].x, rect[i].y);
+			cairo_paint (cr);
+			cairo_destroy (cr);
+			present[i] = true;
+			ret = true;
+		}
+		cairo_surface_destroy (face[i]);
+		face[i] = nullptr;
+		requested[i] = false;
+	}
+
+	return ret;
+}
+
+/*
+ * Stop every background thread and release all the handles and surfaces
+ * owned by the raster, leaving it as just constructed. This is the only
+ * place where card images are freed: tiles merely refer to them by asset
+ * number, so none of them can outlive the raster or be freed twice
+ */
+void Raster::unload ()
+{
+	lock.lock ();
+	stopping = true;
+	lock.unlock ();
+	wakeup.notify_all ();
+	if (fetcher.joinable ())
+		fetcher.join ();
+	for (unsigned i = 0; i < loaders.size (); i++)
+		if (loaders[i].joinable ())
+			loaders[i].join ();
+	loaders.clear ();
+	if (worker.joinable ())
+		worker.join ();
+
+	if (pending)
+		cairo_surface_destroy (pending);
+	pending = nullptr;
+	if (atlas)
+		cairo_surface_destroy (atlas);
+	atlas = nullptr;
+	for (int i = 0; i < RASTER_ASSETS; i++) {
+		if (face[i])
+			cairo_surface_destroy (face[i]);
+		face[i] = nullptr;
+		if (handler[i])
+			g_object_unref (handler[i]);
+		handler[i] = nullptr;
+		present[i] = false;
+		requested[i] = false;
+	}
+	if (bundle)
+		g_mapped_file_unref (bundle);
+	bundle = nullptr;
+	bundle_level = nullptr;
+	busy = false;
+	loaded = false;
+	stopping = false;
+}
+
+/*
+ * Blit @asset with its top-left corner at (x, y) in the current user space.
+ * Until the atlas for the current board scale is ready, the previous one is
+ * stretched to fit. A face not brought in yet is wanted right away and
+ * drawn as a blank card meanwhile
+ */
+void Raster::paint (cairo_t *cr, int asset, double x, double y)
+{
+	if (!atlas || asset < 0 || asset >= RASTER_ASSETS)
+		return;
+
+	cairo_save (cr);
+	cairo_translate (cr, x, y);
+	if (x_scale != board.get_x_scale () || y_scale != board.get_y_scale ())
+		cairo_scale (cr, board.get_x_scale () / x_scale, board.get_y_scale () / y_scale);
+	if (present[asset]) {
+		cairo_set_source_surface (cr, atlas, -rect[asset].x, -rect[asset].y);
+		cairo_rectangle (cr, 0, 0, rect[asset].width, rect[asset].height);
+		cairo_fill (cr);
+	} else {
+		want (asset);
+		cairo_set_source_rgb (cr, 1.0, 1.0, 1.0);
+		cairo_rectangle (cr, 0, 0, rect[asset].width, rect[asset].height);
+		cairo_fill (cr);
+	}
+	cairo_restore (cr);
+}
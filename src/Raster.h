@@ -0,0 +1,117 @@
+/*
+ *
+ * Copyright 2023 Daniel Dwek
+ *
+ * This file is part of chin-chon-lin.
+ *
+ *  chin-chon-lin is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  chin-chon-lin is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with chin-chon-lin.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#ifndef _RASTER_H_
+#define _RASTER_H_
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <cairo.h>
+#include <librsvg/rsvg.h>
+#include "Bundle.h"
+
+/*
+ * All the card faces and the four deck backs rasterized into a single
+ * atlas at the current board scale, so that drawing a card is a blit of a
+ * sub-rectangle instead of an SVG render
+ */
+#define RASTER_FACES	48
+#define RASTER_BACK	48
+#define RASTER_ASSETS	52
+
+class Raster {
+public:
+	Raster ();
+	Raster (Raster&) = delete;
+	Raster (Raster&&) = delete;
+	Raster& operator= (Raster&) = delete;
+	~Raster ();
+
+	bool is_loaded () const;
+	bool is_ready () const;
+	bool is_current () const;
+	bool is_present (int asset) const;
+	cairo_surface_t *get_atlas () const;
+	cairo_rectangle_int_t get_rect (int asset) const;
+	RsvgRectangle get_logical (int asset) const;
+	unsigned get_serial () const;
+	double get_width (int asset) const;
+	double get_height (int asset) const;
+	void set_notify (void (*notify) ());
+
+	void load ();
+	void want (int asset);
+	void resize (double xs, double ys);
+	bool swap ();
+	void unload ();
+	void paint (cairo_t *cr, int asset, double x, double y);
+private:
+	bool map ();
+	int get_level (double xs, double ys) const;
+	bool open (int asset);
+	void draw (cairo_t *cr, int asset, double xs, double ys, int level);
+	void parse ();
+	void fetch ();
+	void get_cell (double xs, double ys, int *w, int *h);
+	cairo_surface_t *build (double xs, double ys, cairo_rectangle_int_t *rect, bool *have);
+	void run ();
+
+	GMappedFile *bundle;
+	const bundle_level_t *bundle_level;
+	RsvgHandle *handler[RASTER_ASSETS];
+	RsvgRectangle ink[RASTER_ASSETS];
+	RsvgRectangle logical[RASTER_ASSETS];
+	cairo_surface_t *atlas;
+	unsigned serial;
+	cairo_rectangle_int_t rect[RASTER_ASSETS];
+	bool present[RASTER_ASSETS];
+	double x_scale;
+	double y_scale;
+	cairo_surface_t *pending;
+	cairo_rectangle_int_t pending_rect[RASTER_ASSETS];
+	bool pending_have[RASTER_ASSETS];
+	double pending_x_scale;
+	double pending_y_scale;
+	cairo_surface_t *face[RASTER_ASSETS];
+	double face_x_scale[RASTER_ASSETS];
+	double face_y_scale[RASTER_ASSETS];
+	bool requested[RASTER_ASSETS];
+	std::deque<int> queue;
+	double wanted_x_scale;
+	double wanted_y_scale;
+	bool busy;
+	bool stopping;
+	std::atomic<bool> loaded;
+	std::atomic<int> next;
+	int loaders_left;
+	std::vector<std::thread> loaders;
+	std::thread worker;
+	std::thread fetcher;
+	std::mutex lock;
+	std::mutex render_lock;
+	std::condition_variable wakeup;
+	void (*notify) ();
+};
+
+extern class Raster raster;
+#endif
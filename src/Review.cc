@@ -0,0 +1,323 @@
+/*
+ *
+ * Copyright 2023 Daniel Dwek
+ *
+ * This file is part of chin-chon-lin.
+ *
+ *  chin-chon-lin is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  chin-chon-lin is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with chin-chon-lin.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Mask.h"
+#include "Search.h"
+#include "Belief.h"
+
+#define REVIEW_MAX_MOVES	512
+
+typedef struct {
+	int nplayer;
+	position_t pos;		// without any guesses of the other hands
+	belief_view_t view;	// which are sampled from here when reviewed
+	bool guessed;
+	line_t played;
+	line_t best;
+	double played_value;
+	double best_value;
+} move_t;
+
+// The moves of a round being reviewed in the background, shared by the
+// threads reviewing them and left behind by Review once cancelled
+typedef struct {
+	std::vector<move_t> moves;
+	std::string names[4];
+	int budget;
+	int threads;
+	std::atomic<int> next;
+	std::atomic<int> finished;
+	std::atomic<bool> cancelled;
+} review_job_t;
+
+class Review {
+public:
+	Review ();
+	Review (Review&) = delete;
+	Review (Review&&) = delete;
+	Review& operator= (Review&) = delete;
+	~Review ();
+
+	int get_budget () const;
+	int get_threads () const;
+	int get_nmoves () const;
+	bool is_done () const;
+	void set_budget (int budget);
+	void set_threads (int threads);
+
+	void reset ();
+	void record (int nplayer, const position_t *pos, const belief_view_t *view, const line_t *played);
+	void start (const std::string *names);
+	void cancel ();
+private:
+	std::vector<move_t> moves;
+	std::shared_ptr<review_job_t> job;
+	std::thread waiter;
+	int budget;
+	int threads;
+};
+
+// Moves losing at least this number of expected points are flagged
+#define THRESHOLD	2.0
+
+/*
+ * Review of every draw and discard made during a round, by the human and
+ * the bots alike. Moves are recorded as they are played, together with
+ * everything the player knew at that time, and once the round is over each
+ * of them is searched again with a bigger budget and depth than the bots
+ * use. Moves are spread over as many threads as cores, each one running
+ * its own single-threaded search, so the review is over while the table
+ * of scores is still on screen. The moves that lost expected points are
+ * then reported on the standard output.
+ *
+ * Nothing here ever waits for those threads, since the GUI thread starts
+ * and cancels reviews: a cancelled review is left to wind down on its own
+ * with the moves it was given
+ */
+Review::Review ()
+{
+	threads = std::thread::hardware_concurrency ();
+	if (threads < 1)
+		threads = 1;
+	budget = 100;
+}
+
+Review::~Review ()
+{
+	cancel ();
+}
+
+/*
+ * Time budget of the search of every move, in milliseconds
+ */
+int Review::get_budget () const
+{
+	return budget;
+}
+
+int Review::get_threads () const
+{
+	return threads;
+}
+
+int Review::get_nmoves () const
+{
+	return moves.size ();
+}
+
+bool Review::is_done () const
+{
+	return !job || job->finished == job->threads;
+}
+
+void Review::set_budget (int budget)
+{
+	this->budget = budget;
+}
+
+void Review::set_threads (int threads)
+{
+	this->threads = threads > 0 ? threads : 1;
+}
+
+/*
+ * Forget the moves of the previous round
+ */
+void Review::reset ()
+{
+	cancel ();
+	moves.clear ();
+}
+
+/*
+ * Keep the move @played by @nplayer, who knew @pos when playing it and
+ * guessed the other hands as in @view, if any. Draws from the stack are
+ * recorded without the discard that followed
+ */
+void Review::record (int nplayer, const position_t *pos, const belief_view_t *view, const line_t *played)
+{
+	if (moves.size () >= REVIEW_MAX_MOVES)
+		return;
+	// Moves are big, so they are never copied around as the round goes on
+	if (moves.capacity () < REVIEW_MAX_MOVES)
+		moves.reserve (REVIEW_MAX_MOVES);
+	moves.push_back (move_t ());
+
+	move_t& move = moves.back ();
+	move.nplayer = nplayer;
+	move.pos = *pos;
+	move.guessed = view != nullptr;
+	if (view)
+		move.view = *view;
+	move.played = *played;
+	move.best = *played;
+	move.played_value = 0.0;
+	move.best_value = 0.0;
+}
+
+/*
+ * Search again the position of @move and find out how much worse than the
+ * best line the one played was
+ */
+static void analyze (Search *search, move_t *move)
+{
+	int i, n, best;
+	double v;
+	line_t lines[SEARCH_LINES];
+
+	if (move->guessed)
+		for (i = 0; i < 4; i++)
+			if (i != move->nplayer)
+				move->pos.nsamples[i] = belief_sample (&move->view, i, move->pos.samples[i], SEARCH_SAMPLES, nullptr);
+
+	n = search->get_lines (&move->pos, lines);
+	if (n <= 1)
+		return;
+	best = search->choose (&move->pos, lines, n);
+	move->best = lines[best];
+	move->best_value = search->get_value (best);
+
+	// A draw from the stack is worth the best discard that may follow it
+	move->played_value = -1e9;
+	for (i = 0; i < n; i++) {
+		if (lines[i].source != move->played.source || !search->get_visits (i))
+			continue;
+		if (lines[i].source != LINE_STACK && lines[i].discard != move->played.discard)
+			continue;
+		v = search->get_value (i);
+		if (v > move->played_value)
+			move->played_value = v;
+	}
+	if (move->played_value == -1e9)
+		move->played_value = move->best_value;
+}
+
+static void run (review_job_t *job)
+{
+	int i;
+	Search search;
+
+	search.set_threads (1);
+	search.set_budget (job->budget);
+	search.set_depth (32);
+	while (!job->cancelled && (i = job->next++) < (int) job->moves.size ())
+		analyze (&search, &job->moves[i]);
+	job->finished++;
+}
+
+static std::string describe (const line_t *line)
+{
+	std::ostringstream str;
+
+	if (line->source == LINE_DECK)
+		str << "draw from the deck";
+	else if (line->source == LINE_STACK)
+		str << "take the stack";
+	else
+		str << "discard " << line->discard % 12 + 1 << " of suit " << line->discard / 12;
+	return str.str ();
+}
+
+/*
+ * Print the flagged moves of @job and, for each player, how many expected
+ * points were lost in the whole round. Everything is written at once,
+ * since the GUI keeps printing on the main thread
+ */
+static void report (const review_job_t *job)
+{
+	unsigned long i;
+	int flagged[4] = { 0 }, reviewed[4] = { 0 };
+	double lost[4] = { 0.0 }, loss;
+	std::ostringstream out;
+
+	out << std::fixed << std::setprecision (2);
+	out << "\033[1;36mReview of the round (" << job->moves.size () << " moves, " <<
+		job->budget << " ms each)\033[0m" << std::endl;
+	for (i = 0; i < job->moves.size (); i++) {
+		const move_t& m = job->moves[i];
+		loss = m.best_value - m.played_value;
+		reviewed[m.nplayer]++;
+		if (loss <= 0.0)
+			continue;
+		lost[m.nplayer] += loss;
+		if (loss < THRESHOLD)
+			continue;
+		flagged[m.nplayer]++;
+		out << "  move " << std::setw (3) << i << ", " << job->names[m.nplayer] << ": " <<
+			describe (&m.played) << " lost " << loss << " points, better " <<
+			describe (&m.best) << std::endl;
+	}
+	for (i = 0; i < 4; i++)
+		out << "  " << job->names[i] << ": " << reviewed[i] << " moves, " << flagged[i] <<
+			" flagged, " << lost[i] << " expected points lost" << std::endl;
+	std::cout << out.str () << std::flush;
+}
+
+/*
+ * Review the moves of the round in the background, naming the players
+ * after @names in the report
+ */
+void Review::start (const std::string *names)
+{
+	int i;
+	std::vector<std::thread> workers;
+
+	cancel ();
+	job = std::make_shared<review_job_t> ();
+	job->moves.swap (moves);
+	for (i = 0; i < 4; i++)
+		job->names[i] = names[i];
+	job->budget = budget;
+	job->threads = threads;
+	job->next = 0;
+	job->finished = 0;
+	job->cancelled = false;
+	for (i = 0; i < threads; i++)
+		workers.push_back (std::thread (run, job.get ()));
+
+	// The waiter keeps the job alive until every worker is done with it
+	waiter = std::thread ([] (std::shared_ptr<review_job_t> job, std::vector<std::thread> workers) {
+		for (std::thread& t : workers)
+			t.join ();
+		if (!job->cancelled)
+			report (job.get ());
+	}, job, std::move (workers));
+}
+
+/*
+ * Stop a review still running, e.g. because the next round begins,
+ * without waiting for it
+ */
+void Review::cancel ()
+{
+	if (job)
+		job->cancelled = true;
+	if (waiter.joinable ())
+		waiter.detach ();
+	job.reset ();
+}
@@ -0,0 +1,85 @@
+/*
+ *
+ * Copyright 2023 Daniel Dwek
+ *
+ * This file is part of chin-chon-lin.
+ *
+ *  chin-chon-lin is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  chin-chon-lin is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with chin-chon-lin.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#ifndef _REVIEW_H_
+#define _REVIEW_H_
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Search.h"
+#include "Belief.h"
+
+#define REVIEW_MAX_MOVES	512
+
+typedef struct {
+	int nplayer;
+	position_t pos;		// without any guesses of the other hands
+	belief_view_t view;	// which are sampled from here when reviewed
+	bool guessed;
+	line_t played;
+	line_t best;
+	double played_value;
+	double best_value;
+} move_t;
+
+// The moves of a round being reviewed in the background, shared by the
+// threads reviewing them and left behind by Review once cancelled
+typedef struct {
+	std::vector<move_t> moves;
+	std::string names[4];
+	int budget;
+	int threads;
+	std::atomic<int> next;
+	std::atomic<int> finished;
+	std::atomic<bool> cancelled;
+} review_job_t;
+
+class Review {
+public:
+	Review ();
+	Review (Review&) = delete;
+	Review (Review&&) = delete;
+	Review& operator= (Review&) = delete;
+	~Review ();
+
+	int get_budget () const;
+	int get_threads () const;
+	int get_nmoves () const;
+	bool is_done () const;
+	void set_budget (int budget);
+	void set_threads (int threads);
+
+	void reset ();
+	void record (int nplayer, const position_t *pos, const belief_view_t *view, const line_t *played);
+	void start (const std::string *names);
+	void cancel ();
+private:
+	std::vector<move_t> moves;
+	std::shared_ptr<review_job_t> job;
+	std::thread waiter;
+	int budget;
+	int threads;
+};
+
+extern class Review review;
+
+#endif
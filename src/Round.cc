@@ -0,0 +1,55 @@
+/*
+ *
+ * Copyright 2023 Daniel Dwek
+ *
+ * This file is part of chin-chon-lin.
+ *
+ *  chin-chon-lin is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  chin-chon-lin is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with chin-chon-lin.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include <stdlib.h>
+#include "Mask.h"
+#include "Belief.h"
+#include "Round.h"
+
+/*
+ * Everything a new round needs that has nothing to do with drawing it:
+ * shuffle the 48 card numbers, deal seven of them to each player one at a
+ * time, turn the next one up on the stack and start guessing the hands
+ * over into @belief, if any. Board::new_round () lays the cards out from
+ * @ret in the very same order, and chin-chon-lin-sim --bench-reset times
+ * this alone
+ */
+void round_new (round_t *ret, Belief *belief)
+{
+	int i, j, tmp;
+
+	for (i = 0; i < 48; i++)
+		ret->perm[i] = i;
+	for (i = 47; i > 0; i--) {
+		j = rand () % (i + 1);
+		tmp = ret->perm[i];
+		ret->perm[i] = ret->perm[j];
+		ret->perm[j] = tmp;
+	}
+
+	for (i = 0; i < 4; i++)
+		ret->hands[i] = 0;
+	for (i = 0; i < 28; i++)
+		ret->hands[i & 3] |= (mask_t) 1 << ret->perm[i];
+	ret->top = ret->perm[28];
+
+	if (belief)
+		belief->reset (ret->hands, (mask_t) 1 << ret->top);
+}
@@ -0,0 +1,34 @@
+/*
+ *
+ * Copyright 2023 Daniel Dwek
+ *
+ * This file is part of chin-chon-lin.
+ *
+ *  chin-chon-lin is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  chin-chon-lin is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with chin-chon-lin.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#ifndef _ROUND_H_
+#define _ROUND_H_
+#include "Mask.h"
+#include "Belief.h"
+
+typedef struct {
+	int perm[48];		// the cards of the deck, from the top down
+	mask_t hands[4];
+	int top;		// card turned up on the stack
+} round_t;
+
+void round_new (round_t *ret, Belief *belief);
+
+#endif
@@ -0,0 +1,493 @@
+/*
+ *
+ * Copyright 2023 Daniel Dwek
+ *
+ * This file is part of chin-chon-lin.
+ *
+ *  chin-chon-lin is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  chin-chon-lin is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with chin-chon-lin.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include <iostream>
+#include <iomanip>
+#include <math.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "Mask.h"
+#include "Meld.h"
+#include "Sim.h"
+
+#define SEARCH_LINES	16
+#define SEARCH_SAMPLES	32
+
+typedef enum { SEARCH_ROOT = 0, SEARCH_SHARED } search_mode_t;
+typedef enum { LINE_NONE = 0, LINE_DECK, LINE_STACK } source_t;
+
+typedef struct {
+	source_t source;
+	int discard;
+	bool close;
+} line_t;
+
+// Statistics of a candidate line, each on a cache line of its own so that
+// threads updating different lines never contend
+typedef struct {
+	alignas (64) std::atomic<long> visits;
+	std::atomic<long> value;
+} line_stats_t;
+
+typedef struct {
+	int observer;
+	mask_t hand;
+	int pile[48];
+	int npile;
+	int deck_size;
+	int hand_size[4];
+	mask_t known[4];
+	int flexible_ending;
+	mask_t samples[4][SEARCH_SAMPLES];
+	int nsamples[4];
+} position_t;
+
+class Search {
+public:
+	Search ();
+	Search (Search&) = delete;
+	Search (Search&&) = delete;
+	Search& operator= (Search&) = delete;
+	~Search ();
+
+	int get_threads () const;
+	int get_budget () const;
+	int get_depth () const;
+	search_mode_t get_mode () const;
+	long get_rollouts () const;
+	long get_visits (int nline) const;
+	double get_value (int nline) const;
+
+	void set_threads (int threads);
+	void set_budget (int budget);
+	void set_depth (int depth);
+	void set_mode (search_mode_t mode);
+
+	int get_lines (const position_t *pos, line_t *ret);
+	int choose (const position_t *pos, const line_t *lines, int nlines);
+	void bench (const position_t *pos, int max_threads);
+	void cancel ();
+	void clear_cancel ();
+private:
+	void determinize (const position_t *pos, Sim *sim);
+	double rollout (const position_t *pos, const line_t *line, Sim *sim);
+	void run_root (const position_t *pos, const line_t *lines, int nlines, uint64_t seed, long *ret_rollouts);
+	void run_shared (const position_t *pos, const line_t *lines, int nlines, uint64_t seed, long *ret_rollouts);
+
+	int threads;
+	int budget;
+	int depth;
+	search_mode_t mode;
+	std::chrono::steady_clock::time_point deadline;
+	std::mutex lock;
+	std::atomic<bool> cancelled;
+	std::atomic<long> rollouts;
+	line_stats_t stats[SEARCH_LINES];
+};
+
+// Values are kept in thousandths of a point so they fit atomic integers
+#define SCALE		1000.0
+// Exploration constant of UCB1, in points
+#define EXPLORATION	10.0
+// Pessimistic value (in points) and number of visits of a virtual loss
+#define VIRTUAL_LOSS	20.0
+#define VIRTUAL_VISITS	1
+
+/*
+ * Lookahead for a single bot decision. Every candidate line (where to take
+ * a card from and which one to discard) is played out many times over
+ * random deals of the cards the bot cannot see, and then the round goes on
+ * with every player following the greedy policy of Sim for a few turns.
+ * Lines are chosen with UCB1, the one with the best average outcome wins.
+ *
+ * Two ways of using every core are provided. With SEARCH_ROOT, each thread
+ * runs its own search and their statistics are merged at the end. With
+ * SEARCH_SHARED, threads share the statistics of the candidate lines,
+ * updated with atomic operations, and a virtual loss is applied to a line
+ * while a thread is playing it out, so the others spread over the rest
+ */
+Search::Search ()
+{
+	threads = std::thread::hardware_concurrency ();
+	if (threads < 1)
+		threads = 1;
+	budget = 200;
+	depth = 16;
+	mode = SEARCH_SHARED;
+	cancelled = false;
+	rollouts = 0;
+	for (int i = 0; i < SEARCH_LINES; i++) {
+		stats[i].visits = 0;
+		stats[i].value = 0;
+	}
+}
+
+Search::~Search ()
+{
+}
+
+int Search::get_threads () const
+{
+	return threads;
+}
+
+/*
+ * Time budget of a decision, in milliseconds
+ */
+int Search::get_budget () const
+{
+	return budget;
+}
+
+/*
+ * Number of turns (of every player) simulated after each candidate line
+ */
+int Search::get_depth () const
+{
+	return depth;
+}
+
+search_mode_t Search::get_mode () const
+{
+	return mode;
+}
+
+long Search::get_rollouts () const
+{
+	return rollouts;
+}
+
+long Search::get_visits (int nline) const
+{
+	return stats[nline].visits;
+}
+
+/*
+ * Average points gained by playing line @nline: the opponents' average
+ * points minus our own ones at the end of every rollout
+ */
+double Search::get_value (int nline) const
+{
+	long n = stats[nline].visits;
+
+	return n ? stats[nline].value / SCALE / n : 0.0;
+}
+
+void Search::set_threads (int threads)
+{
+	this->threads = threads > 0 ? threads : 1;
+}
+
+void Search::set_budget (int budget)
+{
+	this->budget = budget;
+}
+
+void Search::set_depth (int depth)
+{
+	this->depth = depth;
+}
+
+void Search::set_mode (search_mode_t mode)
+{
+	this->mode = mode;
+}
+
+/*
+ * Candidate lines for the observer of @pos. Before drawing (seven cards in
+ * hand) those are drawing from the deck, deciding the discard afterwards,
+ * and taking the card on top of the stack followed by each possible
+ * discard. After drawing, they are just the possible discards. Lines that
+ * allow ending the round do so
+ */
+int Search::get_lines (const position_t *pos, line_t *ret)
+{
+	int n = 0, c, top = pos->npile ? pos->pile[pos->npile - 1] : -1;
+	mask_t m, hand = pos->hand;
+
+	if (mask_count (hand) < 8) {
+		ret[n].source = LINE_DECK;
+		ret[n].discard = -1;
+		ret[n].close = false;
+		n++;
+		if (top == -1)
+			return n;
+		hand |= (mask_t) 1 << top;
+	}
+
+	for (m = hand; m && n < SEARCH_LINES; m &= m - 1) {
+		c = mask_first (m);
+		if (mask_count (pos->hand) < 8 && c == top)
+			continue;
+		ret[n].source = mask_count (pos->hand) < 8 ? LINE_STACK : LINE_NONE;
+		ret[n].discard = c;
+		ret[n].close = meld_loose (hand & ~((mask_t) 1 << c)) <= (pos->flexible_ending ? 1 : 0);
+		n++;
+	}
+
+	return n;
+}
+
+/*
+ * Deal the cards the observer cannot see: every opponent keeps the cards
+ * known to be in the hand, gets the rest from one of the hands guessed by
+ * the observer (if any) and the remaining unseen cards make the deck
+ */
+void Search::determinize (const position_t *pos, Sim *sim)
+{
+	int i, j, n, need, cards[48];
+	mask_t pool, pile = 0, h, guess;
+
+	for (i = 0; i < pos->npile; i++)
+		pile |= (mask_t) 1 << pos->pile[i];
+	pool = MASK_ALL & ~pos->hand & ~pile;
+	for (j = 0; j < 4; j++)
+		if (j != pos->observer)
+			pool &= ~pos->known[j];
+
+	for (i = 1; i < 4; i++) {
+		j = (pos->observer + i) & 3;
+		h = pos->known[j];
+		need = pos->hand_size[j] - mask_count (h);
+		if (pos->nsamples[j] > 0) {
+			guess = pos->samples[j][sim->next () % pos->nsamples[j]] & pool;
+			while (need > 0 && guess) {
+				n = mask_select (guess, sim->next () % mask_count (guess));
+				guess &= ~((mask_t) 1 << n);
+				h |= (mask_t) 1 << n;
+				pool &= ~((mask_t) 1 << n);
+				need--;
+			}
+		}
+		while (need > 0 && pool) {
+			n = mask_select (pool, sim->next () % mask_count (pool));
+			h |= (mask_t) 1 << n;
+			pool &= ~((mask_t) 1 << n);
+			need--;
+		}
+		sim->set_hand (j, h);
+	}
+	sim->set_hand (pos->observer, pos->hand);
+
+	for (n = 0; pool && n < pos->deck_size; pool &= pool - 1)
+		cards[n++] = mask_first (pool);
+	sim->shuffle (cards, n);
+	sim->set_deck (cards, n);
+	sim->set_pile (pos->pile, pos->npile);
+	sim->set_turn (pos->observer);
+	sim->set_flexible_ending (pos->flexible_ending);
+}
+
+/*
+ * Play @line on a fresh deal and let the round go on for a few turns
+ */
+double Search::rollout (const position_t *pos, const line_t *line, Sim *sim)
+{
+	int i, c, limit;
+	double opp = 0.0;
+
+	determinize (pos, sim);
+	limit = sim->get_turns () + depth;
+
+	if (line->source != LINE_NONE)
+		sim->draw (line->source == LINE_STACK);
+	c = line->discard;
+	if (c == -1 && !meld_can_close (sim->get_hand (pos->observer), pos->flexible_ending, &c))
+		c = sim->choose_discard ();
+	if (!(line->close || line->discard == -1) || !sim->close (c))
+		sim->discard (c);
+	sim->play (limit);
+
+	for (i = 0; i < 4; i++)
+		if (i != pos->observer)
+			opp += sim->get_points (i) / 3.0;
+
+	return opp - sim->get_points (pos->observer);
+}
+
+/*
+ * Root parallelism: every thread searches on its own, the statistics are
+ * summed up once the time is over. The number of rollouts played is left
+ * in @ret_rollouts
+ */
+void Search::run_root (const position_t *pos, const line_t *lines, int nlines, uint64_t seed, long *ret_rollouts)
+{
+	int i, best;
+	long n[SEARCH_LINES] = { 0 }, total = 0;
+	double v[SEARCH_LINES] = { 0.0 }, score, best_score;
+	Sim sim;
+
+	sim.set_seed (seed);
+	while (!cancelled && std::chrono::steady_clock::now () < deadline) {
+		best = 0;
+		best_score = -1e9;
+		for (i = 0; i < nlines; i++) {
+			if (!n[i]) {
+				best = i;
+				break;
+			}
+			score = v[i] / n[i] + EXPLORATION * sqrt (log ((double) total) / n[i]);
+			if (score > best_score) {
+				best_score = score;
+				best = i;
+			}
+		}
+		v[best] += rollout (pos, &lines[best], &sim);
+		n[best]++;
+		total++;
+	}
+
+	for (i = 0; i < nlines; i++) {
+		stats[i].visits += n[i];
+		stats[i].value += (long) (v[i] * SCALE);
+	}
+	*ret_rollouts = total;
+}
+
+/*
+ * Shared statistics: lines are selected with UCB1 over atomic counters, and
+ * a virtual loss keeps other threads away from a line while one of them is
+ * playing it out. The number of rollouts played is left in @ret_rollouts
+ */
+void Search::run_shared (const position_t *pos, const line_t *lines, int nlines, uint64_t seed, long *ret_rollouts)
+{
+	int i, best;
+	long n, total, done = 0;
+	double v, score, best_score;
+	Sim sim;
+
+	sim.set_seed (seed);
+	while (!cancelled && std::chrono::steady_clock::now () < deadline) {
+		best = 0;
+		best_score = -1e9;
+		total = 0;
+		for (i = 0; i < nlines; i++)
+			total += stats[i].visits;
+		for (i = 0; i < nlines; i++) {
+			n = stats[i].visits;
+			if (!n) {
+				best = i;
+				break;
+			}
+			score = stats[i].value / SCALE / n + EXPLORATION * sqrt (log ((double) total) / n);
+			if (score > best_score) {
+				best_score = score;
+				best = i;
+			}
+		}
+
+		stats[best].visits += VIRTUAL_VISITS;
+		stats[best].value -= (long) (VIRTUAL_LOSS * VIRTUAL_VISITS * SCALE);
+		v = rollout (pos, &lines[best], &sim);
+		stats[best].value += (long) ((v + VIRTUAL_LOSS * VIRTUAL_VISITS) * SCALE);
+		stats[best].visits += 1 - VIRTUAL_VISITS;
+		done++;
+	}
+	*ret_rollouts = done;
+}
+
+/*
+ * Search the best of @lines for the observer of @pos within the time
+ * budget, using as many threads as configured. The index of the chosen
+ * line is returned, and its statistics are kept until the next search
+ */
+int Search::choose (const position_t *pos, const line_t *lines, int nlines)
+{
+	int i, best = 0;
+	long total = 0;
+	uint64_t seed;
+	std::vector<std::thread> workers;
+	// Rollouts of every thread, counted on its own and added up at the end
+	std::vector<long> done (threads, 0);
+
+	if (nlines <= 1)
+		return 0;
+
+	std::lock_guard<std::mutex> guard (lock);
+	rollouts = 0;
+	for (i = 0; i < SEARCH_LINES; i++) {
+		stats[i].visits = 0;
+		stats[i].value = 0;
+	}
+
+	seed = std::chrono::steady_clock::now ().time_since_epoch ().count ();
+	deadline = std::chrono::steady_clock::now () + std::chrono::milliseconds (budget);
+	for (i = 0; i < threads; i++) {
+		if (mode == SEARCH_ROOT)
+			workers.push_back (std::thread (&Search::run_root, this, pos, lines, nlines, seed + i * 7919, &done[i]));
+		else
+			workers.push_back (std::thread (&Search::run_shared, this, pos, lines, nlines, seed + i * 7919, &done[i]));
+	}
+	for (i = 0; i < threads; i++) {
+		workers[i].join ();
+		total += done[i];
+	}
+	rollouts = total;
+
+	for (i = 1; i < nlines; i++)
+		if (get_value (i) > get_value (best) && stats[i].visits > 0)
+			best = i;
+
+	return best;
+}
+
+/*
+ * Report how the number of rollouts within the time budget scales with the
+ * number of threads, from one up to @max_threads (doubling each time)
+ */
+void Search::bench (const position_t *pos, int max_threads)
+{
+	int t, n, best, saved = threads;
+	long base = 0;
+	line_t lines[SEARCH_LINES];
+
+	n = get_lines (pos, lines);
+	std::cout << "threads  rollouts  rollouts/s  speedup  best line" << std::endl;
+	for (t = 1; t <= max_threads; t *= 2) {
+		set_threads (t);
+		best = choose (pos, lines, n);
+		if (t == 1)
+			base = rollouts > 0 ? (long) rollouts : 1;
+		std::cout << std::setw (7) << t << std::setw (10) << rollouts <<
+			std::setw (12) << (long) (rollouts * 1000.0 / budget) <<
+			std::setw (9) << std::fixed << std::setprecision (2) << (double) rollouts / base <<
+			"  " << (lines[best].source == LINE_STACK ? "stack" : lines[best].source == LINE_DECK ? "deck" : "-") <<
+			" / " << lines[best].discard << " (" << get_value (best) << ")" << std::endl;
+	}
+	set_threads (saved);
+}
+
+/*
+ * Stop a search running on another thread, which then returns its best
+ * line so far as soon as every worker notices. Searches started later on
+ * return right away too, until clear_cancel () is called
+ */
+void Search::cancel ()
+{
+	cancelled = true;
+}
+
+void Search::clear_cancel ()
+{
+	cancelled = false;
+}
@@ -0,0 +1,106 @@
+/*
+ *
+ * Copyright 2023 Daniel Dwek
+ *
+ * This file is part of chin-chon-lin.
+ *
+ *  chin-chon-lin is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  chin-chon-lin is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with chin-chon-lin.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#ifndef _SEARCH_H_
+#define _SEARCH_H_
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include "Mask.h"
+#include "Sim.h"
+
+#define SEARCH_LINES	16
+#define SEARCH_SAMPLES	32
+
+typedef enum { SEARCH_ROOT = 0, SEARCH_SHARED } search_mode_t;
+typedef enum { LINE_NONE = 0, LINE_DECK, LINE_STACK } source_t;
+
+typedef struct {
+	source_t source;
+	int discard;
+	bool close;
+} line_t;
+
+// Statistics of a candidate line, each on a cache line of its own so that
+// threads updating different lines never contend
+typedef struct {
+	alignas (64) std::atomic<long> visits;
+	std::atomic<long> value;
+} line_stats_t;
+
+typedef struct {
+	int observer;
+	mask_t hand;
+	int pile[48];
+	int npile;
+	int deck_size;
+	int hand_size[4];
+	mask_t known[4];
+	int flexible_ending;
+	mask_t samples[4][SEARCH_SAMPLES];
+	int nsamples[4];
+} position_t;
+
+class Search {
+public:
+	Search ();
+	Search (Search&) = delete;
+	Search (Search&&) = delete;
+	Search& operator= (Search&) = delete;
+	~Search ();
+
+	int get_threads () const;
+	int get_budget () const;
+	int get_depth () const;
+	search_mode_t get_mode () const;
+	long get_rollouts () const;
+	long get_visits (int nline) const;
+	double get_value (int nline) const;
+
+	void set_threads (int threads);
+	void set_budget (int budget);
+	void set_depth (int depth);
+	void set_mode (search_mode_t mode);
+
+	int get_lines (const position_t *pos, line_t *ret);
+	int choose (const position_t *pos, const line_t *lines, int nlines);
+	void bench (const position_t *pos, int max_threads);
+	void cancel ();
+	void clear_cancel ();
+private:
+	void determinize (const position_t *pos, Sim *sim);
+	double rollout (const position_t *pos, const line_t *line, Sim *sim);
+	void run_root (const position_t *pos, const line_t *lines, int nlines, uint64_t seed, long *ret_rollouts);
+	void run_shared (const position_t *pos, const line_t *lines, int nlines, uint64_t seed, long *ret_rollouts);
+
+	int threads;
+	int budget;
+	int depth;
+	search_mode_t mode;
+	std::chrono::steady_clock::time_point deadline;
+	std::mutex lock;
+	std::atomic<bool> cancelled;
+	std::atomic<long> rollouts;
+	line_stats_t stats[SEARCH_LINES];
+};
+
+extern class Search search;
+
+#endif
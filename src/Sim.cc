@@ -0,0 +1,423 @@
+/*
+ *
+ * Copyright 2023 Daniel Dwek
+ *
+ * This file is part of chin-chon-lin.
+ *
+ *  chin-chon-lin is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  chin-chon-lin is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with chin-chon-lin.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include <stdint.h>
+#include "Mask.h"
+#include "Meld.h"
+#include "Action.h"
+
+class Sim {
+public:
+	Sim ();
+	~Sim ();
+
+	int get_turn () const;
+	int get_turns () const;
+	mask_t get_hand (int nplayer) const;
+	int get_top () const;
+	mask_t get_pile () const;
+	int get_played (int *ret) const;
+	int get_deck_size () const;
+	int get_closer () const;
+	int get_flexible_ending () const;
+	bool is_over () const;
+
+	void set_turn (int turn);
+	void set_hand (int nplayer, mask_t hand);
+	void set_deck (const int *cards, int n);
+	void set_pile (const int *cards, int n);
+	void set_flexible_ending (int flexible_ending);
+	void set_seed (uint64_t seed);
+
+	void deal (const int *perm);
+	void shuffle (int *cards, int n);
+	int draw (bool from_stack);
+	void discard (int card);
+	bool close (int card);
+	void finish ();
+	int get_points (int nplayer) const;
+
+	bool choose_source () const;
+	int choose_discard () const;
+	int get_actions (int *ret) const;
+	bool apply (int action);
+	void play_turn ();
+	void play (int max_turns);
+	uint64_t next ();
+private:
+	mask_t hand[4];
+	int deck[48];
+	int ndeck;
+	int pile[48];
+	int npile;
+	int turn;
+	int turns;
+	int closer;
+	bool over;
+	int flexible_ending;
+	uint64_t seed;
+};
+
+bool sim_greedy_source (mask_t hand, int top);
+int sim_greedy_discard (mask_t hand);
+
+/*
+ * Sim is a GUI-free copy of a round of chin-chon, with every hand kept as a
+ * card mask so that thousands of rounds can be played per second by bots
+ * looking ahead or comparing strategies. Cards are numbered as in the
+ * global card[48] array (suit * 12 + number - 1). The deck is drawn from
+ * its end and the card on top of the stack is the last one of @pile
+ */
+Sim::Sim ()
+{
+	for (int i = 0; i < 4; i++)
+		hand[i] = 0;
+	ndeck = 0;
+	npile = 0;
+	turn = 0;
+	turns = 0;
+	closer = -1;
+	over = false;
+	flexible_ending = 0;
+	seed = 0x9e3779b97f4a7c15ULL;
+}
+
+Sim::~Sim ()
+{
+}
+
+int Sim::get_turn () const
+{
+	return turn;
+}
+
+int Sim::get_turns () const
+{
+	return turns;
+}
+
+mask_t Sim::get_hand (int nplayer) const
+{
+	return hand[nplayer];
+}
+
+int Sim::get_top () const
+{
+	return npile ? pile[npile - 1] : -1;
+}
+
+mask_t Sim::get_pile () const
+{
+	mask_t m = 0;
+
+	for (int i = 0; i < npile; i++)
+		m |= (mask_t) 1 << pile[i];
+	return m;
+}
+
+/*
+ * Copy the played cards into @ret, from the bottom of the stack to its top,
+ * and return how many of them there are
+ */
+int Sim::get_played (int *ret) const
+{
+	for (int i = 0; i < npile; i++)
+		ret[i] = pile[i];
+	return npile;
+}
+
+int Sim::get_deck_size () const
+{
+	return ndeck;
+}
+
+int Sim::get_closer () const
+{
+	return closer;
+}
+
+int Sim::get_flexible_ending () const
+{
+	return flexible_ending;
+}
+
+bool Sim::is_over () const
+{
+	return over;
+}
+
+/*
+ * Start playing a position set up by hand from the turn of @turn
+ */
+void Sim::set_turn (int turn)
+{
+	this->turn = turn;
+	turns = 0;
+	closer = -1;
+	over = false;
+}
+
+void Sim::set_hand (int nplayer, mask_t hand)
+{
+	this->hand[nplayer] = hand;
+}
+
+void Sim::set_deck (const int *cards, int n)
+{
+	for (ndeck = 0; ndeck < n; ndeck++)
+		deck[ndeck] = cards[ndeck];
+}
+
+void Sim::set_pile (const int *cards, int n)
+{
+	for (npile = 0; npile < n; npile++)
+		pile[npile] = cards[npile];
+}
+
+void Sim::set_flexible_ending (int flexible_ending)
+{
+	this->flexible_ending = flexible_ending;
+}
+
+void Sim::set_seed (uint64_t seed)
+{
+	this->seed = seed ? seed : 0x9e3779b97f4a7c15ULL;
+}
+
+/*
+ * Deal a new round from the permutation @perm of the 48 cards, the same
+ * way Board::new_round () does: seven cards for each player, one at a
+ * time, and then one card face up on the stack
+ */
+void Sim::deal (const int *perm)
+{
+	int i;
+
+	for (i = 0; i < 4; i++)
+		hand[i] = 0;
+	for (i = 0; i < 28; i++)
+		hand[i & 3] |= (mask_t) 1 << perm[i];
+	pile[0] = perm[28];
+	npile = 1;
+	for (ndeck = 0; ndeck < 48 - 29; ndeck++)
+		deck[ndeck] = perm[47 - ndeck];
+	turn = 0;
+	turns = 0;
+	closer = -1;
+	over = false;
+}
+
+void Sim::shuffle (int *cards, int n)
+{
+	int i, j, tmp;
+
+	for (i = n - 1; i > 0; i--) {
+		j = next () % (i + 1);
+		tmp = cards[i];
+		cards[i] = cards[j];
+		cards[j] = tmp;
+	}
+}
+
+/*
+ * The player on turn takes one card, either from the stack of played cards
+ * or from the deck. An empty deck is refilled with the played cards, just
+ * like Deck::draw_empty () does. The card taken is returned
+ */
+int Sim::draw (bool from_stack)
+{
+	int c;
+
+	if (from_stack && npile) {
+		c = pile[--npile];
+	} else {
+		if (!ndeck) {
+			for (ndeck = 0; ndeck < npile; ndeck++)
+				deck[ndeck] = pile[ndeck];
+			npile = 0;
+			shuffle (deck, ndeck);
+		}
+		if (!ndeck)
+			return -1;
+		c = deck[--ndeck];
+	}
+	hand[turn] |= (mask_t) 1 << c;
+
+	return c;
+}
+
+void Sim::discard (int card)
+{
+	hand[turn] &= ~((mask_t) 1 << card);
+	pile[npile++] = card;
+	turn = (turn + 1) & 3;
+	turns++;
+}
+
+/*
+ * End the round by discarding @card, if the remaining cards allow it
+ */
+bool Sim::close (int card)
+{
+	mask_t rest = hand[turn] & ~((mask_t) 1 << card);
+
+	if (meld_loose (rest) > (flexible_ending ? 1 : 0))
+		return false;
+	hand[turn] = rest;
+	pile[npile++] = card;
+	closer = turn;
+	over = true;
+
+	return true;
+}
+
+/*
+ * End the round without anybody closing it (e.g. too many turns)
+ */
+void Sim::finish ()
+{
+	over = true;
+}
+
+/*
+ * Points @nplayer is charged with the current hand
+ */
+int Sim::get_points (int nplayer) const
+{
+	return meld_deadwood (hand[nplayer]);
+}
+
+/*
+ * Greedy policy shared by every simulated bot: take the card on top of the
+ * stack whenever keeping it lowers the points of the hand
+ */
+bool sim_greedy_source (mask_t hand, int top)
+{
+	int c, best = -1, points;
+	mask_t m, h;
+
+	if (top == -1)
+		return false;
+
+	h = hand | (mask_t) 1 << top;
+	for (m = hand; m; m &= m - 1) {
+		c = mask_first (m);
+		points = meld_deadwood (h & ~((mask_t) 1 << c));
+		if (best == -1 || points < best)
+			best = points;
+	}
+
+	return best != -1 && best < meld_deadwood (hand);
+}
+
+/*
+ * Discard the card whose loss leaves the fewest points, the highest one
+ * on ties
+ */
+int sim_greedy_discard (mask_t hand)
+{
+	int c, points, best = -1, ret = -1;
+	mask_t m;
+
+	for (m = hand; m; m &= m - 1) {
+		c = mask_first (m);
+		points = meld_deadwood (hand & ~((mask_t) 1 << c));
+		if (best == -1 || points < best || (points == best && c % 12 > ret % 12)) {
+			best = points;
+			ret = c;
+		}
+	}
+
+	return ret;
+}
+
+bool Sim::choose_source () const
+{
+	return sim_greedy_source (hand[turn], get_top ());
+}
+
+int Sim::choose_discard () const
+{
+	return sim_greedy_discard (hand[turn]);
+}
+
+/*
+ * Actions allowed to the player on turn, as action_get_legal () does
+ */
+int Sim::get_actions (int *ret) const
+{
+	if (over)
+		return 0;
+	return action_get_legal (hand[turn], ndeck || npile, npile > 0, flexible_ending, ret);
+}
+
+/*
+ * Play @action for the player on turn, which must be one of get_actions ()
+ */
+bool Sim::apply (int action)
+{
+	if (action == ACTION_DECK || action == ACTION_STACK)
+		return draw (action == ACTION_STACK) != -1;
+	if (action >= ACTION_CLOSE)
+		return close (action_card (action));
+	discard (action_card (action));
+	return true;
+}
+
+/*
+ * Play one whole turn for the player on turn: draw, and then either close
+ * the round or discard
+ */
+void Sim::play_turn ()
+{
+	int c;
+
+	if (over)
+		return;
+	if (draw (choose_source ()) == -1) {
+		finish ();
+		return;
+	}
+	if (meld_can_close (hand[turn], flexible_ending, &c) && close (c))
+		return;
+	discard (choose_discard ());
+}
+
+/*
+ * Play until somebody closes the round or @max_turns turns were played
+ */
+void Sim::play (int max_turns)
+{
+	while (!over && turns < max_turns)
+		play_turn ();
+	if (!over)
+		finish ();
+}
+
+/*
+ * xorshift64* generator, one per Sim so that threads never share it
+ */
+uint64_t Sim::next ()
+{
+	seed ^= seed >> 12;
+	seed ^= seed << 25;
+	seed ^= seed >> 27;
+	return seed * 0x2545f4914f6cdd1dULL;
+}
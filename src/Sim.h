@@ -0,0 +1,81 @@
+/*
+ *
+ * Copyright 2023 Daniel Dwek
+ *
+ * This file is part of chin-chon-lin.
+ *
+ *  chin-chon-lin is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  chin-chon-lin is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with chin-chon-lin.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#ifndef _SIM_H_
+#define _SIM_H_
+#include <stdint.h>
+#include "Mask.h"
+
+class Sim {
+public:
+	Sim ();
+	~Sim ();
+
+	int get_turn () const;
+	int get_turns () const;
+	mask_t get_hand (int nplayer) const;
+	int get_top () const;
+	mask_t get_pile () const;
+	int get_played (int *ret) const;
+	int get_deck_size () const;
+	int get_closer () const;
+	int get_flexible_ending () const;
+	bool is_over () const;
+
+	void set_turn (int turn);
+	void set_hand (int nplayer, mask_t hand);
+	void set_deck (const int *cards, int n);
+	void set_pile (const int *cards, int n);
+	void set_flexible_ending (int flexible_ending);
+	void set_seed (uint64_t seed);
+
+	void deal (const int *perm);
+	void shuffle (int *cards, int n);
+	int draw (bool from_stack);
+	void discard (int card);
+	bool close (int card);
+	void finish ();
+	int get_points (int nplayer) const;
+
+	bool choose_source () const;
+	int choose_discard () const;
+	int get_actions (int *ret) const;
+	bool apply (int action);
+	void play_turn ();
+	void play (int max_turns);
+	uint64_t next ();
+private:
+	mask_t hand[4];
+	int deck[48];
+	int ndeck;
+	int pile[48];
+	int npile;
+	int turn;
+	int turns;
+	int closer;
+	bool over;
+	int flexible_ending;
+	uint64_t seed;
+};
+
+bool sim_greedy_source (mask_t hand, int top);
+int sim_greedy_discard (mask_t hand);
+
+#endif
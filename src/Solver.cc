@@ -0,0 +1,334 @@
+/*
+ *
+ * Copyright 2023 Daniel Dwek
+ *
+ * This file is part of chin-chon-lin.
+ *
+ *  chin-chon-lin is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  chin-chon-lin is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with chin-chon-lin.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include <iostream>
+#include <iomanip>
+#include <string.h>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "Mask.h"
+#include "Meld.h"
+#include "Sim.h"
+#include "Strategy.h"
+
+class Solver {
+public:
+	Solver (Strategy *table);
+	Solver (Solver&) = delete;
+	Solver (Solver&&) = delete;
+	Solver& operator= (Solver&) = delete;
+	~Solver ();
+
+	int get_threads () const;
+	int get_deals () const;
+	int get_checkpoint () const;
+	void set_threads (int threads);
+	void set_deals (int deals);
+	void set_checkpoint (int checkpoint);
+
+	bool solve (long iterations, const char *filename);
+private:
+	bool step_source (Sim *sim, int action);
+	void step_discard (Sim *sim, int action);
+	int sample (int infoset, Sim *sim) const;
+	double play_out (Sim *sim, int traverser);
+	void traverse (Sim *sim, int traverser, double (*dregret)[STRATEGY_ACTIONS],
+			double (*dsum)[STRATEGY_ACTIONS]);
+	void run (uint64_t seed);
+
+	Strategy *table;
+	int threads;
+	int deals;
+	int checkpoint;
+	double sigma[STRATEGY_INFOSETS][STRATEGY_ACTIONS];
+	double dregret[STRATEGY_INFOSETS][STRATEGY_ACTIONS];
+	double dsum[STRATEGY_INFOSETS][STRATEGY_ACTIONS];
+	std::mutex lock;
+};
+
+// Rounds longer than this are ended without a closer
+#define MAX_TURNS	200
+
+/*
+ * Offline CFR+ solver for the Strategy table. Every iteration deals a
+ * number of rounds per thread and plays them with the current strategy
+ * (regret matching). At each choice of one of the players (the
+ * "traverser", a different one every round) both actions are tried and
+ * played out until the end of the round, and the difference between what
+ * each action earned and what the strategy earned on average is added to
+ * the regrets. As CFR+ does, regrets are floored at zero after every
+ * iteration, and the average strategy weighs iteration t by t.
+ *
+ * Threads accumulate their results on their own and merge them once at the
+ * end of each iteration, so the table only changes between iterations and
+ * can be saved at any of them to resume the run later
+ */
+Solver::Solver (Strategy *table)
+{
+	this->table = table;
+	threads = std::thread::hardware_concurrency ();
+	if (threads < 1)
+		threads = 1;
+	deals = 200;
+	checkpoint = 10;
+}
+
+Solver::~Solver ()
+{
+}
+
+int Solver::get_threads () const
+{
+	return threads;
+}
+
+/*
+ * Rounds dealt by every thread on each iteration
+ */
+int Solver::get_deals () const
+{
+	return deals;
+}
+
+/*
+ * The table is saved every this number of iterations (0 for never)
+ */
+int Solver::get_checkpoint () const
+{
+	return checkpoint;
+}
+
+void Solver::set_threads (int threads)
+{
+	this->threads = threads > 0 ? threads : 1;
+}
+
+void Solver::set_deals (int deals)
+{
+	this->deals = deals > 0 ? deals : 1;
+}
+
+void Solver::set_checkpoint (int checkpoint)
+{
+	this->checkpoint = checkpoint;
+}
+
+int Solver::sample (int infoset, Sim *sim) const
+{
+	double r = (sim->next () >> 11) * (1.0 / 9007199254740992.0);
+
+	return r < sigma[infoset][0] ? 0 : 1;
+}
+
+/*
+ * Draw a card for the player on turn: from the stack if @action is 0, from
+ * the deck if it is 1, as the current strategy says if it is -1. False is
+ * returned if there were no cards left at all
+ */
+bool Solver::step_source (Sim *sim, int action)
+{
+	int top = sim->get_top ();
+
+	if (top != -1 && action == -1)
+		action = sample (table->get_source_infoset (sim->get_hand (sim->get_turn ()),
+						sim->get_pile (), top, sim->get_deck_size ()), sim);
+	if (sim->draw (top != -1 && action == 0) == -1) {
+		sim->finish ();
+		return false;
+	}
+	return true;
+}
+
+/*
+ * Close the round if possible, or otherwise discard: the loose card far
+ * from any combo if @action is 0, the one close to make a combo if it is 1,
+ * as the current strategy says if it is -1
+ */
+void Solver::step_discard (Sim *sim, int action)
+{
+	int c, infoset, cards[2];
+	mask_t hand = sim->get_hand (sim->get_turn ());
+
+	if (meld_can_close (hand, sim->get_flexible_ending (), &c) && sim->close (c))
+		return;
+
+	infoset = table->get_discard_infoset (hand, sim->get_pile (), sim->get_deck_size (), cards);
+	if (infoset == -1) {
+		sim->discard (sim->choose_discard ());
+		return;
+	}
+	if (action == -1)
+		action = sample (infoset, sim);
+	sim->discard (cards[action]);
+}
+
+/*
+ * Play the rest of the round with the current strategy and return what
+ * @traverser earned: the average points of its opponents minus its own
+ */
+double Solver::play_out (Sim *sim, int traverser)
+{
+	int i;
+	double opp = 0.0;
+
+	while (!sim->is_over () && sim->get_turns () < MAX_TURNS) {
+		if (step_source (sim, -1))
+			step_discard (sim, -1);
+	}
+	sim->finish ();
+
+	for (i = 0; i < 4; i++)
+		if (i != traverser)
+			opp += sim->get_points (i) / 3.0;
+	return opp - sim->get_points (traverser);
+}
+
+/*
+ * Play a whole round, trying both actions at every choice of @traverser
+ */
+void Solver::traverse (Sim *sim, int traverser, double (*dregret)[STRATEGY_ACTIONS],
+			double (*dsum)[STRATEGY_ACTIONS])
+{
+	int a, c, infoset, top, cards[2];
+	double u[STRATEGY_ACTIONS], v;
+	mask_t hand;
+	Sim copy;
+
+	while (!sim->is_over () && sim->get_turns () < MAX_TURNS) {
+		if (sim->get_turn () != traverser) {
+			if (step_source (sim, -1))
+				step_discard (sim, -1);
+			continue;
+		}
+
+		hand = sim->get_hand (traverser);
+		top = sim->get_top ();
+		if (top != -1) {
+			infoset = table->get_source_infoset (hand, sim->get_pile (), top, sim->get_deck_size ());
+			for (a = 0, v = 0.0; a < STRATEGY_ACTIONS; a++) {
+				copy = *sim;
+				if (step_source (&copy, a))
+					step_discard (&copy, -1);
+				u[a] = play_out (&copy, traverser);
+				v += sigma[infoset][a] * u[a];
+			}
+			for (a = 0; a < STRATEGY_ACTIONS; a++) {
+				dregret[infoset][a] += u[a] - v;
+				dsum[infoset][a] += sigma[infoset][a];
+			}
+		}
+		if (!step_source (sim, -1))
+			break;
+
+		hand = sim->get_hand (traverser);
+		infoset = table->get_discard_infoset (hand, sim->get_pile (), sim->get_deck_size (), cards);
+		if (infoset != -1 && !meld_can_close (hand, sim->get_flexible_ending (), &c)) {
+			for (a = 0, v = 0.0; a < STRATEGY_ACTIONS; a++) {
+				copy = *sim;
+				step_discard (&copy, a);
+				u[a] = play_out (&copy, traverser);
+				v += sigma[infoset][a] * u[a];
+			}
+			for (a = 0; a < STRATEGY_ACTIONS; a++) {
+				dregret[infoset][a] += u[a] - v;
+				dsum[infoset][a] += sigma[infoset][a];
+			}
+		}
+		step_discard (sim, -1);
+	}
+}
+
+/*
+ * Work of one thread during one iteration
+ */
+void Solver::run (uint64_t seed)
+{
+	int i, j, a, perm[48];
+	double r[STRATEGY_INFOSETS][STRATEGY_ACTIONS], s[STRATEGY_INFOSETS][STRATEGY_ACTIONS];
+	Sim sim;
+
+	memset (r, 0, sizeof (r));
+	memset (s, 0, sizeof (s));
+	sim.set_seed (seed);
+	for (i = 0; i < deals; i++) {
+		for (j = 0; j < 48; j++)
+			perm[j] = j;
+		sim.shuffle (perm, 48);
+		sim.deal (perm);
+		traverse (&sim, i & 3, r, s);
+	}
+
+	std::lock_guard<std::mutex> guard (lock);
+	for (i = 0; i < STRATEGY_INFOSETS; i++) {
+		for (a = 0; a < STRATEGY_ACTIONS; a++) {
+			dregret[i][a] += r[i][a];
+			dsum[i][a] += s[i][a];
+		}
+	}
+}
+
+/*
+ * Run @iterations more iterations on the table, saving it to @filename
+ * every few of them and at the end. The table may come from an earlier
+ * checkpoint, in which case the iterations go on counting from there
+ */
+bool Solver::solve (long iterations, const char *filename)
+{
+	int i, a;
+	long it, last = table->get_iterations () + iterations;
+	double r, elapsed;
+	std::vector<std::thread> workers;
+	std::chrono::steady_clock::time_point start;
+
+	for (it = table->get_iterations () + 1; it <= last; it++) {
+		start = std::chrono::steady_clock::now ();
+		for (i = 0; i < STRATEGY_INFOSETS; i++)
+			table->get_current (i, sigma[i]);
+		memset (dregret, 0, sizeof (dregret));
+		memset (dsum, 0, sizeof (dsum));
+
+		workers.clear ();
+		for (i = 0; i < threads; i++)
+			workers.push_back (std::thread (&Solver::run, this, (uint64_t) it * 1000003 + i * 7919 + 1));
+		for (i = 0; i < threads; i++)
+			workers[i].join ();
+
+		for (i = 0; i < STRATEGY_INFOSETS; i++) {
+			for (a = 0; a < STRATEGY_ACTIONS; a++) {
+				r = table->get_regret (i, a) + dregret[i][a];
+				table->set_regret (i, a, r > 0.0 ? r : 0.0);
+				table->set_sum (i, a, table->get_sum (i, a) + it * dsum[i][a]);
+			}
+		}
+		table->set_iterations (it);
+
+		elapsed = std::chrono::duration<double> (std::chrono::steady_clock::now () - start).count ();
+		std::cout << "Iteration " << it << ": " << std::fixed << std::setprecision (1) <<
+			threads * deals / elapsed << " rounds/s" << std::endl;
+		if (checkpoint > 0 && it % checkpoint == 0 && !table->save (filename)) {
+			std::cerr << "Cannot write " << filename << std::endl;
+			return false;
+		}
+	}
+
+	return table->save (filename);
+}
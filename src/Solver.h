@@ -0,0 +1,62 @@
+/*
+ *
+ * Copyright 2023 Daniel Dwek
+ *
+ * This file is part of chin-chon-lin.
+ *
+ *  chin-chon-lin is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  chin-chon-lin is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with chin-chon-lin.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#ifndef _SOLVER_H_
+#define _SOLVER_H_
+#include <mutex>
+#include "Sim.h"
+#include "Strategy.h"
+
+class Solver {
+public:
+	Solver (Strategy *table);
+	Solver (Solver&) = delete;
+	Solver (Solver&&) = delete;
+	Solver& operator= (Solver&) = delete;
+	~Solver ();
+
+	int get_threads () const;
+	int get_deals () const;
+	int get_checkpoint () const;
+	void set_threads (int threads);
+	void set_deals (int deals);
+	void set_checkpoint (int checkpoint);
+
+	bool solve (long iterations, const char *filename);
+private:
+	bool step_source (Sim *sim, int action);
+	void step_discard (Sim *sim, int action);
+	int sample (int infoset, Sim *sim) const;
+	double play_out (Sim *sim, int traverser);
+	void traverse (Sim *sim, int traverser, double (*dregret)[STRATEGY_ACTIONS],
+			double (*dsum)[STRATEGY_ACTIONS]);
+	void run (uint64_t seed);
+
+	Strategy *table;
+	int threads;
+	int deals;
+	int checkpoint;
+	double sigma[STRATEGY_INFOSETS][STRATEGY_ACTIONS];
+	double dregret[STRATEGY_INFOSETS][STRATEGY_ACTIONS];
+	double dsum[STRATEGY_INFOSETS][STRATEGY_ACTIONS];
+	std::mutex lock;
+};
+
+#endif
@@ -28,11 +28,17 @@
 #include <cairo.h>
 #include <librsvg/rsvg.h>
 #include "UserInterface.h"
+#include "Logic.h"
 #include "Board.h"
 #include "Player.h"
 #include "Tile.h"
 #include "Deck.h"
 #include "Card.h"
+#include "Tracker.h"
+#include "Belief.h"
+#include "Raster.h"
+#include "Timeline.h"
+#include "Hud.h"
 
 class StackPlayed : public Tile {
 public:
@@ -56,20 +62,16 @@ private:
 
 extern class StackPlayed stack_played;
 extern GtkWidget *drawing_area;
-extern unsigned stack_to_player_tid;
 
 /*
- * Default constructor for the stack of played cards. We load "deck-ar.svg"
- * as a workaround to supply it a generic @handler pointer and @logical struct,
- * but as you can see when playing, only regular cards are rendered at its
- * location on screen
+ * Default constructor for the stack of played cards. It takes the geometry
+ * of a deck back once the raster has parsed it, see set_logical (), but as
+ * you can see when playing, only regular cards are rendered at its location
+ * on screen
  */
 StackPlayed::StackPlayed ()
 {
-	gfile = g_file_new_for_path (CHIN_CHON_LIN_DATADIR "data/tiles/deck-ar.svg");
-	handler = rsvg_handle_new_from_gfile_sync (gfile, RSVG_HANDLE_FLAGS_NONE, NULL, NULL);
-	rsvg_handle_set_dpi (handler, 300.0);
-	rsvg_handle_get_geometry_for_layer (handler, "#deck", &viewport, NULL, &logical, NULL);
+	logical = { .0, .0, .0, .0 };
 	relocate ();
 }
 
@@ -102,17 +104,25 @@ void StackPlayed::acquire (std::string src)
 		if (deck.get_cards().size ()) {
 			cards.push_front (*deck.get_cards().begin ());
 			deck.get_cards().erase (deck.get_cards().begin ());
+			tracker.on_stack_top (cards.front().get_suit (), cards.front().get_number ());
+			raster.want (cards.front().get_asset ());
 		}
 	} else if (src == "player") {
 		std::list<Card>& c = p.get_cards ();
 		for (i = 0, iter = c.begin (); iter != c.end (); iter++, i++) {
 			if (i == p.get_selected ()) {
 				if (only_once) {
+					logic.record_move (p.get_id (), LINE_NONE,
+							mask_idx (iter->get_suit (), iter->get_number ()));
 					cards.push_front (*iter);
 					std::cout << p.get_id () << _(" played suit = ") <<
 						cards.front().get_suit () << _(", number = ") <<
 						cards.front().get_number () <<
 						std::endl;
+					tracker.on_discard (p.get_id (), cards.front().get_suit (),
+								cards.front().get_number ());
+					belief.on_discard (p.get_id (), mask_bit (cards.front().get_suit (),
+								cards.front().get_number ()));
 					c.erase (iter);
 					p.set_selected (7);
 					only_once = false;
@@ -134,48 +144,40 @@ void StackPlayed::relocate ()
 
 void StackPlayed::draw (cairo_t *cr)
 {
+	hud.begin (HUD_PILES);
 	x = (board.get_width () - logical.width * 10.0 * board.get_x_scale ()) / 2.0;
 	x += logical.width * 5.0 * board.get_x_scale ();
 	y = (board.get_height () - logical.height * 5.0 * board.get_y_scale ()) / 2.0;
-	for (unsigned long i = 0; i < cards.size (); i += 4) {
-		cairo_save (cr);
-		cairo_translate (cr, x + i / 4.0, y - i / 4.0);
-		cairo_scale (cr, 5.0 * board.get_x_scale (), 5.0 * board.get_y_scale ());
-		cairo_set_source_rgb (cr, 0.4, 0.5, 0.8);
-		cairo_rectangle (cr, 0, 0, logical.width, logical.height);
-		cairo_fill (cr);
-		cairo_restore (cr);
-	}
+	draw_pile (cr, cards.size (), x, y);
 
-	if (!cards.size ())
+	if (!cards.size ()) {
+		hud.end (HUD_PILES);
 		return;
+	}
 	x = (board.get_width () - logical.width * 10.0 * board.get_x_scale ()) / 2.0;
 	x += logical.width * 5.0 * board.get_x_scale ();
 	x += cards.size () / 4.0;
 	y = (board.get_height () - logical.height * 5.0 * board.get_y_scale ()) / 2.0;
 	y -= cards.size () / 4.0;
 
-	cairo_save (cr);
-	cairo_translate (cr, x, y);
-	cairo_scale (cr, 5.0 * board.get_x_scale (), 5.0 * board.get_y_scale ());
-	rsvg_handle_render_cairo (cards.front().get_handler (), cr);
-	cairo_stroke (cr);
-	cairo_restore (cr);
+	cards.front().render (cr, x, y);
+	hud.end (HUD_PILES);
 }
 
-gboolean on_stack_to_player_cb (GtkWidget *widget, GdkFrameClock *frame_clock, gpointer data)
+/*
+ * Step of the timeline moving the card a player takes from the stack
+ */
+void on_stack_to_player_step (double value)
 {
 	double xframe, yframe;
 	Player& p = player[board.get_turn ()];
 	Tile& s = stack_played;
 
-	xframe = p.get_xframe () + (p.get_xsrc () + p.get_xoffset (7) - s.get_x ()) / board.get_framerate ();
-	yframe = p.get_yframe () + (p.get_ysrc () + p.get_yoffset (7) - s.get_y ()) / board.get_framerate ();
+	xframe = value * (p.get_xsrc () + p.get_xoffset (7) - s.get_x ());
+	yframe = value * (p.get_ysrc () + p.get_yoffset (7) - s.get_y ());
+	deck.damage (s.get_x () + p.get_xframe (), s.get_y () + p.get_yframe (), s.get_x () + xframe, s.get_y () + yframe);
 	p.set_xframe (xframe);
 	p.set_yframe (yframe);
-	gtk_widget_queue_draw (drawing_area);
-
-	return G_SOURCE_CONTINUE;
 }
 
 void StackPlayed::animate (cairo_t *cr)
@@ -183,25 +185,22 @@ void StackPlayed::animate (cairo_t *cr)
 	Player& p = player[board.get_turn ()];
 	Tile& s = stack_played;
 
-	if (fabs (s.get_x () + p.get_xframe () - (p.get_xsrc () + p.get_xoffset (7))) < 1.0 &&
-	    fabs (s.get_y () + p.get_yframe () - (p.get_ysrc () + p.get_yoffset (7)) < 1.0)) {
+	if (timeline.is_done (TIMELINE_STACK_TO_PLAYER)) {
 		p.set_xframe (0.0);
 		p.set_yframe (0.0);
+		logic.record_move (p.get_id (), LINE_STACK, -1);
+		tracker.on_pickup (p.get_id (), cards.front().get_suit (), cards.front().get_number ());
+		belief.on_pickup (p.get_id (), mask_bit (cards.front().get_suit (), cards.front().get_number ()));
 		p.acquire ("stack", stack_played.get_cards().front (), false);
 		p.set_extra_card (true);
 		p.get_card(7).set_displayed (true);
 		board.set_status (STACK_TO_PLAYER_STOP);
-		gtk_widget_remove_tick_callback (drawing_area, stack_to_player_tid);
+		timeline.stop (TIMELINE_STACK_TO_PLAYER);
 	}
 
 	if (!cards.size ())
 		return;
-	cairo_save (cr);
-	cairo_translate (cr, s.get_x () + p.get_xframe (), s.get_y () + p.get_yframe ());
-	cairo_scale (cr, 5.0 * board.get_x_scale (), 5.0 * board.get_y_scale ());
-	rsvg_handle_render_cairo (cards.front().get_handler (), cr);
-	cairo_stroke (cr);
-	cairo_restore (cr);
+	cards.front().render (cr, s.get_x () + p.get_xframe (), s.get_y () + p.get_yframe ());
 }
 
 void StackPlayed::clear (cairo_t *cr)
@@ -0,0 +1,333 @@
+/*
+ *
+ * Copyright 2023 Daniel Dwek
+ *
+ * This file is part of chin-chon-lin.
+ *
+ *  chin-chon-lin is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  chin-chon-lin is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with chin-chon-lin.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include <stdio.h>
+#include <string.h>
+#include "Mask.h"
+#include "Meld.h"
+
+#define STRATEGY_SOURCE		288
+#define STRATEGY_DISCARD	216
+#define STRATEGY_INFOSETS	(STRATEGY_SOURCE + STRATEGY_DISCARD)
+#define STRATEGY_ACTIONS	2
+
+class Strategy {
+public:
+	Strategy ();
+	Strategy (Strategy&) = delete;
+	Strategy (Strategy&&) = delete;
+	Strategy& operator= (Strategy&) = delete;
+	~Strategy ();
+
+	bool is_loaded () const;
+	long get_iterations () const;
+	double get_regret (int infoset, int action) const;
+	double get_sum (int infoset, int action) const;
+	void set_iterations (long iterations);
+	void set_regret (int infoset, int action, double regret);
+	void set_sum (int infoset, int action, double sum);
+
+	int get_source_infoset (mask_t hand, mask_t seen, int top, int deck_size) const;
+	int get_discard_infoset (mask_t hand, mask_t seen, int deck_size, int *ret_cards) const;
+	void get_current (int infoset, double *ret) const;
+	bool get_average (int infoset, double *ret) const;
+	int choose (int infoset, double r) const;
+
+	void clear ();
+	bool load (const char *filename);
+	bool save (const char *filename) const;
+private:
+	double regret[STRATEGY_INFOSETS][STRATEGY_ACTIONS];
+	double sum[STRATEGY_INFOSETS][STRATEGY_ACTIONS];
+	long iterations;
+	bool loaded;
+};
+
+// Minimum weight of the average strategy for an information set to be
+// trusted by the bots; rarely visited ones are left to the heuristics
+#define MIN_SUM		50.0
+
+/*
+ * Strategy table for the two recurring choices of every turn, computed
+ * offline by Solver on an abstraction of the game:
+ *
+ * - taking the card on top of the stack (action 0) or drawing from the
+ *   deck (action 1),
+ * - discarding the highest loose card which is far from any combo (action
+ *   0) or the highest one which is close to make one (action 1).
+ *
+ * Hands are put into buckets by their points, the number of unseen cards
+ * that would complete a combo with them ("outs"), how much the stack's top
+ * card is worth or how the numbers of both candidate discards compare, and
+ * how many cards are left in the deck
+ */
+Strategy::Strategy ()
+{
+	clear ();
+}
+
+Strategy::~Strategy ()
+{
+}
+
+bool Strategy::is_loaded () const
+{
+	return loaded;
+}
+
+/*
+ * Number of CFR+ iterations the table went through
+ */
+long Strategy::get_iterations () const
+{
+	return iterations;
+}
+
+double Strategy::get_regret (int infoset, int action) const
+{
+	return regret[infoset][action];
+}
+
+double Strategy::get_sum (int infoset, int action) const
+{
+	return sum[infoset][action];
+}
+
+void Strategy::set_iterations (long iterations)
+{
+	this->iterations = iterations;
+}
+
+void Strategy::set_regret (int infoset, int action, double regret)
+{
+	this->regret[infoset][action] = regret;
+}
+
+void Strategy::set_sum (int infoset, int action, double sum)
+{
+	this->sum[infoset][action] = sum;
+}
+
+static int bucket (int value, const int *limits, int n)
+{
+	int i;
+
+	for (i = 0; i < n; i++)
+		if (value <= limits[i])
+			break;
+	return i;
+}
+
+static int get_outs (mask_t hand, mask_t seen)
+{
+	int c, outs = 0;
+	mask_t m;
+
+	for (m = MASK_ALL & ~hand & ~seen; m; m &= m - 1) {
+		c = mask_first (m);
+		if (mask_useful (hand, c / 12, c % 12 + 1))
+			outs++;
+	}
+	return outs;
+}
+
+static const int points_limits[] = { 5, 12, 20, 30, 45 };	// 6 buckets
+static const int outs_limits[] = { 2, 5, 9 };			// 4 buckets
+static const int gain_limits[] = { 0, 4, 9 };			// 4 buckets
+static const int diff_limits[] = { -3, 2 };			// 3 buckets
+static const int deck_limits[] = { 5, 11 };			// 3 buckets
+
+/*
+ * Information set of the choice between the stack and the deck for a
+ * @hand of seven cards, given the cards already @seen (the stack) and the
+ * card on @top of it
+ */
+int Strategy::get_source_infoset (mask_t hand, mask_t seen, int top, int deck_size) const
+{
+	int c, points, best = -1, gain;
+	mask_t m, h = hand | (mask_t) 1 << top;
+
+	for (m = hand; m; m &= m - 1) {
+		c = mask_first (m);
+		points = meld_deadwood (h & ~((mask_t) 1 << c));
+		if (best == -1 || points < best)
+			best = points;
+	}
+	points = meld_deadwood (hand);
+	gain = points - best;
+
+	return ((bucket (points, points_limits, 5) * 4 +
+		bucket (get_outs (hand, seen), outs_limits, 3)) * 4 +
+		bucket (gain, gain_limits, 3)) * 3 +
+		bucket (deck_size, deck_limits, 2);
+}
+
+/*
+ * Information set of the choice of the card to discard from a @hand of
+ * eight cards. Both candidates are returned in @ret_cards; -1 is returned
+ * instead when there is nothing to choose (all of the loose cards are far
+ * from any combo or all of them are close to make one)
+ */
+int Strategy::get_discard_infoset (mask_t hand, mask_t seen, int deck_size, int *ret_cards) const
+{
+	int c, n, k, points, far = -1, close = -1;
+	bool partner;
+	mask_t m;
+
+	points = meld_deadwood (hand);
+	for (m = hand; m; m &= m - 1) {
+		c = mask_first (m);
+		n = c % 12 + 1;
+		// Cards in a combo cost less than their number when removed
+		if (points - meld_deadwood (hand & ~((mask_t) 1 << c)) != n)
+			continue;
+		partner = (hand & mask_number (n) & ~((mask_t) 1 << c)) != 0;
+		for (k = -2; k <= 2; k++)
+			if (k && n + k >= 1 && n + k <= 12 && (hand & mask_bit (c / 12, n + k)))
+				partner = true;
+		if (partner && (close == -1 || n >= close % 12 + 1))
+			close = c;
+		else if (!partner && (far == -1 || n >= far % 12 + 1))
+			far = c;
+	}
+	if (far == -1 || close == -1)
+		return -1;
+
+	ret_cards[0] = far;
+	ret_cards[1] = close;
+	return STRATEGY_SOURCE + ((bucket (points, points_limits, 5) * 4 +
+		bucket (get_outs (hand, seen), outs_limits, 3)) * 3 +
+		bucket (far % 12 - close % 12, diff_limits, 2)) * 3 +
+		bucket (deck_size, deck_limits, 2);
+}
+
+/*
+ * Regret matching: play every action proportionally to its positive
+ * regret, or uniformly when none of them has any
+ */
+void Strategy::get_current (int infoset, double *ret) const
+{
+	int a;
+	double total = 0.0;
+
+	for (a = 0; a < STRATEGY_ACTIONS; a++)
+		total += regret[infoset][a] > 0.0 ? regret[infoset][a] : 0.0;
+	for (a = 0; a < STRATEGY_ACTIONS; a++)
+		ret[a] = total > 0.0 ? (regret[infoset][a] > 0.0 ? regret[infoset][a] / total : 0.0) :
+			1.0 / STRATEGY_ACTIONS;
+}
+
+/*
+ * Average strategy over every iteration, which is the one converging to an
+ * equilibrium. False is returned if @infoset was hardly ever visited
+ */
+bool Strategy::get_average (int infoset, double *ret) const
+{
+	int a;
+	double total = 0.0;
+
+	for (a = 0; a < STRATEGY_ACTIONS; a++)
+		total += sum[infoset][a];
+	for (a = 0; a < STRATEGY_ACTIONS; a++)
+		ret[a] = total > 0.0 ? sum[infoset][a] / total : 1.0 / STRATEGY_ACTIONS;
+	return total >= MIN_SUM;
+}
+
+/*
+ * Sample an action of the average strategy with @r uniform in [0, 1), or
+ * return -1 if the table has nothing to say about @infoset
+ */
+int Strategy::choose (int infoset, double r) const
+{
+	int a;
+	double p[STRATEGY_ACTIONS];
+
+	if (!loaded || infoset < 0 || !get_average (infoset, p))
+		return -1;
+	for (a = 0; a < STRATEGY_ACTIONS - 1; a++) {
+		if (r < p[a])
+			break;
+		r -= p[a];
+	}
+	return a;
+}
+
+void Strategy::clear ()
+{
+	memset (regret, 0, sizeof (regret));
+	memset (sum, 0, sizeof (sum));
+	iterations = 0;
+	loaded = false;
+}
+
+/*
+ * The table is a text file: a header line, the number of iterations and
+ * then one line per information set with its regrets and strategy sums
+ */
+bool Strategy::load (const char *filename)
+{
+	int i, n;
+	char header[64];
+	FILE *fp;
+
+	if (!(fp = fopen (filename, "r")))
+		return false;
+	clear ();
+	if (fscanf (fp, "%63s %ld", header, &iterations) != 2 || strcmp (header, "chin-chon-lin-strategy-1")) {
+		fclose (fp);
+		clear ();
+		return false;
+	}
+	for (i = 0; i < STRATEGY_INFOSETS; i++) {
+		if (fscanf (fp, "%d %lf %lf %lf %lf", &n, &regret[i][0], &regret[i][1], &sum[i][0], &sum[i][1]) != 5 || n != i) {
+			fclose (fp);
+			clear ();
+			return false;
+		}
+	}
+	fclose (fp);
+	loaded = true;
+
+	return true;
+}
+
+/*
+ * Write the table to a temporary file first and rename it afterwards, so
+ * that a checkpoint interrupted halfway never spoils the previous one.
+ * Seventeen significant digits read back as the very same doubles, so a
+ * resumed run goes on exactly where the checkpoint left it
+ */
+bool Strategy::save (const char *filename) const
+{
+	int i;
+	char tmp[4096];
+	FILE *fp;
+
+	snprintf (tmp, sizeof (tmp), "%s.tmp", filename);
+	if (!(fp = fopen (tmp, "w")))
+		return false;
+	fprintf (fp, "chin-chon-lin-strategy-1 %ld\n", iterations);
+	for (i = 0; i < STRATEGY_INFOSETS; i++)
+		fprintf (fp, "%d %.17g %.17g %.17g %.17g\n", i, regret[i][0], regret[i][1], sum[i][0], sum[i][1]);
+	if (fclose (fp) != 0)
+		return false;
+
+	return rename (tmp, filename) == 0;
+}
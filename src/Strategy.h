@@ -0,0 +1,64 @@
+/*
+ *
+ * Copyright 2023 Daniel Dwek
+ *
+ * This file is part of chin-chon-lin.
+ *
+ *  chin-chon-lin is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  chin-chon-lin is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with chin-chon-lin.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#ifndef _STRATEGY_H_
+#define _STRATEGY_H_
+#include "Mask.h"
+
+#define STRATEGY_SOURCE		288
+#define STRATEGY_DISCARD	216
+#define STRATEGY_INFOSETS	(STRATEGY_SOURCE + STRATEGY_DISCARD)
+#define STRATEGY_ACTIONS	2
+
+class Strategy {
+public:
+	Strategy ();
+	Strategy (Strategy&) = delete;
+	Strategy (Strategy&&) = delete;
+	Strategy& operator= (Strategy&) = delete;
+	~Strategy ();
+
+	bool is_loaded () const;
+	long get_iterations () const;
+	double get_regret (int infoset, int action) const;
+	double get_sum (int infoset, int action) const;
+	void set_iterations (long iterations);
+	void set_regret (int infoset, int action, double regret);
+	void set_sum (int infoset, int action, double sum);
+
+	int get_source_infoset (mask_t hand, mask_t seen, int top, int deck_size) const;
+	int get_discard_infoset (mask_t hand, mask_t seen, int deck_size, int *ret_cards) const;
+	void get_current (int infoset, double *ret) const;
+	bool get_average (int infoset, double *ret) const;
+	int choose (int infoset, double r) const;
+
+	void clear ();
+	bool load (const char *filename);
+	bool save (const char *filename) const;
+private:
+	double regret[STRATEGY_INFOSETS][STRATEGY_ACTIONS];
+	double sum[STRATEGY_INFOSETS][STRATEGY_ACTIONS];
+	long iterations;
+	bool loaded;
+};
+
+extern class Strategy strategy;
+
+#endif
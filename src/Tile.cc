@@ -19,23 +19,28 @@
  *
  */
 #include <string>
+#include <math.h>
 #include <gdk/gdk.h>
 #include <librsvg/rsvg.h>
 #include "UserInterface.h"
 #include "Board.h"
+#include "Raster.h"
+
+#define TILE_PILES	13
 
 class Tile {
 public:
 	Tile ();
 	Tile (int suit, int number);
+	Tile (const Tile& t);
+	Tile& operator= (const Tile& t);
 	~Tile ();
 
 	double get_x () const;
 	double get_y () const;
 	double get_w () const;
 	double get_h () const;
-	GFile *get_gfile () const;
-	RsvgHandle *get_handler () const;
+	int get_asset () const;
 	RsvgRectangle get_viewport () const;
 	RsvgRectangle get_logical () const;
 	bool is_displayed () const;
@@ -45,8 +50,7 @@ public:
 	void set_y (double y);
 	void set_w (double w);
 	void set_h (double h);
-	void set_gfile (GFile *gfile);
-	void set_handler (RsvgHandle *handler);
+	void set_asset (int asset);
 	void set_viewport (RsvgRectangle viewport);
 	void set_logical (RsvgRectangle logical);
 	void set_displayed (bool displayed);
@@ -55,25 +59,84 @@ public:
 	void lock (std::string obj, int ncard);
 	void unlock (std::string obj, int ncard);
 	void draw_selector (cairo_t *cr);
+	void draw_hint (cairo_t *cr);
+	void render (cairo_t *cr, double x, double y);
+	void draw_pile (cairo_t *cr, int ncards, double x, double y);
+	void damage (double x0, double y0, double x1, double y1);
 protected:
 	double x;
 	double y;
 	double w;
 	double h;
-	GFile *gfile;
-	RsvgHandle *handler;
+	int asset;
 	RsvgRectangle viewport;
 	RsvgRectangle logical;
 	bool displayed;
 	bool locked;
+	cairo_surface_t *pile[TILE_PILES];
+	int pile_asset;
+	unsigned pile_serial;
+	double pile_x_scale;
+	double pile_y_scale;
 };
 
 Tile::Tile ()
 {
+	asset = -1;
+	for (int i = 0; i < TILE_PILES; i++)
+		pile[i] = nullptr;
+	pile_asset = -1;
+	pile_serial = 0;
+	pile_x_scale = .0;
+	pile_y_scale = .0;
+}
+
+/*
+ * Tiles refer to their image by asset number only, the raster owning it.
+ * Copies (cards are copied around all the time between hands, deck and
+ * stack) start with a pile cache of their own
+ */
+Tile::Tile (const Tile& t)
+{
+	asset = -1;
+	for (int i = 0; i < TILE_PILES; i++)
+		pile[i] = nullptr;
+	pile_asset = -1;
+	pile_serial = 0;
+	pile_x_scale = .0;
+	pile_y_scale = .0;
+	*this = t;
+}
+
+Tile& Tile::operator= (const Tile& t)
+{
+	if (this == &t)
+		return *this;
+
+	x = t.x;
+	y = t.y;
+	w = t.w;
+	h = t.h;
+	asset = t.asset;
+	viewport = t.viewport;
+	logical = t.logical;
+	displayed = t.displayed;
+	locked = t.locked;
+	for (int i = 0; i < TILE_PILES; i++) {
+		if (pile[i])
+			cairo_surface_destroy (pile[i]);
+		pile[i] = nullptr;
+	}
+	pile_asset = -1;
+
+	return *this;
 }
 
 Tile::~Tile ()
 {
+	for (int i = 0; i < TILE_PILES; i++)
+		if (pile[i])
+			cairo_surface_destroy (pile[i]);
 }
 
 double Tile::get_x () const
@@ -96,14 +159,9 @@ double Tile::get_h () const
 	return h;
 }
 
-GFile *Tile::get_gfile () const
-{
-	return gfile;
-}
-
-RsvgHandle *Tile::get_handler () const
+int Tile::get_asset () const
 {
-	return handler;
+	return asset;
 }
 
 RsvgRectangle Tile::get_viewport () const
@@ -146,14 +204,9 @@ void Tile::set_h (double h)
 	this->h = h;
 }
 
-void Tile::set_gfile (GFile *gfile)
-{
-	this->gfile = gfile;
-}
-
-void Tile::set_handler (RsvgHandle *handler)
+void Tile::set_asset (int asset)
 {
-	this->handler = handler;
+	this->asset = asset;
 }
 
 void Tile::set_viewport (RsvgRectangle viewport)
@@ -225,3 +278,102 @@ void Tile::draw_selector (cairo_t *cr)
 	cairo_stroke (cr);
 	cairo_restore (cr);
 }
+
+/*
+ * Mark the tile suggested to the human player, in a different color than
+ * the selector so that both can be told apart while hovering
+ */
+void Tile::draw_hint (cairo_t *cr)
+{
+	cairo_save (cr);
+	cairo_set_source_rgb (cr, 0.0, 1.0, 0.5);
+	cairo_rectangle (cr, x - 8.0, y - 8.0, logical.width * 5.0 * board.get_x_scale () + 16.0,
+					logical.height * 5.0 * board.get_y_scale () + 16.0);
+	cairo_set_line_width (cr, 2.0);
+	cairo_stroke (cr);
+	cairo_restore (cr);
+}
+
+/*
+ * Blit the cached raster of this tile with its top-left corner at (x, y)
+ * in the current user space
+ */
+void Tile::render (cairo_t *cr, double x, double y)
+{
+	raster.paint (cr, asset, x, y);
+}
+
+/*
+ * Queue the redraw of the area covered by this tile while moving from
+ * (x0, y0) to (x1, y1), so that both its old and new image get repainted
+ */
+void Tile::damage (double x0, double y0, double x1, double y1)
+{
+	double tw = raster.get_width (asset);
+	double th = raster.get_height (asset);
+
+	board.damage (fmin (x0, x1), fmin (y0, y1), fabs (x1 - x0) + tw, fabs (y1 - y0) + th);
+}
+
+/*
+ * Draw a pile of @ncards with its bottom card at (x, y), every four cards
+ * adding a layer one pixel up and to the right. Layers are the image of
+ * this tile or, if it has none (the stack), flat cards of its size.
+ *
+ * Since only the number of layers shows, a pile of any depth is one of
+ * TILE_PILES images, each composed the first time it is needed and kept
+ * until the scale, the image or the card atlas changes
+ */
+void Tile::draw_pile (cairo_t *cr, int ncards, double x, double y)
+{
+	int layers = (ncards + 3) / 4;
+	double lw, lh;
+	cairo_t *pcr;
+
+	if (layers <= 0)
+		return;
+	if (layers > TILE_PILES - 1)
+		layers = TILE_PILES - 1;
+
+	if (pile_asset != asset || pile_serial != raster.get_serial () ||
+	    pile_x_scale != board.get_x_scale () || pile_y_scale != board.get_y_scale ()) {
+		for (int i = 0; i < TILE_PILES; i++) {
+			if (pile[i])
+				cairo_surface_destroy (pile[i]);
+			pile[i] = nullptr;
+		}
+		pile_asset = asset;
+		pile_serial = raster.get_serial ();
+		pile_x_scale = board.get_x_scale ();
+		pile_y_scale = board.get_y_scale ();
+	}
+
+	if (asset != -1) {
+		lw = raster.get_width (asset);
+		lh = raster.get_height (asset);
+	} else {
+		lw = logical.width * 5.0 * board.get_x_scale ();
+		lh = logical.height * 5.0 * board.get_y_scale ();
+	}
+
+	if (!pile[layers]) {
+		pile[layers] = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
+						(int) ceil (lw) + layers, (int) ceil (lh) + layers);
+		pcr = cairo_create (pile[layers]);
+		for (int i = 0; i < layers; i++) {
+			if (asset != -1) {
+				raster.paint (pcr, asset, i, layers - 1 - i);
+			} else {
+				cairo_set_source_rgb (pcr, 0.4, 0.5, 0.8);
+				cairo_rectangle (pcr, i, layers - 1 - i, lw, lh);
+				cairo_fill (pcr);
+			}
+		}
+		cairo_destroy (pcr);
+	}
+
+	cairo_save (cr);
+	cairo_set_source_surface (cr, pile[layers], x, y - (layers - 1));
+	cairo_paint (cr);
+	cairo_restore (cr);
+}
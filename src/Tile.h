@@ -23,18 +23,21 @@
 #include <gdk/gdk.h>
 #include <librsvg/rsvg.h>
 
+#define TILE_PILES	13
+
 class Tile {
 public:
 	Tile ();
 	Tile (int suit, int number);
+	Tile (const Tile& t);
+	Tile& operator= (const Tile& t);
 	~Tile ();
 
 	double get_x () const;
 	double get_y () const;
 	double get_w () const;
 	double get_h () const;
-	GFile *get_gfile () const;
-	RsvgHandle *get_handler () const;
+	int get_asset () const;
 	RsvgRectangle get_viewport () const;
 	RsvgRectangle get_logical () const;
 	bool is_displayed () const;
@@ -44,8 +47,7 @@ public:
 	void set_y (double y);
 	void set_w (double w);
 	void set_h (double h);
-	void set_gfile (GFile *gfile);
-	void set_handler (RsvgHandle *handler);
+	void set_asset (int asset);
 	void set_viewport (RsvgRectangle viewport);
 	void set_logical (RsvgRectangle logical);
 	void set_displayed (bool displayed);
@@ -54,16 +56,24 @@ public:
 	void lock (std::string obj, int ncard);
 	void unlock (std::string obj, int ncard);
 	void draw_selector (cairo_t *cr);
+	void draw_hint (cairo_t *cr);
+	void render (cairo_t *cr, double x, double y);
+	void draw_pile (cairo_t *cr, int ncards, double x, double y);
+	void damage (double x0, double y0, double x1, double y1);
 protected:
 	double x;
 	double y;
 	double w;
 	double h;
-	GFile *gfile;
-	RsvgHandle *handler;
+	int asset;
 	RsvgRectangle viewport;
 	RsvgRectangle logical;
 	bool displayed;
 	bool locked;
+	cairo_surface_t *pile[TILE_PILES];
+	int pile_asset;
+	unsigned pile_serial;
+	double pile_x_scale;
+	double pile_y_scale;
 };
 #endif
@@ -0,0 +1,185 @@
+/*
+ *
+ * Copyright 2023 Daniel Dwek
+ *
+ * This file is part of chin-chon-lin.
+ *
+ *  chin-chon-lin is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  chin-chon-lin is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with chin-chon-lin.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include <math.h>
+#include <gtk/gtk.h>
+#include "Hud.h"
+
+typedef enum { TIMELINE_DEAL = 0, TIMELINE_DECK_TO_PLAYER, TIMELINE_STACK_TO_PLAYER,
+		TIMELINE_PLAY_CARD, TIMELINE_ENDING_ROUND, TIMELINE_TRACKS,
+} track_t;
+
+/*
+ * How long every animation lasts, in milliseconds
+ */
+#define TIMELINE_DEAL_MS	120
+#define TIMELINE_DRAW_MS	250
+#define TIMELINE_PLAY_MS	250
+#define TIMELINE_ENDING_MS	700
+
+typedef enum { EASE_LINEAR = 0, EASE_OUT, EASE_IN_OUT } easing_t;
+
+class Timeline {
+public:
+	Timeline ();
+	Timeline (Timeline&) = delete;
+	Timeline (Timeline&&) = delete;
+	Timeline& operator= (Timeline&) = delete;
+	~Timeline ();
+
+	bool is_running (track_t track) const;
+	bool is_done (track_t track) const;
+	double get_value (track_t track) const;
+
+	void start (track_t track, int duration, easing_t easing, void (*step) (double value));
+	void stop (track_t track);
+private:
+	static gboolean on_tick_cb (GtkWidget *widget, GdkFrameClock *frame_clock, gpointer data);
+	void tick (gint64 now);
+
+	bool running[TIMELINE_TRACKS];
+	gint64 begin[TIMELINE_TRACKS];
+	gint64 duration[TIMELINE_TRACKS];
+	easing_t easing[TIMELINE_TRACKS];
+	double value[TIMELINE_TRACKS];
+	void (*step[TIMELINE_TRACKS]) (double value);
+	unsigned tid;
+};
+
+extern GtkWidget *drawing_area;
+
+/*
+ * Every animation of the board is a track of this single timeline, driven
+ * by the frame clock of the drawing area. A track maps the time elapsed
+ * since its first frame to a value going from 0 to 1 through an easing
+ * curve, and calls its @step function with it on every frame, so that the
+ * speed of the cards does not depend on the refresh rate of the display
+ * and they never overshoot.
+ *
+ * Tracks stay at 1 once over until stopped, since it is the drawing code
+ * that moves the game on when an animation ends. The tick callback is
+ * only installed while some track is running
+ */
+Timeline::Timeline ()
+{
+	for (int i = 0; i < TIMELINE_TRACKS; i++) {
+		running[i] = false;
+		begin[i] = -1;
+		duration[i] = 1;
+		easing[i] = EASE_LINEAR;
+		value[i] = .0;
+		step[i] = nullptr;
+	}
+	tid = 0;
+}
+
+Timeline::~Timeline ()
+{
+}
+
+bool Timeline::is_running (track_t track) const
+{
+	return running[track];
+}
+
+/*
+ * Whether @track has reached its end, in which case it is still running
+ * until stopped
+ */
+bool Timeline::is_done (track_t track) const
+{
+	return running[track] && value[track] >= 1.0;
+}
+
+/*
+ * Eased value of @track for the current frame, from 0 to 1
+ */
+double Timeline::get_value (track_t track) const
+{
+	return value[track];
+}
+
+static double ease (easing_t easing, double t)
+{
+	switch (easing) {
+	case EASE_OUT:
+		return 1.0 - pow (1.0 - t, 3.0);
+	case EASE_IN_OUT:
+		return t < 0.5 ? 4.0 * t * t * t : 1.0 - pow (-2.0 * t + 2.0, 3.0) / 2.0;
+	default:
+		return t;
+	}
+}
+
+/*
+ * (Re)start @track, lasting @duration milliseconds from the next frame on
+ */
+void Timeline::start (track_t track, int duration, easing_t easing, void (*step) (double value))
+{
+	running[track] = true;
+	begin[track] = -1;
+	this->duration[track] = duration > 0 ? duration * (gint64) 1000 : 1;
+	this->easing[track] = easing;
+	this->step[track] = step;
+	value[track] = .0;
+	if (!tid)
+		tid = gtk_widget_add_tick_callback (drawing_area, on_tick_cb, this, NULL);
+}
+
+void Timeline::stop (track_t track)
+{
+	running[track] = false;
+	value[track] = .0;
+}
+
+gboolean Timeline::on_tick_cb (GtkWidget *widget, GdkFrameClock *frame_clock, gpointer data)
+{
+	Timeline *t = (Timeline *) data;
+	bool any = false;
+
+	t->tick (gdk_frame_clock_get_frame_time (frame_clock));
+	for (int i = 0; i < TIMELINE_TRACKS; i++)
+		any = any || t->running[i];
+	if (any)
+		return G_SOURCE_CONTINUE;
+	t->tid = 0;
+	return G_SOURCE_REMOVE;
+}
+
+/*
+ * Advance every running track to the frame time @now, in microseconds
+ */
+void Timeline::tick (gint64 now)
+{
+	double t;
+
+	hud.begin (HUD_ANIMATION);
+	for (int i = 0; i < TIMELINE_TRACKS; i++) {
+		if (!running[i])
+			continue;
+		if (begin[i] < 0)
+			begin[i] = now;
+		t = (double) (now - begin[i]) / duration[i];
+		value[i] = ease (easing[i], t < 1.0 ? t : 1.0);
+		if (step[i])
+			step[i] (value[i]);
+	}
+	hud.end (HUD_ANIMATION);
+}
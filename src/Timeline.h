@@ -0,0 +1,67 @@
+/*
+ *
+ * Copyright 2023 Daniel Dwek
+ *
+ * This file is part of chin-chon-lin.
+ *
+ *  chin-chon-lin is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  chin-chon-lin is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with chin-chon-lin.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#ifndef _TIMELINE_H_
+#define _TIMELINE_H_
+#include <gtk/gtk.h>
+
+typedef enum { TIMELINE_DEAL = 0, TIMELINE_DECK_TO_PLAYER, TIMELINE_STACK_TO_PLAYER,
+		TIMELINE_PLAY_CARD, TIMELINE_ENDING_ROUND, TIMELINE_TRACKS,
+} track_t;
+
+/*
+ * How long every animation lasts, in milliseconds
+ */
+#define TIMELINE_DEAL_MS	120
+#define TIMELINE_DRAW_MS	250
+#define TIMELINE_PLAY_MS	250
+#define TIMELINE_ENDING_MS	700
+
+typedef enum { EASE_LINEAR = 0, EASE_OUT, EASE_IN_OUT } easing_t;
+
+class Timeline {
+public:
+	Timeline ();
+	Timeline (Timeline&) = delete;
+	Timeline (Timeline&&) = delete;
+	Timeline& operator= (Timeline&) = delete;
+	~Timeline ();
+
+	bool is_running (track_t track) const;
+	bool is_done (track_t track) const;
+	double get_value (track_t track) const;
+
+	void start (track_t track, int duration, easing_t easing, void (*step) (double value));
+	void stop (track_t track);
+private:
+	static gboolean on_tick_cb (GtkWidget *widget, GdkFrameClock *frame_clock, gpointer data);
+	void tick (gint64 now);
+
+	bool running[TIMELINE_TRACKS];
+	gint64 begin[TIMELINE_TRACKS];
+	gint64 duration[TIMELINE_TRACKS];
+	easing_t easing[TIMELINE_TRACKS];
+	double value[TIMELINE_TRACKS];
+	void (*step[TIMELINE_TRACKS]) (double value);
+	unsigned tid;
+};
+
+extern class Timeline timeline;
+#endif
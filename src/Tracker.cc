@@ -0,0 +1,215 @@
+/*
+ *
+ * Copyright 2023 Daniel Dwek
+ *
+ * This file is part of chin-chon-lin.
+ *
+ *  chin-chon-lin is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  chin-chon-lin is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with chin-chon-lin.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include <math.h>
+#include <list>
+#include "Mask.h"
+#include "Logic.h"
+#include "Card.h"
+
+typedef struct {
+	double points;
+	double closing;
+} threat_t;
+
+class Tracker {
+public:
+	Tracker ();
+	Tracker (Tracker&) = delete;
+	Tracker (Tracker&&) = delete;
+	Tracker& operator= (Tracker&) = delete;
+	~Tracker ();
+
+	mask_t get_held (int nplayer) const;
+	mask_t get_discarded (int nplayer) const;
+	mask_t get_pile () const;
+	int get_draws (int nplayer) const;
+	int get_pickups (int nplayer) const;
+	mask_t get_mask (std::list<Card>& cards) const;
+
+	void reset ();
+	void on_stack_top (int suit, int number);
+	void on_draw (int nplayer);
+	void on_pickup (int nplayer, int suit, int number);
+	void on_discard (int nplayer, int suit, int number);
+	void on_reshuffle ();
+	void get_threat (int nplayer, mask_t own, threat_t *ret) const;
+private:
+	mask_t held[4];
+	mask_t discarded[4];
+	mask_t pile;
+	int draws[4];
+	int pickups[4];
+};
+
+Tracker::Tracker ()
+{
+	reset ();
+}
+
+Tracker::~Tracker ()
+{
+}
+
+/*
+ * Cards that @nplayer is known to hold because everybody saw them
+ * being taken from the stack of played cards
+ */
+mask_t Tracker::get_held (int nplayer) const
+{
+	return held[nplayer];
+}
+
+mask_t Tracker::get_discarded (int nplayer) const
+{
+	return discarded[nplayer];
+}
+
+/*
+ * Face-up cards lying on the stack of played cards (including its top)
+ */
+mask_t Tracker::get_pile () const
+{
+	return pile;
+}
+
+int Tracker::get_draws (int nplayer) const
+{
+	return draws[nplayer];
+}
+
+int Tracker::get_pickups (int nplayer) const
+{
+	return pickups[nplayer];
+}
+
+mask_t Tracker::get_mask (std::list<Card>& cards) const
+{
+	mask_t m = 0;
+	std::list<Card>::const_iterator iter;
+
+	for (iter = cards.cbegin (); iter != cards.cend (); iter++)
+		m |= mask_bit (iter->get_suit (), iter->get_number ());
+	return m;
+}
+
+/*
+ * Forget everything we learnt about the previous round
+ */
+void Tracker::reset ()
+{
+	for (int i = 0; i < 4; i++) {
+		held[i] = 0;
+		discarded[i] = 0;
+		draws[i] = 0;
+		pickups[i] = 0;
+	}
+	pile = 0;
+}
+
+void Tracker::on_stack_top (int suit, int number)
+{
+	pile |= mask_bit (suit, number);
+}
+
+void Tracker::on_draw (int nplayer)
+{
+	draws[nplayer]++;
+}
+
+void Tracker::on_pickup (int nplayer, int suit, int number)
+{
+	mask_t m = mask_bit (suit, number);
+
+	held[nplayer] |= m;
+	pile &= ~m;
+	pickups[nplayer]++;
+}
+
+void Tracker::on_discard (int nplayer, int suit, int number)
+{
+	mask_t m = mask_bit (suit, number);
+
+	held[nplayer] &= ~m;
+	discarded[nplayer] |= m;
+	pile |= m;
+}
+
+/*
+ * The deck ran out of cards and the stack of played cards was shuffled
+ * back into it, so those cards are unseen again
+ */
+void Tracker::on_reshuffle ()
+{
+	pile = 0;
+}
+
+/*
+ * Estimate how dangerous @nplayer is from the point of view of somebody
+ * holding @own. Only what every player could see on the table is used: the
+ * cards @nplayer took from the stack, the cards lying on the stack and how
+ * many turns @nplayer has played so far. The result is a rough guess of the
+ * points @nplayer would be charged if the round ended right now and of the
+ * probability that @nplayer ends the round on the next turn.
+ *
+ * Everything is done with a handful of mask operations, so it is cheap
+ * enough to be called on every single turn of a bot
+ */
+void Tracker::get_threat (int nplayer, mask_t own, threat_t *ret) const
+{
+	int i, nknown, nhidden, npool, turns;
+	double mean, covered, melded, ready, outs;
+	mask_t known, pool;
+
+	if (!ret)
+		return;
+
+	known = held[nplayer];
+	pool = MASK_ALL & ~own & ~pile;
+	for (i = 0; i < 4; i++)
+		pool &= ~held[i];
+
+	nknown = mask_count (known);
+	nhidden = nknown < 7 ? 7 - nknown : 0;
+	npool = mask_count (pool);
+	mean = npool ? (double) mask_points (pool) / npool : 6.5;
+
+	// Cards taken from the stack almost always complete or extend a
+	// combo, whereas the fraction of the unknown cards already arranged
+	// in combos grows as the round goes on
+	turns = draws[nplayer] + pickups[nplayer];
+	covered = 1.0 - exp (- (turns + 2.0 * pickups[nplayer]) / 6.0);
+	if (covered > 6.0 / 7.0)
+		covered = 6.0 / 7.0;
+
+	ret->points = mask_points (known) * 0.2 + nhidden * mean * (1.0 - covered);
+
+	// A player can close once at most one of the seven cards is left
+	// out of the combos (none without flexible ending) and one of the
+	// few cards completing them is drawn
+	melded = 7.0 * covered + 0.8 * nknown * (1.0 - covered);
+	if (logic.get_flexible_ending ())
+		melded += 1.0;
+	ready = 1.0 / (1.0 + exp (- 2.0 * (melded - 6.0)));
+	outs = npool ? (3.0 + pickups[nplayer]) / npool : 1.0;
+	if (outs > 1.0)
+		outs = 1.0;
+	ret->closing = ready * outs;
+}
@@ -0,0 +1,64 @@
+/*
+ *
+ * Copyright 2023 Daniel Dwek
+ *
+ * This file is part of chin-chon-lin.
+ *
+ *  chin-chon-lin is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  chin-chon-lin is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with chin-chon-lin.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#ifndef _TRACKER_H_
+#define _TRACKER_H_
+#include <list>
+#include "Mask.h"
+#include "Card.h"
+
+typedef struct {
+	double points;
+	double closing;
+} threat_t;
+
+class Tracker {
+public:
+	Tracker ();
+	Tracker (Tracker&) = delete;
+	Tracker (Tracker&&) = delete;
+	Tracker& operator= (Tracker&) = delete;
+	~Tracker ();
+
+	mask_t get_held (int nplayer) const;
+	mask_t get_discarded (int nplayer) const;
+	mask_t get_pile () const;
+	int get_draws (int nplayer) const;
+	int get_pickups (int nplayer) const;
+	mask_t get_mask (std::list<Card>& cards) const;
+
+	void reset ();
+	void on_stack_top (int suit, int number);
+	void on_draw (int nplayer);
+	void on_pickup (int nplayer, int suit, int number);
+	void on_discard (int nplayer, int suit, int number);
+	void on_reshuffle ();
+	void get_threat (int nplayer, mask_t own, threat_t *ret) const;
+private:
+	mask_t held[4];
+	mask_t discarded[4];
+	mask_t pile;
+	int draws[4];
+	int pickups[4];
+};
+
+extern class Tracker tracker;
+
+#endif
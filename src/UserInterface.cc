@@ -34,6 +34,7 @@
 #include "Stack.h"
 #include "Deck.h"
 #include "Card.h"
+#include "Timeline.h"
 
 typedef struct region_st {
 	double x0;
@@ -67,10 +68,9 @@ private:
 };
 
 extern GtkWidget *window, *drawing_area;
-extern unsigned play_card_tid, stack_to_player_tid, deck_to_player_tid;
-extern gboolean on_play_card_cb (GtkWidget *widget, GdkFrameClock *frame_clock, gpointer data);
-extern gboolean on_deck_to_player_cb (GtkWidget *widget, GdkFrameClock *frame_clock, gpointer data);
-extern gboolean on_stack_to_player_cb (GtkWidget *widget, GdkFrameClock *frame_clock, gpointer data);
+extern void on_play_card_step (double value);
+extern void on_deck_to_player_step (double value);
+extern void on_stack_to_player_step (double value);
 
 UserInterface::UserInterface ()
 {
@@ -287,7 +287,7 @@ void UserInterface::foreach (cairo_t *cr, double x, double y)
 				player[0].unlock ();
 				player[0].set_selected (iter->ncard);
 				board.set_status (DECK_TO_PLAYER_START);
-				deck_to_player_tid = gtk_widget_add_tick_callback (drawing_area, on_deck_to_player_cb, NULL, NULL);
+				timeline.start (TIMELINE_DECK_TO_PLAYER, TIMELINE_DRAW_MS, EASE_IN_OUT, on_deck_to_player_step);
 				break;
 			} else if (iter->cb == "stack::hover") {
 				if (stack_played.get_cards().size () == 0)
@@ -302,7 +302,7 @@ void UserInterface::foreach (cairo_t *cr, double x, double y)
 				player[0].unlock ();
 				player[0].set_selected (iter->ncard);
 				board.set_status (STACK_TO_PLAYER_START);
-				stack_to_player_tid = gtk_widget_add_tick_callback (drawing_area, on_stack_to_player_cb, NULL, NULL);
+				timeline.start (TIMELINE_STACK_TO_PLAYER, TIMELINE_DRAW_MS, EASE_IN_OUT, on_stack_to_player_step);
 				break;
 			} else if (iter->cb == "human::hover") {
 				if (player[0].get_cards().size () < 7)
@@ -310,7 +310,7 @@ void UserInterface::foreach (cairo_t *cr, double x, double y)
 				player[0].set_extra_card (false);
 				player[0].set_selected (iter->ncard);
 				board.set_status (PLAY_CARD_START);
-				play_card_tid = gtk_widget_add_tick_callback (drawing_area, on_play_card_cb, NULL, NULL);
+				timeline.start (TIMELINE_PLAY_CARD, TIMELINE_PLAY_MS, EASE_IN_OUT, on_play_card_step);
 				player[0].play (cr, iter->ncard);
 				deck.set_locked (false);
 				deck.unlock ("deck", -1);
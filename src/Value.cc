@@ -0,0 +1,418 @@
+/*
+ *
+ * Copyright 2023 Daniel Dwek
+ *
+ * This file is part of chin-chon-lin.
+ *
+ *  chin-chon-lin is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  chin-chon-lin is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with chin-chon-lin.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <stdint.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "Mask.h"
+#include "Meld.h"
+
+#define VALUE_INPUTS	146
+#define VALUE_HIDDEN1	32
+#define VALUE_HIDDEN2	16
+// Bumped whenever the inputs or what the network estimates change
+#define VALUE_FORMAT	"chin-chon-lin-value-2"
+#define VALUE_WEIGHTS	(VALUE_INPUTS * VALUE_HIDDEN1 + VALUE_HIDDEN1 + \
+			 VALUE_HIDDEN1 * VALUE_HIDDEN2 + VALUE_HIDDEN2 + VALUE_HIDDEN2 + 1)
+
+typedef struct {
+	mask_t hand;
+	mask_t pile;
+	int top;
+	int deck_size;
+	float target;
+} sample_t;
+
+class Value {
+public:
+	Value ();
+	Value (Value&) = delete;
+	Value (Value&&) = delete;
+	Value& operator= (Value&) = delete;
+	~Value ();
+
+	bool is_loaded () const;
+	float evaluate (mask_t hand, mask_t pile, int top, int deck_size) const;
+	float evaluate_best (mask_t hand, mask_t pile, int deck_size, int *ret_discard) const;
+	void randomize (uint64_t seed);
+	double train (sample_t *samples, int n, float rate, uint64_t seed);
+	double get_error (const sample_t *samples, int n) const;
+	bool load (const char *filename);
+	bool save (const char *filename) const;
+private:
+	void forward (const sample_t *s, float *h1, float *h2, float *out) const;
+
+	alignas (16) float w1[VALUE_INPUTS][VALUE_HIDDEN1];
+	alignas (16) float b1[VALUE_HIDDEN1];
+	alignas (16) float w2[VALUE_HIDDEN1][VALUE_HIDDEN2];
+	alignas (16) float b2[VALUE_HIDDEN2];
+	alignas (16) float w3[VALUE_HIDDEN2];
+	float b3;
+	bool loaded;
+};
+
+// Inputs: the hand (48), the cards played (48), the card on top of the
+// stack (48, one-hot), the fraction of the deck still to be drawn and the
+// points of the hand (which the network could hardly learn from its bits)
+#define IN_HAND		0
+#define IN_PILE		48
+#define IN_TOP		96
+#define IN_DECK		144
+#define IN_POINTS	145
+// Outputs and targets are in tens of points
+#define SCALE		10.0f
+
+/*
+ * Tiny multilayer perceptron (146-32-16-1, about five thousand weights)
+ * estimating the points a player will be charged with at the end of the
+ * round (negated, so that higher is better) from the state right after its
+ * turn: hand, cards played, card on top of the stack and size of the deck.
+ *
+ * Inputs are mostly bits, so the first layer just adds up one row of
+ * weights per card; rows are 32 floats long and are added four at a time with SSE2
+ * (a plain loop is used on other targets). The whole evaluation takes a
+ * few hundred nanoseconds. Training is plain stochastic gradient descent
+ * and is only run offline by chin-chon-lin-sim
+ */
+Value::Value ()
+{
+	memset (w1, 0, sizeof (w1));
+	memset (b1, 0, sizeof (b1));
+	memset (w2, 0, sizeof (w2));
+	memset (b2, 0, sizeof (b2));
+	memset (w3, 0, sizeof (w3));
+	b3 = 0.0f;
+	loaded = false;
+}
+
+Value::~Value ()
+{
+}
+
+bool Value::is_loaded () const
+{
+	return loaded;
+}
+
+#ifdef __SSE2__
+static inline void add_row (__m128 *acc, const float *row)
+{
+	for (int k = 0; k < VALUE_HIDDEN1 / 4; k++)
+		acc[k] = _mm_add_ps (acc[k], _mm_load_ps (row + 4 * k));
+}
+
+float Value::evaluate (mask_t hand, mask_t pile, int top, int deck_size) const
+{
+	int i, k;
+	mask_t m;
+	float out;
+	__m128 acc[VALUE_HIDDEN1 / 4], acc2[VALUE_HIDDEN2 / 4], zero = _mm_setzero_ps (), x, y, sum;
+	alignas (16) float h1[VALUE_HIDDEN1];
+	alignas (16) float tmp[4];
+
+	for (k = 0; k < VALUE_HIDDEN1 / 4; k++)
+		acc[k] = _mm_load_ps (b1 + 4 * k);
+	for (m = hand; m; m &= m - 1)
+		add_row (acc, w1[IN_HAND + mask_first (m)]);
+	for (m = pile; m; m &= m - 1)
+		add_row (acc, w1[IN_PILE + mask_first (m)]);
+	if (top != -1)
+		add_row (acc, w1[IN_TOP + top]);
+	x = _mm_set1_ps (deck_size / 48.0f);
+	y = _mm_set1_ps (meld_deadwood (hand) / 50.0f);
+	for (k = 0; k < VALUE_HIDDEN1 / 4; k++) {
+		acc[k] = _mm_add_ps (acc[k], _mm_mul_ps (x, _mm_load_ps (w1[IN_DECK] + 4 * k)));
+		acc[k] = _mm_add_ps (acc[k], _mm_mul_ps (y, _mm_load_ps (w1[IN_POINTS] + 4 * k)));
+		_mm_store_ps (h1 + 4 * k, _mm_max_ps (acc[k], zero));
+	}
+
+	for (k = 0; k < VALUE_HIDDEN2 / 4; k++)
+		acc2[k] = _mm_load_ps (b2 + 4 * k);
+	for (i = 0; i < VALUE_HIDDEN1; i++) {
+		if (h1[i] == 0.0f)
+			continue;
+		x = _mm_set1_ps (h1[i]);
+		for (k = 0; k < VALUE_HIDDEN2 / 4; k++)
+			acc2[k] = _mm_add_ps (acc2[k], _mm_mul_ps (x, _mm_load_ps (w2[i] + 4 * k)));
+	}
+
+	sum = zero;
+	for (k = 0; k < VALUE_HIDDEN2 / 4; k++)
+		sum = _mm_add_ps (sum, _mm_mul_ps (_mm_max_ps (acc2[k], zero), _mm_load_ps (w3 + 4 * k)));
+	_mm_store_ps (tmp, sum);
+	out = b3 + tmp[0] + tmp[1] + tmp[2] + tmp[3];
+
+	return out * SCALE;
+}
+#else
+float Value::evaluate (mask_t hand, mask_t pile, int top, int deck_size) const
+{
+	float h1[VALUE_HIDDEN1], h2[VALUE_HIDDEN2], out;
+	sample_t s = { hand, pile, top, deck_size, 0.0f };
+
+	forward (&s, h1, h2, &out);
+	return out * SCALE;
+}
+#endif
+
+/*
+ * Best value of the positions reachable by discarding one of the cards in
+ * @hand onto the cards in @pile, which one is stored into @ret_discard
+ */
+float Value::evaluate_best (mask_t hand, mask_t pile, int deck_size, int *ret_discard) const
+{
+	int c;
+	float v, best = -1e9f;
+	mask_t m;
+
+	for (m = hand; m; m &= m - 1) {
+		c = mask_first (m);
+		v = evaluate (hand & ~((mask_t) 1 << c), pile, c, deck_size);
+		if (v > best) {
+			best = v;
+			*ret_discard = c;
+		}
+	}
+
+	return best;
+}
+
+/*
+ * Plain evaluation keeping the activations of the hidden layers, as
+ * needed by training
+ */
+void Value::forward (const sample_t *s, float *h1, float *h2, float *out) const
+{
+	int i, j;
+	mask_t m;
+	float x = s->deck_size / 48.0f, y = meld_deadwood (s->hand) / 50.0f;
+
+	for (j = 0; j < VALUE_HIDDEN1; j++)
+		h1[j] = b1[j] + x * w1[IN_DECK][j] + y * w1[IN_POINTS][j];
+	for (m = s->hand; m; m &= m - 1)
+		for (j = 0; j < VALUE_HIDDEN1; j++)
+			h1[j] += w1[IN_HAND + mask_first (m)][j];
+	for (m = s->pile; m; m &= m - 1)
+		for (j = 0; j < VALUE_HIDDEN1; j++)
+			h1[j] += w1[IN_PILE + mask_first (m)][j];
+	if (s->top != -1)
+		for (j = 0; j < VALUE_HIDDEN1; j++)
+			h1[j] += w1[IN_TOP + s->top][j];
+	for (j = 0; j < VALUE_HIDDEN1; j++)
+		h1[j] = h1[j] > 0.0f ? h1[j] : 0.0f;
+
+	for (j = 0; j < VALUE_HIDDEN2; j++) {
+		h2[j] = b2[j];
+		for (i = 0; i < VALUE_HIDDEN1; i++)
+			h2[j] += h1[i] * w2[i][j];
+		h2[j] = h2[j] > 0.0f ? h2[j] : 0.0f;
+	}
+
+	*out = b3;
+	for (j = 0; j < VALUE_HIDDEN2; j++)
+		*out += h2[j] * w3[j];
+}
+
+static uint64_t next (uint64_t *seed)
+{
+	*seed ^= *seed >> 12;
+	*seed ^= *seed << 25;
+	*seed ^= *seed >> 27;
+	return *seed * 0x2545f4914f6cdd1dULL;
+}
+
+static float uniform (uint64_t *seed)
+{
+	return (next (seed) >> 40) * (1.0f / 16777216.0f);
+}
+
+/*
+ * He initialization of the weights, for a network to be trained from
+ * scratch
+ */
+void Value::randomize (uint64_t seed)
+{
+	int i, j;
+	float r1 = sqrtf (6.0f / 50.0f), r2 = sqrtf (6.0f / VALUE_HIDDEN1), r3 = sqrtf (6.0f / VALUE_HIDDEN2);
+
+	seed = seed ? seed : 1;
+	for (i = 0; i < VALUE_INPUTS; i++)
+		for (j = 0; j < VALUE_HIDDEN1; j++)
+			w1[i][j] = (2.0f * uniform (&seed) - 1.0f) * r1;
+	for (i = 0; i < VALUE_HIDDEN1; i++)
+		for (j = 0; j < VALUE_HIDDEN2; j++)
+			w2[i][j] = (2.0f * uniform (&seed) - 1.0f) * r2;
+	for (j = 0; j < VALUE_HIDDEN2; j++)
+		w3[j] = (2.0f * uniform (&seed) - 1.0f) * r3;
+	memset (b1, 0, sizeof (b1));
+	memset (b2, 0, sizeof (b2));
+	b3 = 0.0f;
+	loaded = true;
+}
+
+/*
+ * One epoch of stochastic gradient descent on the squared error, visiting
+ * @samples (which get shuffled) in random order. The mean squared error
+ * over the epoch, in points, is returned
+ */
+double Value::train (sample_t *samples, int n, float rate, uint64_t seed)
+{
+	int i, j, k;
+	mask_t m;
+	float h1[VALUE_HIDDEN1], h2[VALUE_HIDDEN2], out, err, d2[VALUE_HIDDEN2], d1[VALUE_HIDDEN1], x, y;
+	double total = 0.0;
+	sample_t tmp;
+
+	seed = seed ? seed : 1;
+	for (i = n - 1; i > 0; i--) {
+		j = next (&seed) % (i + 1);
+		tmp = samples[i];
+		samples[i] = samples[j];
+		samples[j] = tmp;
+	}
+
+	for (k = 0; k < n; k++) {
+		const sample_t *s = &samples[k];
+
+		forward (s, h1, h2, &out);
+		err = out - s->target / SCALE;
+		total += (double) err * err * SCALE * SCALE;
+
+		for (j = 0; j < VALUE_HIDDEN2; j++)
+			d2[j] = h2[j] > 0.0f ? err * w3[j] : 0.0f;
+		for (i = 0; i < VALUE_HIDDEN1; i++) {
+			d1[i] = 0.0f;
+			if (h1[i] > 0.0f)
+				for (j = 0; j < VALUE_HIDDEN2; j++)
+					d1[i] += d2[j] * w2[i][j];
+		}
+
+		for (j = 0; j < VALUE_HIDDEN2; j++)
+			w3[j] -= rate * err * h2[j];
+		b3 -= rate * err;
+		for (i = 0; i < VALUE_HIDDEN1; i++)
+			for (j = 0; j < VALUE_HIDDEN2; j++)
+				w2[i][j] -= rate * d2[j] * h1[i];
+		for (j = 0; j < VALUE_HIDDEN2; j++)
+			b2[j] -= rate * d2[j];
+
+		x = s->deck_size / 48.0f;
+		y = meld_deadwood (s->hand) / 50.0f;
+		for (i = 0; i < VALUE_HIDDEN1; i++) {
+			if (d1[i] == 0.0f)
+				continue;
+			for (m = s->hand; m; m &= m - 1)
+				w1[IN_HAND + mask_first (m)][i] -= rate * d1[i];
+			for (m = s->pile; m; m &= m - 1)
+				w1[IN_PILE + mask_first (m)][i] -= rate * d1[i];
+			if (s->top != -1)
+				w1[IN_TOP + s->top][i] -= rate * d1[i];
+			w1[IN_DECK][i] -= rate * d1[i] * x;
+			w1[IN_POINTS][i] -= rate * d1[i] * y;
+			b1[i] -= rate * d1[i];
+		}
+	}
+
+	return n ? total / n : 0.0;
+}
+
+/*
+ * Mean squared error over @samples, in points
+ */
+double Value::get_error (const sample_t *samples, int n) const
+{
+	int i;
+	double err, total = 0.0;
+
+	for (i = 0; i < n; i++) {
+		err = evaluate (samples[i].hand, samples[i].pile, samples[i].top, samples[i].deck_size) -
+			samples[i].target;
+		total += err * err;
+	}
+	return n ? total / n : 0.0;
+}
+
+/*
+ * Weights are kept in a text file: a header line followed by every weight,
+ * layer after layer
+ */
+bool Value::load (const char *filename)
+{
+	int i, j;
+	char header[64];
+	bool ok = true;
+	FILE *fp;
+
+	if (!(fp = fopen (filename, "r")))
+		return false;
+	if (fscanf (fp, "%63s", header) != 1 || strcmp (header, VALUE_FORMAT))
+		ok = false;
+	for (i = 0; ok && i < VALUE_INPUTS; i++)
+		for (j = 0; ok && j < VALUE_HIDDEN1; j++)
+			ok = fscanf (fp, "%f", &w1[i][j]) == 1;
+	for (j = 0; ok && j < VALUE_HIDDEN1; j++)
+		ok = fscanf (fp, "%f", &b1[j]) == 1;
+	for (i = 0; ok && i < VALUE_HIDDEN1; i++)
+		for (j = 0; ok && j < VALUE_HIDDEN2; j++)
+			ok = fscanf (fp, "%f", &w2[i][j]) == 1;
+	for (j = 0; ok && j < VALUE_HIDDEN2; j++)
+		ok = fscanf (fp, "%f", &b2[j]) == 1;
+	for (j = 0; ok && j < VALUE_HIDDEN2; j++)
+		ok = fscanf (fp, "%f", &w3[j]) == 1;
+	if (ok)
+		ok = fscanf (fp, "%f", &b3) == 1;
+	fclose (fp);
+	loaded = ok;
+
+	return ok;
+}
+
+bool Value::save (const char *filename) const
+{
+	int i, j;
+	char tmp[4096];
+	FILE *fp;
+
+	snprintf (tmp, sizeof (tmp), "%s.tmp", filename);
+	if (!(fp = fopen (tmp, "w")))
+		return false;
+	fprintf (fp, "%s\n", VALUE_FORMAT);
+	for (i = 0; i < VALUE_INPUTS; i++)
+		for (j = 0; j < VALUE_HIDDEN1; j++)
+			fprintf (fp, "%.7g%c", w1[i][j], j == VALUE_HIDDEN1 - 1 ? '\n' : ' ');
+	for (j = 0; j < VALUE_HIDDEN1; j++)
+		fprintf (fp, "%.7g%c", b1[j], j == VALUE_HIDDEN1 - 1 ? '\n' : ' ');
+	for (i = 0; i < VALUE_HIDDEN1; i++)
+		for (j = 0; j < VALUE_HIDDEN2; j++)
+			fprintf (fp, "%.7g%c", w2[i][j], j == VALUE_HIDDEN2 - 1 ? '\n' : ' ');
+	for (j = 0; j < VALUE_HIDDEN2; j++)
+		fprintf (fp, "%.7g%c", b2[j], j == VALUE_HIDDEN2 - 1 ? '\n' : ' ');
+	for (j = 0; j < VALUE_HIDDEN2; j++)
+		fprintf (fp, "%.7g%c", w3[j], j == VALUE_HIDDEN2 - 1 ? '\n' : ' ');
+	fprintf (fp, "%.7g\n", b3);
+	if (fclose (fp) != 0)
+		return false;
+
+	return rename (tmp, filename) == 0;
+}
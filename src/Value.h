@@ -0,0 +1,72 @@
+/*
+ *
+ * Copyright 2023 Daniel Dwek
+ *
+ * This file is part of chin-chon-lin.
+ *
+ *  chin-chon-lin is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  chin-chon-lin is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with chin-chon-lin.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#ifndef _VALUE_H_
+#define _VALUE_H_
+#include <stdint.h>
+#include "Mask.h"
+
+#define VALUE_INPUTS	146
+#define VALUE_HIDDEN1	32
+#define VALUE_HIDDEN2	16
+// Bumped whenever the inputs or what the network estimates change
+#define VALUE_FORMAT	"chin-chon-lin-value-2"
+#define VALUE_WEIGHTS	(VALUE_INPUTS * VALUE_HIDDEN1 + VALUE_HIDDEN1 + \
+			 VALUE_HIDDEN1 * VALUE_HIDDEN2 + VALUE_HIDDEN2 + VALUE_HIDDEN2 + 1)
+
+typedef struct {
+	mask_t hand;
+	mask_t pile;
+	int top;
+	int deck_size;
+	float target;
+} sample_t;
+
+class Value {
+public:
+	Value ();
+	Value (Value&) = delete;
+	Value (Value&&) = delete;
+	Value& operator= (Value&) = delete;
+	~Value ();
+
+	bool is_loaded () const;
+	float evaluate (mask_t hand, mask_t pile, int top, int deck_size) const;
+	float evaluate_best (mask_t hand, mask_t pile, int deck_size, int *ret_discard) const;
+	void randomize (uint64_t seed);
+	double train (sample_t *samples, int n, float rate, uint64_t seed);
+	double get_error (const sample_t *samples, int n) const;
+	bool load (const char *filename);
+	bool save (const char *filename) const;
+private:
+	void forward (const sample_t *s, float *h1, float *h2, float *out) const;
+
+	alignas (16) float w1[VALUE_INPUTS][VALUE_HIDDEN1];
+	alignas (16) float b1[VALUE_HIDDEN1];
+	alignas (16) float w2[VALUE_HIDDEN1][VALUE_HIDDEN2];
+	alignas (16) float b2[VALUE_HIDDEN2];
+	alignas (16) float w3[VALUE_HIDDEN2];
+	float b3;
+	bool loaded;
+};
+
+extern class Value value;
+
+#endif
@@ -35,32 +35,81 @@
 #include "Deck.h"
 #include "Stack.h"
 #include "Card.h"
+#include "Tracker.h"
+#include "Belief.h"
+#include "Search.h"
+#include "Strategy.h"
+#include "Value.h"
+#include "Hint.h"
+#include "Review.h"
+#include "Raster.h"
+#include "Timeline.h"
+#include "Hud.h"
+
+// Milliseconds the window has to keep its size before the cards are
+// rasterized again
+#define RESIZE_DELAY	150
 
 GtkWidget *window;
 GtkWidget *drawing_area;
-unsigned deck_dist_tid, play_card_tid;
-unsigned stack_to_player_tid, deck_to_player_tid;
-unsigned player_ending_round_tid;
 unsigned menubar_height;
+static gint64 started;
+static cairo_surface_t *standin;
+static double standin_x_scale, standin_y_scale;
+static guint resize_tid;
 class Cmdline cmdline;
 class UserInterface ui;
 class Logic logic;
-class Board board (800, 500, 1.0, 1.0, 5.0);
+class Board board (800, 500, 1.0, 1.0);
 class Player player[4];
 class Deck deck;
 class StackPlayed stack_played;
 class Card card[48];
+class Tracker tracker;
+class Belief belief;
+class Search search;
+class Strategy strategy;
+class Value value;
+class Hint hint;
+class Review review;
+class Raster raster;
+class Timeline timeline;
+class Hud hud;
+
+extern void on_deal_step (double value);
+extern void on_play_card_step (double value);
+extern void on_deck_to_player_step (double value);
+extern void on_stack_to_player_step (double value);
+extern void on_ending_round_step (double value);
 
-extern gboolean on_play_card_cb (GtkWidget *widget, GdkFrameClock *frame_clock, gpointer data);
-extern gboolean on_deck_to_player_cb (GtkWidget *widget, GdkFrameClock *frame_clock, gpointer data);
-extern gboolean on_stack_to_player_cb (GtkWidget *widget, GdkFrameClock *frame_clock, gpointer data);
-extern gboolean on_player_ending_round_cb (GtkWidget *widget, GdkFrameClock *frame_clock, gpointer data);
+/*
+ * Queue the redraw of the selector shown for @status, wide enough to cover
+ * the hint drawn around the same tile as well
+ */
+static void damage_selector (status_t status, int ncard)
+{
+	double x, y, w, h;
+
+	if (status == DECK_HOVER) {
+		board.damage (deck.get_x () - 10.0, deck.get_y () - 10.0, deck.get_w () + 20.0, deck.get_h () + 20.0);
+	} else if (status == STACK_HOVER) {
+		board.damage (stack_played.get_x () - 10.0, stack_played.get_y () - 10.0,
+				stack_played.get_w () + 20.0, stack_played.get_h () + 20.0);
+	} else if (status == HUMAN_HOVER && ncard != -1) {
+		player[0].get_bounds (ncard, &x, &y, &w, &h);
+		board.damage (x - 10.0, y - 10.0, w + 20.0, h + 20.0);
+	}
+}
 
 bool motion_notify_event (GtkWidget *widget, GdkEventMotion *event, gpointer data)
 {
 	int x, y;
 	region_t rgn = { 0 };
+	status_t status = board.get_status ();
+	int selected = player[0].get_selected ();
 
+	if (!raster.is_ready ())
+		return false;
 	gdk_window_get_device_position (event->window, event->device, &x, &y, nullptr);
 	ui.query (x, y, &rgn);
 
@@ -77,56 +126,146 @@ bool motion_notify_event (GtkWidget *widget, GdkEventMotion *event, gpointer dat
 		} else if (rgn.cb == "stack::hover" && !stack_played.is_locked ()) {
 			board.set_status (STACK_HOVER);
 		}
-		gtk_widget_queue_draw (widget);
+		if (board.get_status () != status || player[0].get_selected () != selected) {
+			damage_selector (status, selected);
+			damage_selector (board.get_status (), player[0].get_selected ());
+		}
 	}
 	return true;
 }
 
-gint draw_cb (GtkWidget *widget, cairo_t *cr, gpointer data)
+static gboolean hint_ready_cb (gpointer data)
+{
+	gtk_widget_queue_draw (drawing_area);
+	return G_SOURCE_REMOVE;
+}
+
+/*
+ * Called from the thread working out the hints, so the redraw is left to
+ * the main loop
+ */
+static void hint_notify ()
+{
+	g_idle_add (hint_ready_cb, nullptr);
+}
+
+/*
+ * A bot is done thinking: the next frame goes on with its move
+ */
+static gboolean logic_ready_cb (gpointer data)
+{
+	gtk_widget_queue_draw (drawing_area);
+	return G_SOURCE_REMOVE;
+}
+
+/*
+ * Called from the thread of the lookahead of the bots
+ */
+static void logic_notify ()
+{
+	g_idle_add (logic_ready_cb, nullptr);
+}
+
+static void start_game ();
+
+/*
+ * The game starts as soon as the first atlas is there to draw the deal from
+ */
+static gboolean raster_ready_cb (gpointer data)
+{
+	static bool started = false;
+
+	if (!raster.swap ())
+		return G_SOURCE_REMOVE;
+	if (!started) {
+		start_game ();
+		started = true;
+	}
+	if (standin && raster.is_current ()) {
+		cairo_surface_destroy (standin);
+		standin = nullptr;
+	}
+	board.damage_all ();
+	return G_SOURCE_REMOVE;
+}
+
+/*
+ * Called from the thread building the card atlas, at startup and after
+ * every resize
+ */
+static void raster_notify ()
+{
+	g_idle_add (raster_ready_cb, nullptr);
+}
+
+/*
+ * While it is the human's turn, ask for a new hint every time a card is
+ * taken or the last hint was dropped, and mark it once ready. Hints never
+ * make the frame wait: while a dropped one is still winding down nothing
+ * is asked, and the next frame after it is done asks again
+ */
+static void draw_hint (cairo_t *cr)
+{
+	int c;
+	position_t pos;
+	belief_view_t view;
+	status_t status = board.get_status ();
+
+	if (!hint.is_enabled () || board.get_turn () != 0)
+		return;
+	if (status != IDLE && status != HUMAN_HOVER && status != DECK_HOVER && status != STACK_HOVER)
+		return;
+
+	if (tracker.get_mask (player[0].get_cards ()) != hint.get_hand ()) {
+		if (hint.is_running ())
+			return;
+		logic.get_known (0, &pos);
+		if (belief.is_ready ())
+			belief.get_view (0, &view);
+		hint.request (&pos, belief.is_ready () ? &view : nullptr);
+		return;
+	}
+	if (!hint.is_ready ())
+		return;
+
+	if (hint.get_source () == 0)
+		stack_played.draw_hint (cr);
+	else if (hint.get_source () == 1)
+		deck.draw_hint (cr);
+	else if ((c = hint.get_discard ()) != -1)
+		player[0].draw_hint (cr, player[0].get_idx (c / 12, c % 12 + 1));
+}
+
+/*
+ * Step the game for this frame, drawing whatever moves (or only lasts for
+ * this frame, like selectors and hints) on the sprite layer @cr
+ */
+static gint draw_sprites (GtkWidget *widget, cairo_t *cr)
 {
 	int i, ncard = 0;
+	bool source, closing;
 	static bool is_selected = false, set_player = false;
 	std::string suit[] = { "clubs", "cups", "golds", "swords" };
 	Player& p = player[board.get_turn ()];
 	std::set<struct card_st>::const_iterator iter;
 
-	board.paint (cr);
 	if (board.get_status () == DECK_DISTRIBUTE)
 		for (i = 0; i < 4; i++)
 			player[i].animate (cr);
 
-	for (i = 0; i < 7; i++) {
-		player[0].draw (cr, i);
-		player[1].draw (cr, i);
-		player[2].draw (cr, i);
-		player[3].draw (cr, i);
-		if (i == 6) {
-			if (player[0].has_extra_card ())
-				player[0].draw (cr, 7);
-			else if (player[1].has_extra_card ())
-				player[1].draw (cr, 7);
-			else if (player[2].has_extra_card ())
-				player[2].draw (cr, 7);
-			else if (player[3].has_extra_card ())
-				player[3].draw (cr, 7);
-		}
-	}
-
 	if (board.get_status () == PLAY_CARD_STOP)
 		return -1;
-	deck.draw (cr);
-	for (i = 0; i < 4; i++)
-		player[i].render_name (cr);
-	stack_played.draw (cr);
 
 	if (board.get_status () == PLAY_CARD_START) {
-		board.set_framerate (10.0);
 		if (board.get_turn () != 0) {
 			if (is_selected == false) {
+				hud.begin (HUD_BOTS);
 				logic.get_game_combos ();
 				logic.rearrange_common_cards ();
 				ncard = p.get_ncard_to_play ();
+				hud.end (HUD_BOTS);
 				p.set_selected (ncard & 7);
+				raster.want (p.get_card(ncard & 7).get_asset ());
 				is_selected = true;
 				p.set_xframe (0.0);
 				p.set_yframe (0.0);
@@ -139,7 +278,9 @@ gint draw_cb (GtkWidget *widget, cairo_t *cr, gpointer data)
 		deck.animate (cr);
 	} else if (board.get_status () == FINISHING_ROUND_START) {
 		if (!set_player) {
-			player_ending_round_tid = gtk_widget_add_tick_callback (GTK_WIDGET (drawing_area), on_player_ending_round_cb, NULL, NULL);
+			for (i = 0; i < 4; i++)
+				player[i].prefetch ();
+			timeline.start (TIMELINE_ENDING_ROUND, TIMELINE_ENDING_MS, EASE_IN_OUT, on_ending_round_step);
 			if (board.get_turn () != 0) {
 				ncard = p.get_ncard_to_play ();
 				p.set_selected (ncard);
@@ -152,54 +293,65 @@ gint draw_cb (GtkWidget *widget, cairo_t *cr, gpointer data)
 	if (board.get_status () == PLAY_CARD_STOP) {
 		if (board.get_turn () == 0) {
 			board.set_status (IDLE);
+		} else if (!logic.ponder (board.get_turn ())) {
+			// Still thinking, logic_notify () brings the next frame
 		} else {
+			hud.begin (HUD_BOTS);
 			logic.get_game_combos ();
-			if (logic.choose_source ()) {
+			source = logic.choose_source ();
+			hud.end (HUD_BOTS);
+			if (source) {
 				board.set_status (DECK_TO_PLAYER_START);
-				deck_to_player_tid = gtk_widget_add_tick_callback (GTK_WIDGET (drawing_area), on_deck_to_player_cb, NULL, NULL);
+				timeline.start (TIMELINE_DECK_TO_PLAYER, TIMELINE_DRAW_MS, EASE_IN_OUT, on_deck_to_player_step);
 			} else {
 				board.set_status (STACK_TO_PLAYER_START);
-				stack_to_player_tid = gtk_widget_add_tick_callback (GTK_WIDGET (drawing_area), on_stack_to_player_cb, NULL, NULL);
+				timeline.start (TIMELINE_STACK_TO_PLAYER, TIMELINE_DRAW_MS, EASE_IN_OUT, on_stack_to_player_step);
 			}
 		}
 		stack_played.draw (cr);
 		p.draw_all (cr);
 		is_selected = false;
 	} else if (board.get_status () == STACK_TO_PLAYER_STOP) {
+		hud.begin (HUD_BOTS);
 		logic.choose_source ();
 		logic.get_game_combos ();
 		logic.rearrange_common_cards ();
+		closing = board.get_turn () != 0 && logic.advise_to_finish ();
+		hud.end (HUD_BOTS);
 
 		if (board.get_turn () == 0) {
 			board.set_status (IDLE);
 		} else {
-			if (logic.advise_to_finish ()) {
+			if (closing) {
 				board.set_status (FINISHING_ROUND_START);
 				gtk_widget_queue_draw (widget);
 				return 0;
-			} else {
+			} else if (logic.ponder (board.get_turn ())) {
 				board.set_status (PLAY_CARD_START);
-				play_card_tid = gtk_widget_add_tick_callback (GTK_WIDGET (drawing_area), on_play_card_cb, NULL, NULL);
+				timeline.start (TIMELINE_PLAY_CARD, TIMELINE_PLAY_MS, EASE_IN_OUT, on_play_card_step);
 			}
 		}
 
 		stack_played.draw (cr);
 		p.draw_all (cr);
 	} else if (board.get_status () == DECK_TO_PLAYER_STOP) {
+		hud.begin (HUD_BOTS);
 		logic.choose_source ();
 		logic.get_game_combos ();
 		logic.rearrange_common_cards ();
+		closing = board.get_turn () != 0 && logic.advise_to_finish ();
+		hud.end (HUD_BOTS);
 
 		if (board.get_turn () == 0) {
 			board.set_status (IDLE);
 		} else {
-			if (logic.advise_to_finish ()) {
+			if (closing) {
 				board.set_status (FINISHING_ROUND_START);
 				gtk_widget_queue_draw (widget);
 				return 0;
-			} else {
+			} else if (logic.ponder (board.get_turn ())) {
 				board.set_status (PLAY_CARD_START);
-				play_card_tid = gtk_widget_add_tick_callback (GTK_WIDGET (drawing_area), on_play_card_cb, NULL, NULL);
+				timeline.start (TIMELINE_PLAY_CARD, TIMELINE_PLAY_MS, EASE_IN_OUT, on_play_card_step);
 			}
 		}
 
@@ -215,6 +367,12 @@ gint draw_cb (GtkWidget *widget, cairo_t *cr, gpointer data)
 				player[i].lock ();
 				logic.calc_scores (i);
 			}
+			if (cmdline.is_review_mode ()) {
+				std::string names[4];
+				for (i = 0; i < 4; i++)
+					names[i] = player[i].get_name ();
+				review.start (names);
+			}
 			ui.display_table_of_scores ();
 		} else {
 			board.set_display_scores (true);
@@ -230,24 +388,98 @@ gint draw_cb (GtkWidget *widget, cairo_t *cr, gpointer data)
 	} else if (board.get_status () == HUMAN_HOVER) {
 		player[0].draw_selector (cr, player[0].get_selected ());
 	}
+	draw_hint (cr);
 
 	return 0;
 }
 
-gboolean on_deck_distribute_cb (GtkWidget *widget, GdkFrameClock *frame_clock, gpointer data)
+/*
+ * What the window shows while the cards are being loaded: just the felt
+ * and a notice
+ */
+static void draw_placeholder (cairo_t *cr)
 {
-	double xframe, yframe;
-	Player& p = player[board.get_turn ()];
-	Deck& d = deck;
+	static bool first = true;
+	const char *text = _("Shuffling the cards...");
+	cairo_text_extents_t extents;
+
+	board.paint (cr);
+	cairo_save (cr);
+	cairo_set_source_rgb (cr, 1.0, 1.0, 1.0);
+	cairo_set_font_size (cr, 20.0 * board.get_y_scale ());
+	cairo_text_extents (cr, text, &extents);
+	cairo_move_to (cr, (board.get_width () - extents.width) / 2.0, board.get_height () / 2.0);
+	cairo_show_text (cr, text);
+	cairo_restore (cr);
+
+	if (first) {
+		std::cout << _("First frame after ") << (g_get_monotonic_time () - started) / 1000 << " ms" << std::endl;
+		first = false;
+	}
+}
 
-	xframe = p.get_xframe () + (p.get_xsrc () + p.get_xoffset (0) - (d.get_x () + d.get_cards().size () / 4.0)) / board.get_framerate ();
-	yframe = p.get_yframe () + (p.get_ysrc () + p.get_yoffset (0) - (d.get_y () - d.get_cards().size () / 4.0)) / board.get_framerate ();
-	p.set_xframe (xframe);
-	p.set_yframe (yframe);
+/*
+ * What the window shows while being resized: its last complete frame,
+ * stretched to the new size
+ */
+static void draw_standin (cairo_t *cr)
+{
+	cairo_save (cr);
+	cairo_scale (cr, board.get_x_scale () / standin_x_scale, board.get_y_scale () / standin_y_scale);
+	cairo_set_source_surface (cr, standin, 0, 0);
+	cairo_paint (cr);
+	cairo_restore (cr);
+}
+
+static gint draw_frame (GtkWidget *widget, cairo_t *cr)
+{
+	cairo_t *sprites = board.get_sprite_cr ();
+	status_t status = board.get_status ();
+	int turn = board.get_turn ();
+	double x1, y1, x2, y2;
+	gint ret;
+
+	if (!raster.is_ready ()) {
+		draw_placeholder (cr);
+		return 0;
+	}
+	if (standin) {
+		draw_standin (cr);
+		return 0;
+	}
+
+	// Sprites are drawn and cleared only within the area being redrawn,
+	// anything left outside of it is never shown
+	cairo_clip_extents (cr, &x1, &y1, &x2, &y2);
+	cairo_save (sprites);
+	cairo_rectangle (sprites, x1, y1, x2 - x1, y2 - y1);
+	cairo_clip (sprites);
+	cairo_set_operator (sprites, CAIRO_OPERATOR_CLEAR);
+	cairo_paint (sprites);
+	cairo_set_operator (sprites, CAIRO_OPERATOR_OVER);
+
+	ret = draw_sprites (widget, sprites);
+
+	// Animations only ask for the area of the moving card to be redrawn,
+	// so whatever else a change of state has updated needs a full redraw
+	if (board.get_status () != status || board.get_turn () != turn)
+		board.damage_all ();
+	board.compose (cr);
+	cairo_restore (sprites);
+
+	return ret;
+}
+
+gint draw_cb (GtkWidget *widget, cairo_t *cr, gpointer data)
+{
+	gint ret;
 
-	gtk_widget_queue_draw (GTK_WIDGET (drawing_area));
+	hud.start_frame ();
+	ret = draw_frame (widget, cr);
+	hud.end_frame ();
+	hud.draw (cr);
 
-	return G_SOURCE_CONTINUE;
+	return ret;
 }
 
 void size_allocate_cb (GtkWidget *widget, GdkRectangle *r, gpointer data)
@@ -255,22 +487,8 @@ void size_allocate_cb (GtkWidget *widget, GdkRectangle *r, gpointer data)
 	gtk_widget_set_size_request (drawing_area, r->width, r->height - menubar_height);
 }
 
-int configure_event_cb (GtkWidget *widget, GdkEventConfigure *event, gpointer data)
+static void relocate_all ()
 {
-	if (!board.get_surface ()) {
-		board.set_surface (gdk_window_create_similar_surface (gtk_widget_get_window (widget),
-				CAIRO_CONTENT_COLOR,
-				gtk_widget_get_allocated_width (widget),
-				gtk_widget_get_allocated_height (widget)));
-		board.set_cr (cairo_create (board.get_surface ()));
-	}
-
-	menubar_height = event->y;
-	board.set_width (gtk_widget_get_allocated_width (widget));
-	board.set_height (gtk_widget_get_allocated_height (widget));
-	board.set_x_scale (board.get_width () / 800.0);
-	board.set_y_scale (board.get_height () / 500.0);
-
 	deck.relocate ();
 	for (int i = 0; i < 4; i++)
 		player[i].conf ();
@@ -279,6 +497,87 @@ int configure_event_cb (GtkWidget *widget, GdkEventConfigure *event, gpointer da
 	stack_played.relocate ();
 	if (!player[0].has_extra_card ())
 		stack_played.unlock ("stack", -1);
+}
+
+/*
+ * F3 toggles the timing overlay
+ */
+static gboolean key_press_event_cb (GtkWidget *widget, GdkEventKey *event, gpointer data)
+{
+	if (event->keyval != GDK_KEY_F3)
+		return FALSE;
+	hud.set_enabled (!hud.is_enabled ());
+	return TRUE;
+}
+
+/*
+ * The cards are rasterized again at the new size only once the window has
+ * not been resized for a while
+ */
+static gboolean resize_cb (gpointer data)
+{
+	resize_tid = 0;
+	if (raster.is_current ()) {
+		cairo_surface_destroy (standin);
+		standin = nullptr;
+		board.damage_all ();
+	} else {
+		raster.resize (board.get_x_scale (), board.get_y_scale ());
+	}
+	return G_SOURCE_REMOVE;
+}
+
+/*
+ * While the window is being resized, the last complete frame is kept and
+ * stretched to fit, so that nothing is drawn at a size about to change
+ * again. It is dropped once the atlas for the final size is swapped in
+ */
+int configure_event_cb (GtkWidget *widget, GdkEventConfigure *event, gpointer data)
+{
+	int w = gtk_widget_get_allocated_width (widget);
+	int h = gtk_widget_get_allocated_height (widget);
+
+	menubar_height = event->y;
+	if (board.get_surface () && w == board.get_width () && h == board.get_height ())
+		return 0;
+
+	if (board.get_surface ()) {
+		if (!standin && raster.is_ready ()) {
+			cairo_set_source_surface (board.get_cr (), board.get_sprite_surface (), 0, 0);
+			cairo_paint (board.get_cr ());
+			standin = cairo_surface_reference (board.get_surface ());
+			standin_x_scale = board.get_x_scale ();
+			standin_y_scale = board.get_y_scale ();
+		}
+		cairo_destroy (board.get_cr ());
+		cairo_surface_destroy (board.get_surface ());
+		cairo_destroy (board.get_sprite_cr ());
+		cairo_surface_destroy (board.get_sprite_surface ());
+	}
+	board.set_surface (gdk_window_create_similar_surface (gtk_widget_get_window (widget),
+			CAIRO_CONTENT_COLOR,
+			gtk_widget_get_allocated_width (widget),
+			gtk_widget_get_allocated_height (widget)));
+	board.set_cr (cairo_create (board.get_surface ()));
+	board.set_sprite_surface (gdk_window_create_similar_surface (gtk_widget_get_window (widget),
+			CAIRO_CONTENT_COLOR_ALPHA,
+			gtk_widget_get_allocated_width (widget),
+			gtk_widget_get_allocated_height (widget)));
+	board.set_sprite_cr (cairo_create (board.get_sprite_surface ()));
+	board.set_stale (true);
+
+	board.set_width (w);
+	board.set_height (h);
+	board.set_x_scale (board.get_width () / 800.0);
+	board.set_y_scale (board.get_height () / 500.0);
+	if (resize_tid)
+		g_source_remove (resize_tid);
+	resize_tid = 0;
+	if (standin)
+		resize_tid = g_timeout_add (RESIZE_DELAY, resize_cb, nullptr);
+	else
+		raster.resize (board.get_x_scale (), board.get_y_scale ());
+	relocate_all ();
 
 	return 0;
 }
@@ -287,10 +586,13 @@ bool button_press_event_cb (GtkWidget *widget, GdkEventButton *event, gpointer d
 {
 	Player& p = player[0];
 
+	if (!raster.is_ready ())
+		return false;
 	if (event->type == GDK_BUTTON_PRESS) {
+		hint.cancel ();
 		if (event->button == GDK_BUTTON_PRIMARY) {
 			ui.foreach (board.get_cr (), event->x, event->y);
-			gtk_widget_queue_draw (widget);
+			board.damage_all ();
 			if (event->type == GDK_BUTTON_RELEASE)
 				if (event->type == GDK_BUTTON_PRESS)
 					if (event->type == GDK_2BUTTON_PRESS)
@@ -303,13 +605,13 @@ bool button_press_event_cb (GtkWidget *widget, GdkEventButton *event, gpointer d
 				return false;
 			} else if (logic.get_flexible_ending () == true) {
 				board.set_status (FINISHING_ROUND_START);
-				gtk_widget_queue_draw (GTK_WIDGET (drawing_area));
+				board.damage_all ();
 			} else {
 				if ((p.get_combo_length (0) == 3 && p.get_combo_length (1) == 4) ||
 				    (p.get_combo_length (0) == 4 && p.get_combo_length (1) == 3) ||
 				    (p.get_combo_length (0) == 7)) {
 					board.set_status (FINISHING_ROUND_START);
-					gtk_widget_queue_draw (GTK_WIDGET (drawing_area));
+					board.damage_all ();
 				}
 			}
 		}
@@ -318,18 +620,80 @@ bool button_press_event_cb (GtkWidget *widget, GdkEventButton *event, gpointer d
 	return true;
 }
 
-void activate (GtkApplication *app, gpointer user_data)
+/*
+ * Deal the first round, once the cards can be drawn. Until then the window
+ * only shows the placeholder of draw_cb ()
+ */
+static void start_game ()
 {
-	int i, now;
+	int i;
+	mask_t hands[4];
 	std::string name[4] = { _("Human"), "Bot_1", "Bot_2", "Bot_3" };
 	std::list<Card>::iterator iter1, iter2;
 	std::list<Card> swapped_list;
+
+	std::cout << _("Cards ready after ") << (g_get_monotonic_time () - started) / 1000 << " ms" << std::endl;
+	deck.set_logical (raster.get_logical (deck.get_asset ()));
+	stack_played.set_logical (raster.get_logical (RASTER_BACK));
+	relocate_all ();
+
+	if (!cmdline.is_testing_file ()) {
+		for (i = 0; i < 48; i++) {
+			card[i].init (i / 12, i % 12 + 1);
+			deck.acquire (card[i]);
+		}
+		swapped_list = deck.get_cards ();
+		for (iter1 = swapped_list.begin (); iter1 != swapped_list.end (); iter1++) {
+			int n = rand () % 48;
+			for (i = 0, iter2 = iter1; iter2 != swapped_list.end (); iter2++, i++)
+				if (i == n)
+					std::iter_swap (iter1, iter2);
+		}
+		deck.set_cards (swapped_list);
+	} else {
+		for (i = 0, iter1 = swapped_list.begin (); iter1 != swapped_list.end (); iter1++, i++)
+			std::cout << std::setw (2) << std::setfill (' ') << i <<
+				_(": suit = ") << iter1->get_suit () <<
+				_(", number = ") << iter1->get_number () <<
+				std::endl;
+	}
+	deck.unlock ("deck", -1);
+
+	for (i = 0; i < 4; i++) {
+		player[i].init (i, name[i]);
+		player[i].conf ();
+	}
+	player[0].set_locked (true);
+	player[0].lock ();
+
+	for (i = 0; i < 7; i++) {
+		player[0].acquire ("deck", deck.get_cards().front (), false);
+		player[1].acquire ("deck", deck.get_cards().front (), false);
+		player[2].acquire ("deck", deck.get_cards().front (), false);
+		player[3].acquire ("deck", deck.get_cards().front (), false);
+	}
+	stack_played.set_only_once_value (false);
+	stack_played.acquire ("deck");
+	for (i = 0; i < 4; i++)
+		hands[i] = tracker.get_mask (player[i].get_cards ());
+	belief.reset (hands, tracker.get_pile ());
+
+	board.set_display_scores (true);
+	board.set_status (DECK_DISTRIBUTE);
+	board.new_game ();
+	timeline.start (TIMELINE_DEAL, TIMELINE_DEAL_MS, EASE_OUT, on_deal_step);
+}
+
+void activate (GtkApplication *app, gpointer user_data)
+{
+	int now;
 	GtkBuilder *builder;
 	GtkIconTheme *icon_theme;
 	GdkPixbuf *pixbuf;
 	GError *error = nullptr;
 	GResource *res;
 	GObject *win, *menuitem;
+	gchar *filename;
 
 	icon_theme = gtk_icon_theme_get_default ();
 	pixbuf = gtk_icon_theme_load_icon (icon_theme, "chin-chon-lin", 256, (GtkIconLookupFlags) 0, &error);
@@ -377,6 +741,7 @@ void activate (GtkApplication *app, gpointer user_data)
 	 */
 	g_signal_connect (window, "destroy", G_CALLBACK (gtk_widget_destroy), &window);
 	g_signal_connect (GTK_WIDGET (win), "size-allocate", G_CALLBACK (size_allocate_cb), NULL);
+	g_signal_connect (GTK_WIDGET (win), "key-press-event", G_CALLBACK (key_press_event_cb), NULL);
 	drawing_area = GTK_WIDGET (gtk_builder_get_object (builder, "drawing-area-id"));
 	g_signal_connect (drawing_area, "configure-event", G_CALLBACK (configure_event_cb), NULL);
 	g_signal_connect (drawing_area, "button-press-event", G_CALLBACK (button_press_event_cb), NULL);
@@ -389,48 +754,30 @@ void activate (GtkApplication *app, gpointer user_data)
 	now = time (NULL);
 	srand (now);
 	std::cout << "now = " << now << std::endl;
-	if (!cmdline.is_testing_file ()) {
-		for (i = 0; i < 48; i++) {
-			card[i].init (i / 12, i % 12 + 1);
-			deck.acquire (card[i]);
-		}
-		swapped_list = deck.get_cards ();
-		for (iter1 = swapped_list.begin (); iter1 != swapped_list.end (); iter1++) {
-			int n = rand () % 48;
-			for (i = 0, iter2 = iter1; iter2 != swapped_list.end (); iter2++, i++)
-				if (i == n)
-					std::iter_swap (iter1, iter2);
-		}
-		deck.set_cards (swapped_list);
-	} else {
-		for (i = 0, iter1 = swapped_list.begin (); iter1 != swapped_list.end (); iter1++, i++)
-			std::cout << std::setw (2) << std::setfill (' ') << i <<
-				_(": suit = ") << iter1->get_suit () <<
-				_(", number = ") << iter1->get_number () <<
-				std::endl;
-	}
-	deck.unlock ("deck", -1);
 
-	for (i = 0; i < 4; i++) {
-		player[i].init (i, name[i]);
-		player[i].conf ();
-	}
-	player[0].set_locked (true);
-	player[0].lock ();
-
-	for (i = 0; i < 7; i++) {
-		player[0].acquire ("deck", deck.get_cards().front (), false);
-		player[1].acquire ("deck", deck.get_cards().front (), false);
-		player[2].acquire ("deck", deck.get_cards().front (), false);
-		player[3].acquire ("deck", deck.get_cards().front (), false);
-	}
-	stack_played.set_only_once_value (false);
-	stack_played.acquire ("deck");
+	/*
+	 * Strategy table computed offline with "chin-chon-lin-sim --solve". A
+	 * table of your own takes precedence over the one installed, if any
+	 */
+	filename = g_build_filename (g_get_user_data_dir (), "chin-chon-lin", "strategy.txt", NULL);
+	if (strategy.load (filename) || strategy.load (CHIN_CHON_LIN_DATADIR "data/strategy.txt"))
+		std::cout << _("Strategy table loaded after ") << strategy.get_iterations () <<
+			_(" iterations") << std::endl;
+	g_free (filename);
 
-	board.set_display_scores (true);
-	board.set_status (DECK_DISTRIBUTE);
-	board.new_game ();
-	deck_dist_tid = gtk_widget_add_tick_callback (drawing_area, on_deck_distribute_cb, NULL, NULL);
+	/*
+	 * Likewise for the value function trained with "chin-chon-lin-sim
+	 * --train", which bots prefer over the strategy table
+	 */
+	filename = g_build_filename (g_get_user_data_dir (), "chin-chon-lin", "value.txt", NULL);
+	if (value.load (filename) || value.load (CHIN_CHON_LIN_DATADIR "data/value.txt"))
+		std::cout << _("Value function loaded") << std::endl;
+	g_free (filename);
+	hint.set_notify (hint_notify);
+	logic.set_notify (logic_notify);
+	raster.set_notify (raster_notify);
+	raster.load ();
+	hud.set_enabled (cmdline.is_hud_mode ());
 	gtk_widget_show_all (GTK_WIDGET (win));
 }
 
@@ -440,6 +787,7 @@ int main (int argc, char **argv)
 	int status;
 	std::string lang;
 
+	started = g_get_monotonic_time ();
 	lang = ui.get_language ();
 	setenv ("LANGUAGE", lang.c_str (), true);
 	setlocale (LC_ALL, lang.c_str ());
@@ -450,6 +798,10 @@ int main (int argc, char **argv)
 	app = gtk_application_new ("org.gtk.chin-chon-lin", G_APPLICATION_FLAGS_NONE);
 	g_signal_connect (app, "activate", G_CALLBACK (activate), NULL);
 	status = g_application_run (G_APPLICATION (app), argc, argv);
+	logic.stop_ponder ();
+	raster.unload ();
+	if (standin)
+		cairo_surface_destroy (standin);
 	g_object_unref (app);
 
 	return status;